@@ -20,6 +20,11 @@ connection.onclose = function () {
 connection.onmessage = function (message) {
   // Dispatch incomming responses based on current command
   var response = new TextDecoder().decode(message.data);
+  // Progress of ESP firmware update is sent to all pages and does not depend on current command
+  if (response.startsWith(ota_progress_prefix)) {
+    handle_ota_progress(JSON.parse(response.substring(ota_progress_prefix.length)));
+    return;
+  }
   switch (command_in_progress) {
     case upload_arduino_firmware_cmd:
       handle_upload_arduino_firmware_response(response);
@@ -64,6 +69,7 @@ var enable_arduino_alarm_cmd = "enable_arduino_alarm";
 var set_arduino_alarm_time_cmd = "set_arduino_alarm_time";
 var set_arduino_sunrise_duration_cmd = "set_arduino_sunrise_duration";
 var set_arduino_brightness_cmd = "set_arduino_brightness";
+var ota_progress_prefix = "ota_progress ";
 
 function _(element) {
   return document.getElementById(element);
@@ -93,7 +99,13 @@ function upload_esp_file() {
   ajax.addEventListener("load", upload_complete_handler, false);
   ajax.addEventListener("error", upload_error_handler, false);
   ajax.addEventListener("abort", upload_abort_handler, false);
-  ajax.open("POST", "/update?file_size=" + uploaded_file_size);
+  // Firmware can be compressed by gzip. SHA-256 is of uncompressed firmware
+  var url = "/update?file_size=" + uploaded_file_size;
+  var sha256 = _("uploaded_file_sha256").value.trim();
+  if (sha256.length != 0) {
+    url += "&sha256=" + sha256;
+  }
+  ajax.open("POST", url);
   ajax.send(formdata);
 
   _("upload_status").style.color = "black";
@@ -147,6 +159,52 @@ function upload_abort_handler(event) {
   _("uploaded_file_name").value = "";
 }
 
+// Firmware is taken by ESP itself from file on its FS or from HTTP mirror. Progress comes via WebSocket
+function update_esp_from_source() {
+  var source = _("esp_update_source").value.trim();
+  if (source.length == 0) {
+    return;
+  }
+  if (command_in_progress.length != 0) {
+    alert("ERROR: command \"" + command_in_progress + "\" is still in progress");
+    return;
+  }
+
+  var url = "/update_from?source=" + encodeURIComponent(source);
+  var sha256 = _("uploaded_file_sha256").value.trim();
+  if (sha256.length != 0) {
+    url += "&sha256=" + sha256;
+  }
+  var ajax = new XMLHttpRequest();
+  ajax.addEventListener("load", function (event) {
+    _("upload_status").textContent = event.target.responseText;
+    _("upload_status").style.color = (event.target.status == 200) ? "black" : "red";
+  }, false);
+  ajax.open("POST", url);
+  ajax.send();
+}
+
+function handle_ota_progress(progress) {
+  var total = parseInt(progress.total);
+  var bytes = parseInt(progress.bytes);
+  _("uploaded_size").innerHTML = "Processed " + bytes + " bytes" + ((total != 0) ? " of " + total : "");
+  _("upload_progress_bar").value = (total != 0) ? Math.round((bytes / total) * 100) : 0;
+  if (progress.state == "done") {
+    _("upload_status").innerHTML = "Update Success! Rebooting...";
+    _("upload_status").style.color = "green";
+    setTimeout(function () {
+      window.location.href = "/";
+    }, 5000);
+  } else if (progress.state == "failed") {
+    _("upload_status").textContent = progress.error;  // Error may contain reply of mirror
+    _("upload_status").style.color = "red";
+    _("upload_progress_bar").value = 0;
+  } else {
+    _("upload_status").innerHTML = "Updating... please wait";
+    _("upload_status").style.color = "black";
+  }
+}
+
 function upload_arduino_file() {
   if (command_in_progress.length != 0) {
     alert("ERROR: command \"" + command_in_progress + "\" is still in progress");
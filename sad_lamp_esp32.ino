@@ -9,15 +9,20 @@
 // common practive - its adding root of source tree to include path.
 #include <ESP32SSDP.h>
 #include <FTPServer.h>
-#include <SPIFFS.h>
 #include <WiFiManager.h>
 
 
 // #include "src/ArduinoCommunication.h"
+#include "src/Control/ClockService.h"
+#include "src/Control/Persistency.h"
 #include "src/Servers/DebugServer.h"
 #include "src/Servers/SadLampWebServer.h"
 #include "src/Servers/SadLampWebSocketServer.h"
+#include "src/Utils/FS.h"
+#include "src/Utils/FsBackend.h"
 #include "src/Utils/Logger.h"
+#include "src/Utils/Scheduler.h"
+#include "src/Utils/TimerWheel.h"
 
 namespace
 {
@@ -26,10 +31,14 @@ Servers::SadLampWebSocketServer
 Servers::SadLampWebServer web_server;
 Servers::DebugServer      debug_server(web_socket_server);
 // ArduinoCommunication arduino_communication(web_socket_server, web_server, RESET_PIN);
-FTPServer ftp_server(SPIFFS);
-
-bool                    is_reboot_requested{false};
-constexpr unsigned long reboot_delay{100};  // Reboot happens 100ms after receiving reboot request
+FTPServer ftp_server(Utils::FsBackend::instance().get_fs());
+ClockService clock_service;  // System clock, synchronized with NTP server and RTC
+
+Utils::Scheduler::Id reboot_action_id{0};
+constexpr uint32_t   reboot_delay{100};  // Reboot happens 100ms after receiving reboot request
+char const*          ntp_server{"pool.ntp.org"};
+constexpr uint16_t   ntp_port{123};
+constexpr int32_t    utc_offset_s{0};  // Time of lamp is UTC. Alarms are set in the same time
 }  // namespace
 
 void
@@ -44,7 +53,9 @@ setup()
     // delay(3000);
 
     init_wifi();
-    SPIFFS.begin();
+    clock_service.setup();
+    clock_service.set_ntp_server(ntp_server, ntp_port, utc_offset_s);
+    Utils::FS::begin();
     debug_server.init();
     web_socket_server.init();
     web_server.init();
@@ -53,19 +64,23 @@ setup()
 
     // TODO: in 1/4-1/10 times after reboot ESP32 can not connect with previous WiFi settings and you have to reset it
     // manually 1 more time
-    web_server.set_handler(Servers::SadLampWebServer::Event::REBOOT_ESP,
-                           [&is_reboot_requested](String const& filename) { is_reboot_requested = true; });
+    web_server.set_handler(Servers::SadLampWebServer::Event::REBOOT_ESP, [](String const&) { request_reboot(); });
 
     // Request to reset wifi settings can come from WebUI and from Arduino (via potentiometer and switching from auto to
     // manual mode and vice versa)
-    auto WiFiSettingsResetHandler = [&is_reboot_requested](String const&) {
+    auto WiFiSettingsResetHandler = [](String const&) {
         WiFiManager wifi_manager(DGB_STREAM);
         wifi_manager.erase();
-        is_reboot_requested = true;
+        request_reboot();
     };
     web_server.set_handler(Servers::SadLampWebServer::Event::RESET_WIFI_SETTINGS, WiFiSettingsResetHandler);
     // arduino_communication.set_handler(ArduinoCommunication::Event::RESET_WIFI_SETTINGS, WiFiSettingsResetHandler);
 
+    // Progress of firmware update from file or mirror is sent to all pages, which are opened
+    web_server.set_handler(Servers::SadLampWebServer::Event::OTA_PROGRESS, [](String const& progress) {
+        web_socket_server.broadcast(String{"ota_progress "} + progress);
+    });
+
     web_server.set_get_ssdp_description_handler([&SSDP](WiFiClient wiFiClient) { SSDP.schema(std::move(wiFiClient)); });
 }
 
@@ -73,20 +88,27 @@ void
 loop()
 {
     // arduino_communication.loop();
-    debug_server.loop();
     web_server.loop();
     web_socket_server.loop();
     ftp_server.handleFTP();
+    Persistency::instance().loop();
+    clock_service.loop();
+    Utils::Scheduler::instance().loop();
+    Utils::TimerWheel::instance().loop();  // Periodic work of modules (ex. sending of logs by debug_server)
+}
 
-    if (is_reboot_requested) {
-        // If reboot of ESP is requested, it is triggered not immediately, but with reboot_delay. It lets ESP to finish
-        // some actions, ex. sending responses to Web-clients, etc.
-        static unsigned long reboot_request_time = millis();
-        if (millis() - reboot_request_time >= reboot_delay) {
-            ESP.restart();
-            delay(5000);
-        }
+void
+request_reboot()
+{
+    // If reboot of ESP is requested, it is triggered not immediately, but with reboot_delay. It lets ESP to finish
+    // some actions, ex. sending responses to Web-clients, etc.
+    if (Utils::Scheduler::instance().is_scheduled(reboot_action_id)) {
+        return;
     }
+    reboot_action_id = Utils::Scheduler::instance().schedule_once(reboot_delay, []() {
+        Persistency::instance().commit();  // Do not lose changes, which are not written yet
+        ESP.restart();
+    });
 }
 
 
@@ -0,0 +1,321 @@
+#include "ClockService.h"
+
+#include <sys/time.h>
+
+#include <DS1307RTC.h>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr uint8_t  kNtpPacketSize{48};
+constexpr uint16_t kNtpLocalPort{2390};
+constexpr uint32_t kNtpToUnixEpochOffsetS{2208988800UL};  // Seconds between 1900 and 1970
+constexpr uint32_t kNtpResponseTimeoutMs{1000};
+constexpr uint32_t kNtpRetryPeriodMs{60 * 1000};
+
+constexpr int64_t  kMicrosPerSecond{1000000};
+constexpr int64_t  kMaxSlewOffsetUs{30 * kMicrosPerSecond};  // Bigger errors are corrected by step
+constexpr uint32_t kDriftCompensationPeriodMs{60 * 1000};
+constexpr float    kDriftEstimationGain{0.5f};
+constexpr float    kMaxDriftPpm{500.0f};
+constexpr int32_t  kRtcMaxErrorS{2};  // RTC has resolution of 1 second, so do not react on smaller errors
+
+int64_t
+get_time_us()
+{
+    timeval time_value;
+    gettimeofday(&time_value, nullptr);
+    return (int64_t)time_value.tv_sec * kMicrosPerSecond + time_value.tv_usec;
+}
+
+void
+set_time_us(int64_t time_us)
+{
+    timeval time_value{(time_t)(time_us / kMicrosPerSecond), (suseconds_t)(time_us % kMicrosPerSecond)};
+    settimeofday(&time_value, nullptr);
+}
+
+void
+write_ntp_timestamp(uint8_t* buffer, uint64_t timestamp)
+{
+    for (int8_t i = 7; i >= 0; --i) {
+        buffer[i] = timestamp & 0xFF;
+        timestamp >>= 8;
+    }
+}
+
+uint64_t
+read_ntp_timestamp(uint8_t const* buffer)
+{
+    uint64_t result{0};
+    for (uint8_t i = 0; i < 8; ++i) {
+        result = (result << 8) | buffer[i];
+    }
+    return result;
+}
+
+// Convert NTP timestamp (seconds since 1900 in upper 32 bits and fraction of second in lower 32 bits) to microseconds
+// since 1970
+int64_t
+ntp_timestamp_to_us(uint64_t timestamp)
+{
+    int64_t seconds{(int64_t)(timestamp >> 32) - kNtpToUnixEpochOffsetS};
+    int64_t fraction_us{(int64_t)(((timestamp & 0xFFFFFFFF) * kMicrosPerSecond) >> 32)};
+    return seconds * kMicrosPerSecond + fraction_us;
+}
+
+}  // namespace
+
+ClockService::ClockService(unsigned long ntp_sync_period_ms, unsigned long rtc_sync_period_ms)
+  : ntp_sync_period_ms_{ntp_sync_period_ms}
+  , rtc_sync_period_ms_{rtc_sync_period_ms}
+  , ntp_request_period_ms_{ntp_sync_period_ms}
+{
+}
+
+void
+ClockService::setup()
+{
+    // At this moment system clock is not set at all, so it will be stepped
+    sync_from_rtc();
+    last_drift_compensation_time_ = millis();
+}
+
+void
+ClockService::loop()
+{
+    if ((millis() - last_drift_compensation_time_) >= kDriftCompensationPeriodMs) {
+        last_drift_compensation_time_ = millis();
+        compensate_drift();
+    }
+
+    if (!ntp_host_.isEmpty()) {
+        if (is_ntp_request_in_progress_) {
+            receive_ntp_response();
+        }
+        else if ((millis() - last_ntp_request_time_) >= ntp_request_period_ms_) {
+            send_ntp_request();
+        }
+    }
+
+    // Use RTC as reference only if NTP is not available
+    bool is_ntp_sync_valid{is_ntp_synced_ && ((millis() - last_ntp_sync_time_) < 2 * ntp_sync_period_ms_)};
+    if (!is_ntp_sync_valid && ((millis() - last_rtc_sync_time_) >= rtc_sync_period_ms_)) {
+        sync_from_rtc();
+    }
+}
+
+void
+ClockService::set_ntp_server(String const& host, uint16_t port, int32_t utc_offset_s)
+{
+    ntp_host_     = host;
+    ntp_port_     = port;
+    utc_offset_s_ = utc_offset_s;
+
+    udp_.stop();
+    is_ntp_request_in_progress_ = false;
+    if (!ntp_host_.isEmpty()) {
+        udp_.begin(kNtpLocalPort);
+        // Send first request in next loop()
+        ntp_request_period_ms_ = 0;
+    }
+}
+
+void
+ClockService::set_time_step_handler(TimeStepHandler handler)
+{
+    time_step_handler_ = handler;
+}
+
+void
+ClockService::set_time(time_t time)
+{
+    RTC.set(time);
+    set_time_us((int64_t)time * kMicrosPerSecond);
+
+    // Manually set time becomes new reference for drift estimation
+    last_correction_time_us_ = 0;
+    rtc_reference_time_us_   = 0;
+    last_rtc_sync_time_      = millis();
+
+    if (time_step_handler_ != nullptr) {
+        time_step_handler_();
+    }
+}
+
+time_t
+ClockService::get_time() const
+{
+    return time(nullptr);
+}
+
+float
+ClockService::get_system_drift_ppm() const
+{
+    return system_drift_ppm_;
+}
+
+float
+ClockService::get_rtc_drift_ppm() const
+{
+    return rtc_drift_ppm_;
+}
+
+void
+ClockService::send_ntp_request()
+{
+    last_ntp_request_time_ = millis();
+
+    uint8_t packet[kNtpPacketSize] = {0};
+    packet[0]                      = 0b00011011;  // LI = 0 (no warning), VN = 3 (version), Mode = 3 (client)
+
+    // Server copies transmit timestamp of request to originate timestamp of response. Put there local time of sending
+    // request to identify response
+    ntp_request_time_us_ = get_time_us();
+    write_ntp_timestamp(packet + 40, (uint64_t)ntp_request_time_us_);
+
+    if (!udp_.beginPacket(ntp_host_.c_str(), ntp_port_) || (udp_.write(packet, kNtpPacketSize) != kNtpPacketSize) ||
+        !udp_.endPacket()) {
+        DEBUG_PRINTLN(String{"ERROR: can not send request to NTP server "} + ntp_host_);
+        ntp_request_period_ms_ = kNtpRetryPeriodMs;
+        return;
+    }
+    is_ntp_request_in_progress_ = true;
+}
+
+void
+ClockService::receive_ntp_response()
+{
+    if (udp_.parsePacket() < kNtpPacketSize) {
+        if ((millis() - last_ntp_request_time_) >= kNtpResponseTimeoutMs) {
+            DEBUG_PRINTLN(String{"ERROR: no response from NTP server "} + ntp_host_);
+            is_ntp_request_in_progress_ = false;
+            ntp_request_period_ms_      = kNtpRetryPeriodMs;
+        }
+        return;
+    }
+
+    int64_t receive_time_us{get_time_us()};
+    uint8_t packet[kNtpPacketSize];
+    udp_.read(packet, kNtpPacketSize);
+    udp_.flush();
+
+    uint8_t leap_indicator{(uint8_t)(packet[0] >> 6)};
+    uint8_t mode{(uint8_t)(packet[0] & 0x07)};
+    uint8_t stratum{packet[1]};
+    if ((mode != 4) || (stratum == 0) || (leap_indicator == 3) ||
+        (read_ntp_timestamp(packet + 24) != (uint64_t)ntp_request_time_us_)) {
+        // Not a response for our request or server is not synchronized. Keep waiting for correct response till timeout
+        return;
+    }
+    is_ntp_request_in_progress_ = false;
+    ntp_request_period_ms_      = ntp_sync_period_ms_;
+
+    int64_t utc_offset_us{(int64_t)utc_offset_s_ * kMicrosPerSecond};
+    int64_t server_receive_time_us{ntp_timestamp_to_us(read_ntp_timestamp(packet + 32)) + utc_offset_us};
+    int64_t server_transmit_time_us{ntp_timestamp_to_us(read_ntp_timestamp(packet + 40)) + utc_offset_us};
+
+    // Standard NTP clock offset calculation. It compensates network delay, assuming that it is symmetric
+    int64_t offset_us{((server_receive_time_us - ntp_request_time_us_) + (server_transmit_time_us - receive_time_us)) /
+                      2};
+    DEBUG_PRINTLN(String{"NTP offset (ms): "} + String{(long)(offset_us / 1000)} +
+                  "; system clock drift (ppm): " + String(system_drift_ppm_, 2));
+
+    // Slew of system clock takes time, so RTC is checked against NTP time, not against system clock
+    int64_t ntp_time_us{get_time_us() + offset_us};
+    correct_system_clock(offset_us);
+    is_ntp_synced_      = true;
+    last_ntp_sync_time_ = millis();
+    check_rtc(ntp_time_us);
+}
+
+void
+ClockService::sync_from_rtc()
+{
+    last_rtc_sync_time_ = millis();
+
+    auto rtc_time = RTC.get();  // Returns 0 in case of error
+    if (rtc_time == 0) {
+        DEBUG_PRINTLN("ERROR: can not read time from RTC");
+        return;
+    }
+
+    // RTC has resolution of 1 second, so in average its time is 0.5 s later than read value
+    int64_t offset_us{(int64_t)rtc_time * kMicrosPerSecond + kMicrosPerSecond / 2 - get_time_us()};
+    if ((offset_us > -kRtcMaxErrorS * kMicrosPerSecond) && (offset_us < kRtcMaxErrorS * kMicrosPerSecond)) {
+        return;
+    }
+    correct_system_clock(offset_us);
+}
+
+void
+ClockService::check_rtc(int64_t now_us)
+{
+    auto rtc_time = RTC.get();  // Returns 0 in case of error
+    if (rtc_time == 0) {
+        DEBUG_PRINTLN("ERROR: can not read time from RTC");
+        return;
+    }
+
+    int32_t rtc_error_s{(int32_t)(rtc_time - (time_t)(now_us / kMicrosPerSecond))};
+    if (rtc_reference_time_us_ == 0) {
+        rtc_reference_time_us_ = now_us;
+        rtc_reference_error_s_ = rtc_error_s;
+    }
+    else if (now_us > rtc_reference_time_us_) {
+        rtc_drift_ppm_ = (float)(rtc_error_s - rtc_reference_error_s_) * kMicrosPerSecond * kMicrosPerSecond /
+                         (float)(now_us - rtc_reference_time_us_);
+    }
+
+    if ((rtc_error_s >= kRtcMaxErrorS) || (rtc_error_s <= -kRtcMaxErrorS)) {
+        DEBUG_PRINTLN(String{"RTC error is "} + String{rtc_error_s} + " s (drift " + String(rtc_drift_ppm_, 2) +
+                      " ppm). Writing time to RTC");
+        RTC.set((time_t)(now_us / kMicrosPerSecond));
+        rtc_reference_time_us_ = 0;
+    }
+}
+
+void
+ClockService::correct_system_clock(int64_t offset_us)
+{
+    int64_t now_us{get_time_us()};
+
+    if ((offset_us > kMaxSlewOffsetUs) || (offset_us < -kMaxSlewOffsetUs)) {
+        DEBUG_PRINTLN(String{"Stepping system clock by "} + String{(long)(offset_us / kMicrosPerSecond)} + " s");
+        set_time_us(now_us + offset_us);
+        last_correction_time_us_ = 0;  // Previous measurements are not relevant anymore
+        if (time_step_handler_ != nullptr) {
+            time_step_handler_();
+        }
+        return;
+    }
+
+    // Offset, remaining after drift compensation, is used to refine estimation of drift
+    if ((last_correction_time_us_ != 0) && (now_us > last_correction_time_us_)) {
+        system_drift_ppm_ += kDriftEstimationGain * (float)offset_us * kMicrosPerSecond /
+                             (float)(now_us - last_correction_time_us_);
+        system_drift_ppm_ = constrain(system_drift_ppm_, -kMaxDriftPpm, kMaxDriftPpm);
+    }
+    last_correction_time_us_ = now_us + offset_us;
+
+    // Replace any pending adjustment, because offset is measured relatively to current time
+    timeval delta{(time_t)(offset_us / kMicrosPerSecond), (suseconds_t)(offset_us % kMicrosPerSecond)};
+    adjtime(&delta, nullptr);
+}
+
+void
+ClockService::compensate_drift()
+{
+    if (system_drift_ppm_ == 0.0f) {
+        return;
+    }
+
+    // Add drift for the last period to pending adjustment
+    timeval pending;
+    adjtime(nullptr, &pending);
+    int64_t delta_us{(int64_t)pending.tv_sec * kMicrosPerSecond + pending.tv_usec +
+                     (int64_t)(system_drift_ppm_ * kDriftCompensationPeriodMs / 1000)};
+    timeval delta{(time_t)(delta_us / kMicrosPerSecond), (suseconds_t)(delta_us % kMicrosPerSecond)};
+    adjtime(&delta, nullptr);
+}
@@ -0,0 +1,71 @@
+#ifndef SRC_CONTROL_CLOCKSERVICE_H_
+#define SRC_CONTROL_CLOCKSERVICE_H_
+
+#include <functional>
+
+#include <TimeLib.h>
+#include <WString.h>
+#include <WiFiUdp.h>
+
+// Keeps ESP's system clock in sync with reference time. Reference is NTP server (if it is configured and reachable),
+// otherwise RTC (DS1307).
+// Small errors are corrected smoothly by slewing system clock (adjtime()), so time never jumps under alarm scheduler.
+// Only big errors (ex. at first synchronization) are corrected by step, in this case time step handler is called.
+// Drift of system clock is estimated from consecutive NTP measurements and compensated between them. Drift of RTC is
+// estimated as well, but RTC is written only when its error exceeds threshold, to reduce amount of RTC writes.
+class ClockService
+{
+public:
+    using TimeStepHandler = std::function<void()>;
+
+    ClockService(unsigned long ntp_sync_period_ms = 60 * 60 * 1000, unsigned long rtc_sync_period_ms = 60 * 60 * 1000);
+    void setup();
+    void loop();
+
+    // Empty host disables NTP synchronization. utc_offset_s is offset of local time (which is kept in RTC) from UTC
+    void set_ntp_server(String const& host, uint16_t port = 123, int32_t utc_offset_s = 0);
+    void set_time_step_handler(TimeStepHandler handler);
+
+    // Set time manually. It is written to RTC and system clock is stepped
+    void   set_time(time_t time);
+    time_t get_time() const;
+
+    float get_system_drift_ppm() const;
+    float get_rtc_drift_ppm() const;
+
+private:
+    void send_ntp_request();
+    void receive_ntp_response();
+    void sync_from_rtc();
+    void check_rtc(int64_t now_us);
+    void correct_system_clock(int64_t offset_us);
+    void compensate_drift();
+
+    const unsigned long ntp_sync_period_ms_;
+    const unsigned long rtc_sync_period_ms_;
+    TimeStepHandler     time_step_handler_{nullptr};
+
+    String   ntp_host_;
+    uint16_t ntp_port_{123};
+    int32_t  utc_offset_s_{0};
+    WiFiUDP  udp_;
+
+    bool          is_ntp_request_in_progress_{false};
+    int64_t       ntp_request_time_us_{0};  // Local time when request was sent, also used to identify response
+    unsigned long last_ntp_request_time_{0};
+    unsigned long ntp_request_period_ms_{0};  // Shorter than ntp_sync_period_ms_ if last request failed
+    unsigned long last_ntp_sync_time_{0};
+    bool          is_ntp_synced_{false};
+
+    unsigned long last_rtc_sync_time_{0};
+    unsigned long last_drift_compensation_time_{0};
+
+    // Drift estimation
+    int64_t last_correction_time_us_{0};  // Local time of last correction by reference
+    float   system_drift_ppm_{0.0f};      // Positive value means that system clock is slow
+    int64_t rtc_reference_time_us_{0};  // Local time, when RTC error was measured first time after RTC was written
+    int32_t rtc_reference_error_s_{0};
+    float   rtc_drift_ppm_{0.0f};  // Positive value means that RTC is fast
+};
+
+#endif  // SRC_CONTROL_CLOCKSERVICE_H_
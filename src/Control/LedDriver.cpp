@@ -7,8 +7,6 @@
 
 namespace
 {
-constexpr uint16_t kDefaultSunraiseDurationMinutes{15};
-
 // TODO: there are many different options on dimming functions:
 //       https://blog.moonsindustries.com/2018/12/02/what-are-dimming-curves-and-how-to-choose/)
 //       Most popular (should try):
@@ -74,23 +72,26 @@ LedDriver::LedDriver(uint8_t pin, uint32_t pwm_frequency, uint32_t updating_peri
   , sunrise_duration_sec_{0}
   , current_brightness_{0}
   , thermal_factor_{1.0}
+  , timer_id_{Utils::TimerWheel::kInvalidId}
 {
 }
 
+LedDriver::~LedDriver()
+{
+    Utils::TimerWheel::instance().remove(timer_id_);
+}
+
 void
 LedDriver::setup()
 {
     pwm_.setup();
 
-    if (!Persistency::instance().is_variable_stored(Persistency::kSunraiseDurationMinutes)) {
-        DEBUG_PRINTLN(String{"Setting initial value of kSunraiseDurationMinutes to "} +
-                      String{kDefaultSunraiseDurationMinutes});
-        Persistency::instance().set_word(Persistency::kSunraiseDurationMinutes, kDefaultSunraiseDurationMinutes);
-    }
-
-    uint16_t duration_min{Persistency::instance().get_word(Persistency::kSunraiseDurationMinutes)};
+    uint16_t duration_min{Persistency::instance().get<Persistency::kSunraiseDurationMinutes>()};
     set_sunrise_duration(duration_min);
     set_brightness_manually(0.0);
+    // Smoothness of sunrise is the most visible, so it goes first
+    timer_id_ = Utils::TimerWheel::instance().add("led_driver", adjusted_updating_period_ms_, 0,
+                                                  Utils::TimerWheel::Priority::kHigh, [this]() { run_sunrise(); });
 
     DEBUG_PRINTLN(String{"Read from Persistency: sunrise duration "} + String{duration_min} + " minutes");
 }
@@ -102,15 +103,7 @@ LedDriver::run_sunrise()
         return;
     }
 
-    // Do not execute too often
-    static unsigned long last_updating_time{0};
-    auto                 now = millis();
-    if ((now - last_updating_time) < adjusted_updating_period_ms_) {
-        return;
-    }
-    last_updating_time = now;
-
-    unsigned long delta_time_ms{(now - sunrise_start_time_)};
+    unsigned long delta_time_ms{(millis() - sunrise_start_time_)};
     if (delta_time_ms >= (sunrise_duration_sec_ * 1000)) {
         // Sunrise is finished
         set_brightness_manually(1.0);  // Keep lamp turned on
@@ -184,6 +177,7 @@ LedDriver::set_sunrise_duration(uint16_t duration_m)
     // persiod. In this case each update we will switch to new level.
     unsigned long new_duration_of_each_level_ms{(sunrise_duration_sec_ * 1000) / kMaxNumOfBrightnessLevels};
     adjusted_updating_period_ms_ = std::min(initial_updating_period_ms_, new_duration_of_each_level_ms);
+    Utils::TimerWheel::instance().set_period(timer_id_, adjusted_updating_period_ms_);
 }
 
 float
@@ -5,14 +5,17 @@
 #include <stdint.h>
 
 #include "Pwm.h"
+#include "src/Utils/TimerWheel.h"
 
-// Controls current driver for powerful LED
+// Controls current driver for powerful LED. Brightness during sunrise is updated by TimerWheel
 class LedDriver
 {
 public:
     LedDriver(uint8_t pin, uint32_t pwm_frequency, uint32_t updating_period_ms = 1000);
+    LedDriver(LedDriver const&) = delete;
+    LedDriver& operator=(LedDriver const&) = delete;
+    ~LedDriver();
     void setup();
-    void run_sunrise();
 
     void set_sunrise_duration(uint16_t duration_m);
 
@@ -23,6 +26,7 @@ public:
     void stop_sunrise();
 
 private:
+    void     run_sunrise();
     float    map_sunrise_time_to_level(uint32_t delta_time_ms);
     float    map_manual_control_to_level(float manual_level);
     uint16_t brightness_to_pwm_duty(float level);
@@ -36,6 +40,7 @@ private:
     uint32_t                 sunrise_duration_sec_;
     float                    current_brightness_;
     float                    thermal_factor_;
+    Utils::TimerWheel::Id    timer_id_;
 };
 
 #endif  // SRC_CONTROL_LED_DRIVER_H_
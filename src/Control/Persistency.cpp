@@ -1,50 +1,59 @@
 #include "Persistency.h"
 
+#include <utility>
+
+#include <rom/crc.h>
+
 #include "src/Utils/Logger.h"
 
 namespace
 {
-// NOTE !!! KEYS MUST BE MAX 15 CHARS !!!
-constexpr char kAlarmDowKey[]                = "AlarmDow";
-constexpr char kAlarmMinutesKey[]            = "AlarmMinute";
-constexpr char kAlarmHoursKey[]              = "AlarmHours";
-constexpr char kIsAlarmOnKey[]               = "IsAlarmOn";
-constexpr char kSunraiseDurationMinutesKey[] = "SunrDurMins";
-constexpr char kFanPwmFrequencyKey[]         = "FanPwmFreq";
-constexpr char kFanPwmStepsNumberKey[]       = "FanPwmStepsNum";
-constexpr char kPotentiometerMinValKey[]     = "PotMinVal";
-constexpr char kPotentiometerMaxValKey[]     = "PotMaxVal";
-
-const char*
-var_to_key(Persistency::Variable variable)
-{
-    switch (variable) {
-    case Persistency::Variable::kAlarmDow:
-        return kAlarmDowKey;
-    case Persistency::Variable::kAlarmMinutes:
-        return kAlarmMinutesKey;
-    case Persistency::Variable::kAlarmHours:
-        return kAlarmHoursKey;
-    case Persistency::Variable::kIsAlarmOn:
-        return kIsAlarmOnKey;
-    case Persistency::Variable::kFanPwmStepsNumber:
-        return kFanPwmStepsNumberKey;
-    case Persistency::Variable::kSunraiseDurationMinutes:
-        return kSunraiseDurationMinutesKey;
-    case Persistency::Variable::kFanPwmFrequency:
-        return kFanPwmFrequencyKey;
-    case Persistency::Variable::kPotentiometerMinVal:
-        return kPotentiometerMinValKey;
-    case Persistency::Variable::kPotentiometerMaxVal:
-        return kPotentiometerMaxValKey;
-    default:
-        return nullptr;
-    }
-    return nullptr;
+// Blob: format version (1 byte), generation (4 bytes), mask of stored variables (2 bytes), values of stored variables
+// in order of kVariables (byte - 1 byte, word - 2 bytes, binary blob - 2 bytes of size and data), CRC32 (4 bytes).
+// All numbers are little-endian
+constexpr uint8_t     kBlobFormatVersion{1};
+constexpr size_t      kBlobHeaderSize{7};
+constexpr size_t      kBlobCrcSize{4};
+constexpr char const* kSlotKeys[2] = {"VarsA", "VarsB"};
+
+// Make sure that kVariables table can be indexed by Variable
+constexpr bool
+is_variables_table_ordered(uint8_t index = 0)
+{
+    return (index == Persistency::kNumOfVariables) ||
+           ((Persistency::kVariables[index].variable == index) && is_variables_table_ordered(index + 1));
+}
+static_assert(is_variables_table_ordered(), "Persistency::kVariables must be ordered as Persistency::Variable");
+static_assert(Persistency::kNumOfVariables <= 16, "Mask of stored variables is 16 bits");
+
+void
+append_le(std::vector<uint8_t>& blob, uint32_t value, uint8_t size)
+{
+    for (uint8_t i = 0; i < size; ++i) {
+        blob.push_back((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// Return false if there is not enough data in blob
+bool
+read_le(std::vector<uint8_t> const& blob, size_t& offset, uint8_t size, uint32_t& value)
+{
+    if (offset + size > blob.size()) {
+        return false;
+    }
+    value = 0;
+    for (uint8_t i = 0; i < size; ++i) {
+        value |= (uint32_t)blob[offset + i] << (8 * i);
+    }
+    offset += size;
+    return true;
 }
 
 }  // namespace
 
+constexpr Persistency::VariableInfo Persistency::kVariables[];
+constexpr unsigned long             Persistency::kCommitDelayMs;
+
 Persistency&
 Persistency::instance()
 {
@@ -55,106 +64,343 @@ Persistency::instance()
 Persistency::Persistency()
 {
     preferences.begin("SadLamp", false);
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        cache_[i].value = kVariables[i].default_value;
+    }
+
+    // Take the latest valid version of blob. If the latest write was interrupted, this is rollback to previous version
+    bool is_loaded{false};
+    bool is_corrupted{false};
+    for (uint8_t slot = 0; slot < 2; ++slot) {
+        if (!preferences.isKey(kSlotKeys[slot])) {
+            continue;
+        }
+        Variables variables;
+        uint32_t  generation{0};
+        if (!load_slot(slot, variables, generation)) {
+            DEBUG_PRINTLN(String{"ERROR: Persistency slot '"} + kSlotKeys[slot] + "' is corrupted");
+            is_corrupted = true;
+            continue;
+        }
+        if (!is_loaded || (generation > generation_)) {
+            cache_      = std::move(variables);
+            generation_ = generation;
+            is_loaded   = true;
+        }
+    }
+
+    if (!is_loaded) {
+        // 1st run or migration from variables, stored under separate keys
+        load_legacy();
+    }
+    else if (is_corrupted) {
+        // Next commit overwrites corrupted slot, because it goes to slot of generation_ + 1
+        DEBUG_PRINTLN(String{"Persistency is rolled back to version "} + String{generation_});
+    }
 }
 
 Persistency::~Persistency()
 {
+    commit();
     preferences.end();
 }
 
-uint8_t
-Persistency::get_byte(Variable variable)
-{
-    switch (variable) {
-    case kAlarmDow:
-        return preferences.getUChar(kAlarmDowKey);
-    case kAlarmMinutes:
-        return preferences.getUChar(kAlarmMinutesKey);
-    case kAlarmHours:
-        return preferences.getUChar(kAlarmHoursKey);
-    case kIsAlarmOn:
-        return preferences.getUChar(kIsAlarmOnKey);
-    case kFanPwmStepsNumber:
-        return preferences.getUChar(kFanPwmStepsNumberKey);
-    default:
-        DEBUG_PRINTLN(String{"ERROR: can not read byte for variable '"} + String{(int)variable} + "'");
-        return 0;
+bool
+Persistency::is_variable_stored(Variable variable) const
+{
+    return cache_[variable].is_stored;
+}
+
+void
+Persistency::clear()
+{
+    preferences.clear();
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        cache_[i]       = CachedVariable{};
+        cache_[i].value = kVariables[i].default_value;
+    }
+    generation_ = 0;
+    is_dirty_   = false;
+}
+
+bool
+Persistency::commit(Transaction& transaction)
+{
+    if (!transaction.is_valid_ || transaction.is_committed_) {
+        DEBUG_PRINTLN("ERROR: can not commit invalid transaction");
+        return false;
+    }
+    if (transaction.staged_mask_ == 0) {
+        transaction.is_committed_ = true;
+        return true;
+    }
+
+    // Staged values are applied to copy of cache. Cache is changed only when they are written to NVS
+    Variables variables{cache_};
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        if ((transaction.staged_mask_ & (1 << i)) != 0) {
+            variables[i].value     = transaction.variables_[i].value;
+            variables[i].bytes     = transaction.variables_[i].bytes;
+            variables[i].is_stored = true;
+        }
+    }
+    if (!write(variables)) {
+        return false;
     }
+    cache_                    = std::move(variables);
+    is_dirty_                 = false;  // Pending changes of cache are written too
+    transaction.is_committed_ = true;
+    return true;
+}
+
+std::vector<uint8_t>
+Persistency::export_snapshot() const
+{
+    std::vector<uint8_t> snapshot;
+    serialize(cache_, generation_, snapshot);
+    return snapshot;
+}
+
+bool
+Persistency::import_snapshot(std::vector<uint8_t> const& snapshot)
+{
+    Variables variables;
+    uint32_t  generation{0};  // Generation of other lamp is not relevant here
+    if (!deserialize(snapshot, variables, generation)) {
+        DEBUG_PRINTLN("ERROR: can not import invalid snapshot of Persistency");
+        return false;
+    }
+
+    if (!write(variables)) {
+        return false;
+    }
+    cache_    = std::move(variables);
+    is_dirty_ = false;
+    return true;
 }
 
 void
-Persistency::set_byte(Variable variable, uint8_t value)
-{
-    switch (variable) {
-    case kAlarmDow:
-        preferences.putUChar(kAlarmDowKey, value);
-        break;
-    case kAlarmMinutes:
-        preferences.putUChar(kAlarmMinutesKey, value);
-        break;
-    case kAlarmHours:
-        preferences.putUChar(kAlarmHoursKey, value);
-        break;
-    case kIsAlarmOn:
-        preferences.putUChar(kIsAlarmOnKey, value);
-        break;
-    case kFanPwmStepsNumber:
-        preferences.putUChar(kFanPwmStepsNumberKey, value);
-        break;
-    default:
-        DEBUG_PRINTLN(String{"ERROR: can not write byte for variable '"} + String{(int)variable} + "'");
-        break;
-    }
-}
-
-uint16_t
-Persistency::get_word(Variable variable)
-{
-    switch (variable) {
-    case kSunraiseDurationMinutes:
-        return preferences.getUShort(kSunraiseDurationMinutesKey);
-    case kFanPwmFrequency:
-        return preferences.getUShort(kFanPwmFrequencyKey);
-    case kPotentiometerMinVal:
-        return preferences.getUShort(kPotentiometerMinValKey);
-    case kPotentiometerMaxVal:
-        return preferences.getUShort(kPotentiometerMaxValKey);
-    default:
-        DEBUG_PRINTLN(String{"ERROR: can not read word for variable '"} + String{(int)variable} + "'");
+Persistency::loop()
+{
+    // Wait till changes are over
+    if (is_dirty_ && ((millis() - last_change_time_) >= kCommitDelayMs)) {
+        commit();
+    }
+}
+
+void
+Persistency::commit()
+{
+    if (!is_dirty_) {
+        return;
+    }
+
+    if (!write(cache_)) {
+        // Keep changes to retry on next commit
+        last_change_time_ = millis();
+        return;
+    }
+    is_dirty_ = false;
+}
+
+bool
+Persistency::write(Variables const& variables)
+{
+    // Write to slot with older version, so the latest good version stays untouched. Generation is increased only after
+    // successful write: failed write may corrupt that slot, and the next attempt should go to the same slot again
+    uint32_t             generation{generation_ + 1};
+    std::vector<uint8_t> blob;
+    serialize(variables, generation, blob);
+
+    auto key = kSlotKeys[generation % 2];
+    if (preferences.putBytes(key, blob.data(), blob.size()) != blob.size()) {
+        DEBUG_PRINTLN(String{"ERROR: can not write Persistency slot '"} + key + "' to NVS");
+        return false;
+    }
+    generation_ = generation;
+    return true;
+}
+
+bool
+Persistency::is_in_range(Variable variable, uint16_t value)
+{
+    if ((value < kVariables[variable].min_value) || (value > kVariables[variable].max_value)) {
+        DEBUG_PRINTLN(String{"ERROR: value "} + String{value} + " is out of range for variable '" +
+                      kVariables[variable].key + "'");
+        return false;
+    }
+    return true;
+}
+
+bool
+Persistency::set_value(Variable variable, uint16_t value)
+{
+    if (!is_in_range(variable, value)) {
+        return false;
+    }
+    if (cache_[variable].is_stored && (cache_[variable].value == value)) {
+        return true;
+    }
+    cache_[variable].value     = value;
+    cache_[variable].is_stored = true;
+    mark_dirty();
+    return true;
+}
+
+size_t
+Persistency::get_bytes(Variable variable, void* buffer, size_t size) const
+{
+    auto const& bytes = cache_[variable].bytes;
+    if (bytes.size() > size) {
+        // Do the same as Preferences: do not read anything if buffer is too small
         return 0;
     }
+    memcpy(buffer, bytes.data(), bytes.size());
+    return bytes.size();
+}
+
+size_t
+Persistency::set_bytes(Variable variable, void const* buffer, size_t size)
+{
+    auto& bytes = cache_[variable].bytes;
+    if (cache_[variable].is_stored && (bytes.size() == size) && (memcmp(bytes.data(), buffer, size) == 0)) {
+        return size;
+    }
+    bytes.assign((uint8_t const*)buffer, (uint8_t const*)buffer + size);
+    cache_[variable].is_stored = true;
+    mark_dirty();
+    return size;
+}
+
+bool
+Persistency::load_slot(uint8_t slot, Variables& variables, uint32_t& generation)
+{
+    std::vector<uint8_t> blob(preferences.getBytesLength(kSlotKeys[slot]));
+    if (blob.empty() || (preferences.getBytes(kSlotKeys[slot], blob.data(), blob.size()) != blob.size())) {
+        return false;
+    }
+    return deserialize(blob, variables, generation);
+}
+
+void
+Persistency::load_legacy()
+{
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        auto& cached_variable = cache_[i];
+        auto  key             = kVariables[i].key;
+        if (!preferences.isKey(key)) {
+            continue;
+        }
+
+        uint16_t value{kVariables[i].default_value};
+        switch (kVariables[i].type) {
+        case Type::kByte:
+            value = preferences.getUChar(key, value);
+            break;
+        case Type::kWord:
+            value = preferences.getUShort(key, value);
+            break;
+        case Type::kBytes:
+            cached_variable.bytes.resize(preferences.getBytesLength(key));
+            preferences.getBytes(key, cached_variable.bytes.data(), cached_variable.bytes.size());
+            break;
+        }
+        if ((kVariables[i].type != Type::kBytes) && !is_in_range(static_cast<Variable>(i), value)) {
+            continue;
+        }
+        cached_variable.value     = value;
+        cached_variable.is_stored = true;
+
+        // Write all found variables as blob. Old keys are left untouched and are not used anymore
+        is_dirty_ = true;
+    }
 }
 
 void
-Persistency::set_word(Variable variable, uint16_t value)
-{
-    switch (variable) {
-    case kSunraiseDurationMinutes:
-        preferences.putUShort(kSunraiseDurationMinutesKey, value);
-        break;
-    case kFanPwmFrequency:
-        preferences.putUShort(kFanPwmFrequencyKey, value);
-        break;
-    case kPotentiometerMinVal:
-        preferences.putUShort(kPotentiometerMinValKey, value);
-        break;
-    case kPotentiometerMaxVal:
-        preferences.putUShort(kPotentiometerMaxValKey, value);
-        break;
-    default:
-        DEBUG_PRINTLN(String{"ERROR: can not write word for variable '"} + String{(int)variable} + "'");
-        break;
+Persistency::serialize(Variables const& variables, uint32_t generation, std::vector<uint8_t>& blob) const
+{
+    uint16_t stored_mask{0};
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        if (variables[i].is_stored) {
+            stored_mask |= (1 << i);
+        }
     }
+
+    blob.push_back(kBlobFormatVersion);
+    append_le(blob, generation, 4);
+    append_le(blob, stored_mask, 2);
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        if (!variables[i].is_stored) {
+            continue;
+        }
+        switch (kVariables[i].type) {
+        case Type::kByte:
+            append_le(blob, variables[i].value, 1);
+            break;
+        case Type::kWord:
+            append_le(blob, variables[i].value, 2);
+            break;
+        case Type::kBytes:
+            append_le(blob, variables[i].bytes.size(), 2);
+            blob.insert(blob.end(), variables[i].bytes.begin(), variables[i].bytes.end());
+            break;
+        }
+    }
+    append_le(blob, crc32_le(0, blob.data(), blob.size()), kBlobCrcSize);
 }
 
 bool
-Persistency::is_variable_stored(Variable variable)
+Persistency::deserialize(std::vector<uint8_t> const& blob, Variables& variables, uint32_t& generation) const
 {
-    return preferences.isKey(var_to_key(variable));
+    if ((blob.size() < kBlobHeaderSize + kBlobCrcSize) || (blob[0] != kBlobFormatVersion)) {
+        return false;
+    }
+    size_t   offset{blob.size() - kBlobCrcSize};
+    uint32_t crc{0};
+    read_le(blob, offset, kBlobCrcSize, crc);
+    if (crc != crc32_le(0, blob.data(), blob.size() - kBlobCrcSize)) {
+        return false;
+    }
+
+    offset = 1;
+    uint32_t stored_mask{0};
+    read_le(blob, offset, 4, generation);
+    read_le(blob, offset, 2, stored_mask);
+    for (uint8_t i = 0; i < kNumOfVariables; ++i) {
+        variables[i].value = kVariables[i].default_value;
+        if ((stored_mask & (1 << i)) == 0) {
+            continue;
+        }
+
+        uint32_t value{0};
+        switch (kVariables[i].type) {
+        case Type::kByte:
+        case Type::kWord:
+            if (!read_le(blob, offset, (kVariables[i].type == Type::kByte) ? 1 : 2, value)) {
+                return false;
+            }
+            // Range could be narrowed by new firmware
+            if (!is_in_range(static_cast<Variable>(i), value)) {
+                continue;
+            }
+            variables[i].value = value;
+            break;
+        case Type::kBytes:
+            if (!read_le(blob, offset, 2, value) || (offset + value > blob.size() - kBlobCrcSize)) {
+                return false;
+            }
+            variables[i].bytes.assign(blob.begin() + offset, blob.begin() + offset + value);
+            offset += value;
+            break;
+        }
+        variables[i].is_stored = true;
+    }
+    return true;
 }
 
 void
-Persistency::clear()
+Persistency::mark_dirty()
 {
-    preferences.clear();
+    is_dirty_         = true;
+    last_change_time_ = millis();
 }
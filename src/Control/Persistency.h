@@ -1,24 +1,83 @@
 #ifndef SRC_CONTROL_PERSISTENCY_H_
 #define SRC_CONTROL_PERSISTENCY_H_
 
+#include <array>
+#include <vector>
+
 #include <Preferences.h>
 
+// All variables are read from NVS once, at construction, and then are served from RAM. Changes are also done in RAM
+// and are written to NVS by commit(). It is called automatically by loop() when there were no changes during
+// commit delay, so series of changes results in single write. Writing of unchanged value doesn't mark it as changed.
+//
+// Every variable is described once, in kVariables table: its NVS key, type, default value and valid range. Type of
+// variable is checked at compile time by get<>()/set<>(). If variable is not stored in NVS (or stored value is out of
+// range), its default value is used.
+//
+// All variables are written to NVS as single versioned blob, protected by CRC. Blob is written to 2 slots in turn, so
+// if last write was interrupted (ex. by power loss), previous good version is loaded at boot. So, it is not possible
+// to observe only part of changes, done between commits. Related variables, which should be changed together, can be
+// changed by Transaction: either all changes are applied and written to NVS immediately, either none of them.
 class Persistency
 {
 public:
+    class Transaction;
+
     enum Variable : uint8_t
     {
-        kAlarmDow,                 // 1 byte
-        kAlarmMinutes,             // 1 byte
-        kAlarmHours,               // 1 byte
-        kIsAlarmOn,                // 1 byte
-        kSunraiseDurationMinutes,  // 2 bytes
-        kFanPwmFrequency,          // 2 bytes
-        kFanPwmStepsNumber,        // 1 byte
-        kPotentiometerMinVal,      // 2 bytes
-        kPotentiometerMaxVal       // 2 bytes
+        kAlarmDow,
+        kAlarmMinutes,
+        kAlarmHours,
+        kIsAlarmOn,
+        kSunraiseDurationMinutes,
+        kFanPwmFrequency,
+        kFanPwmStepsNumber,
+        kPotentiometerMinVal,
+        kPotentiometerMaxVal,
+        kAlarms,
+
+        kNumOfVariables
     };
 
+    enum class Type : uint8_t
+    {
+        kByte,
+        kWord,
+        kBytes  // Binary blob
+    };
+
+    template <Type type>
+    struct ValueType;
+
+    struct VariableInfo
+    {
+        Variable    variable;
+        char const* key;  // NOTE !!! KEYS MUST BE MAX 15 CHARS !!!
+        Type        type;
+        uint16_t    default_value;
+        uint16_t    min_value;
+        uint16_t    max_value;
+    };
+
+    // clang-format off
+    static constexpr VariableInfo kVariables[kNumOfVariables] = {
+        // Variable                Key               Type          Default  Min   Max
+        {kAlarmDow,                "AlarmDow",       Type::kByte,  0,       0,    0x7F},
+        {kAlarmMinutes,            "AlarmMinute",    Type::kByte,  0,       0,    59},
+        {kAlarmHours,              "AlarmHours",     Type::kByte,  0,       0,    23},
+        {kIsAlarmOn,               "IsAlarmOn",      Type::kByte,  0,       0,    1},
+        {kSunraiseDurationMinutes, "SunrDurMins",    Type::kWord,  15,      0,    24 * 60},
+        {kFanPwmFrequency,         "FanPwmFreq",     Type::kWord,  0,       0,    0xFFFF},
+        {kFanPwmStepsNumber,       "FanPwmStepsNum", Type::kByte,  0,       0,    0xFF},
+        {kPotentiometerMinVal,     "PotMinVal",      Type::kWord,  625,     0,    4095},  // 0.5V
+        {kPotentiometerMaxVal,     "PotMaxVal",      Type::kWord,  3000,    0,    4095},  // 2.4V
+        {kAlarms,                  "Alarms",         Type::kBytes, 0,       0,    0}
+    };
+    // clang-format on
+
+    template <Variable variable>
+    using ValueOf = typename ValueType<kVariables[variable].type>::Type;
+
     Persistency(Persistency const&) = delete;
     Persistency(Persistency&&)      = delete;
     Persistency& operator=(Persistency const&) = delete;
@@ -26,19 +85,156 @@ public:
 
     static Persistency& instance();
 
-    uint8_t  get_byte(Variable variable);
-    void     set_byte(Variable variable, uint8_t value);
-    uint16_t get_word(Variable variable);
-    void     set_word(Variable variable, uint16_t value);
+    template <Variable variable>
+    ValueOf<variable> get() const;
+    // Return false if value is out of valid range
+    template <Variable variable>
+    bool set(ValueOf<variable> value);
 
-    bool is_variable_stored(Variable variable);
+    // Return amount of bytes, actually read/written
+    template <Variable variable>
+    size_t get_bytes(void* buffer, size_t size) const;
+    template <Variable variable>
+    size_t set_bytes(void const* buffer, size_t size);
+
+    bool is_variable_stored(Variable variable) const;
     void clear();
 
+    // Apply all changes, staged in transaction, and write them to NVS. Return false (and apply nothing) if any of
+    // staged values is invalid, transaction is already committed or it can not be written to NVS. In the last case
+    // transaction can be committed again
+    bool commit(Transaction& transaction);
+
+    // Snapshot contains all variables in the same format, as they are stored in NVS. It is used to clone configuration
+    // from one lamp to another
+    std::vector<uint8_t> export_snapshot() const;
+    // Replace all variables with ones from snapshot and write them to NVS immediately. Return false (and change
+    // nothing) if snapshot is invalid or can not be written to NVS
+    bool import_snapshot(std::vector<uint8_t> const& snapshot);
+
+    void loop();
+    // Write all changed variables to NVS immediately
+    void commit();
+
 private:
+    struct CachedVariable
+    {
+        uint16_t             value{0};
+        std::vector<uint8_t> bytes;
+        bool                 is_stored{false};
+    };
+    using Variables = std::array<CachedVariable, kNumOfVariables>;
+
     Persistency();
     ~Persistency();
 
-    Preferences preferences;
+    static bool is_in_range(Variable variable, uint16_t value);
+
+    bool   set_value(Variable variable, uint16_t value);
+    size_t get_bytes(Variable variable, void* buffer, size_t size) const;
+    size_t set_bytes(Variable variable, void const* buffer, size_t size);
+
+    bool load_slot(uint8_t slot, Variables& variables, uint32_t& generation);
+    void load_legacy();
+    // Write variables to NVS as blob of the next generation
+    bool write(Variables const& variables);
+    void serialize(Variables const& variables, uint32_t generation, std::vector<uint8_t>& blob) const;
+    bool deserialize(std::vector<uint8_t> const& blob, Variables& variables, uint32_t& generation) const;
+    void mark_dirty();
+
+    static constexpr unsigned long kCommitDelayMs{5000};
+
+    Preferences   preferences;
+    Variables     cache_;
+    uint32_t      generation_{0};  // Version of blob, which was written last. Slot of blob is generation_ % 2
+    bool          is_dirty_{false};
+    unsigned long last_change_time_{0};
+};
+
+// Changes are staged in transaction and do not affect Persistency till Persistency::commit(transaction). Uncommitted
+// transaction is just discarded
+class Persistency::Transaction
+{
+public:
+    Transaction() = default;
+
+    template <Variable variable>
+    Transaction& set(ValueOf<variable> value);
+    template <Variable variable>
+    Transaction& set_bytes(void const* buffer, size_t size);
+
+private:
+    friend class Persistency;
+
+    Variables variables_;
+    uint16_t  staged_mask_{0};  // Bit per variable
+    bool      is_valid_{true};
+    bool      is_committed_{false};
+};
+
+template <>
+struct Persistency::ValueType<Persistency::Type::kByte>
+{
+    using Type = uint8_t;
+};
+
+template <>
+struct Persistency::ValueType<Persistency::Type::kWord>
+{
+    using Type = uint16_t;
 };
 
+template <Persistency::Variable variable>
+Persistency::ValueOf<variable>
+Persistency::get() const
+{
+    return static_cast<ValueOf<variable>>(cache_[variable].value);
+}
+
+template <Persistency::Variable variable>
+bool
+Persistency::set(ValueOf<variable> value)
+{
+    return set_value(variable, value);
+}
+
+template <Persistency::Variable variable>
+size_t
+Persistency::get_bytes(void* buffer, size_t size) const
+{
+    static_assert(kVariables[variable].type == Type::kBytes, "Variable is not binary blob");
+    return get_bytes(variable, buffer, size);
+}
+
+template <Persistency::Variable variable>
+size_t
+Persistency::set_bytes(void const* buffer, size_t size)
+{
+    static_assert(kVariables[variable].type == Type::kBytes, "Variable is not binary blob");
+    return set_bytes(variable, buffer, size);
+}
+
+template <Persistency::Variable variable>
+Persistency::Transaction&
+Persistency::Transaction::set(ValueOf<variable> value)
+{
+    if (!is_in_range(variable, value)) {
+        is_valid_ = false;
+        return *this;
+    }
+    variables_[variable].value = value;
+    staged_mask_ |= (1 << variable);
+    return *this;
+}
+
+template <Persistency::Variable variable>
+Persistency::Transaction&
+Persistency::Transaction::set_bytes(void const* buffer, size_t size)
+{
+    static_assert(kVariables[variable].type == Type::kBytes, "Variable is not binary blob");
+    variables_[variable].bytes.assign((uint8_t const*)buffer, (uint8_t const*)buffer + size);
+    staged_mask_ |= (1 << variable);
+    return *this;
+}
+
 #endif  // SRC_CONTROL_PERSISTENCY_H_
@@ -48,9 +48,15 @@ ThermoSensors::ThermoSensors(uint8_t pin)
   , oneWire_{}
   , sensors_{}
   , last_temperatures_{kInvalidTemperature, kInvalidTemperature}
+  , timer_id_{Utils::TimerWheel::kInvalidId}
 {
 }
 
+ThermoSensors::~ThermoSensors()
+{
+    Utils::TimerWheel::instance().remove(timer_id_);
+}
+
 void
 ThermoSensors::setup()
 {
@@ -75,18 +81,15 @@ ThermoSensors::setup()
     sensors_.setResolution(resolution_);
     sensors_.setWaitForConversion(false);
     sensors_.requestTemperatures();
+    // The first reading happens, when the first conversion is finished
+    timer_id_ = Utils::TimerWheel::instance().add("thermo_sensors", conversion_timeout_, conversion_timeout_,
+                                                  Utils::TimerWheel::Priority::kNormal,
+                                                  [this]() { read_temperatures(); });
 }
 
 void
-ThermoSensors::loop()
+ThermoSensors::read_temperatures()
 {
-    static uint32_t last_reading_time{0};
-    auto            now = millis();
-    if ((now - last_reading_time) < conversion_timeout_) {
-        return;
-    }
-    last_reading_time = now;
-
     last_temperatures_[0] = convert_by_calibration(sensors_.getTempC(addresses_[0]), addresses_[0]);
     last_temperatures_[1] = convert_by_calibration(sensors_.getTempC(addresses_[1]), addresses_[1]);
     sensors_.requestTemperatures();
@@ -6,6 +6,8 @@
 #include <DallasTemperature.h>
 #include <OneWire.h>
 
+#include "src/Utils/TimerWheel.h"
+
 // Asynchronously reads data from 2 thermal sensors. getTemperatures() returns results of last reading. Temperature is
 // read once per conversion timeout (depends on sensor precision - see below).
 //
@@ -15,18 +17,22 @@
 // 10 bit    | 187.5 ms (tconv/4) | 0.25
 // 11 bit    | 375 ms (tconv/2)   | 0.125
 // 12 bit    | 750 ms tconv       | 0.0625
+// Results are read by TimerWheel.
 class ThermoSensors
 {
 public:
     ThermoSensors(uint8_t pin);
+    ThermoSensors(ThermoSensors const&) = delete;
+    ThermoSensors& operator=(ThermoSensors const&) = delete;
+    ~ThermoSensors();
     void setup();
-    void loop();
 
     void get_temperatures(float (&temperatures)[2]) const;
 
     static constexpr float kInvalidTemperature{DEVICE_DISCONNECTED_C};
 
 private:
+    void  read_temperatures();
     float convert_by_calibration(float T, DeviceAddress const& sensor_address) const;
 
     uint8_t                   pin_;
@@ -37,6 +43,7 @@ private:
     static constexpr uint8_t  resolution_{12};  // 9 bit - 0.5 degrees precision; 12 bit - 0.06 degrees
     static constexpr uint16_t conversion_timeout_{750 >> (12 - resolution_)};
     float                     last_temperatures_[num_of_sensors_];
+    Utils::TimerWheel::Id     timer_id_;
 };
 
 #endif  // SRC_CONTROL_THERMOSENSORS_H_
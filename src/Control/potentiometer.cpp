@@ -6,9 +6,7 @@
 
 namespace
 {
-constexpr uint8_t  kAutoCalibrationFilterNumOfSamples{50};
-constexpr uint16_t kDefaultMinPotVal{625};   // 0.5V
-constexpr uint16_t kDefaultMaxPotVal{3000};  // 2.4V
+constexpr uint8_t kAutoCalibrationFilterNumOfSamples{50};
 }  // namespace
 
 Potentiometer::Potentiometer(uint8_t pin, uint32_t sampling_ms)
@@ -18,42 +16,35 @@ Potentiometer::Potentiometer(uint8_t pin, uint32_t sampling_ms)
   , filter_{3}  // Median 3 filter
   , auto_calibration_filter_{kAutoCalibrationFilterNumOfSamples}
   , is_auto_calubration_in_progress_{false}
-  , calibrated_min_val_{kDefaultMinPotVal}
-  , calibrated_max_val_{kDefaultMaxPotVal}
+  , calibrated_min_val_{Persistency::kVariables[Persistency::kPotentiometerMinVal].default_value}
+  , calibrated_max_val_{Persistency::kVariables[Persistency::kPotentiometerMaxVal].default_value}
+  , timer_id_{Utils::TimerWheel::kInvalidId}
 {
 }
 
+Potentiometer::~Potentiometer()
+{
+    Utils::TimerWheel::instance().remove(timer_id_);
+}
+
 void
 Potentiometer::setup()
 {
     pinMode(pin_, ANALOG);
 
-    if (!Persistency::instance().is_variable_stored(Persistency::kPotentiometerMinVal)) {
-        DEBUG_PRINTLN(String{"Setting initial value of kPotentiometerMinVal to"} + String{kDefaultMinPotVal});
-        Persistency::instance().set_word(Persistency::kPotentiometerMinVal, kDefaultMinPotVal);
-    }
-    if (!Persistency::instance().is_variable_stored(Persistency::kPotentiometerMaxVal)) {
-        DEBUG_PRINTLN(String{"Setting initial value of kPotentiometerMaxVal to"} + String{kDefaultMaxPotVal});
-        Persistency::instance().set_word(Persistency::kPotentiometerMaxVal, kDefaultMaxPotVal);
-    }
-
-    calibrated_min_val_ = Persistency::instance().get_word(Persistency::kPotentiometerMinVal);
-    calibrated_max_val_ = Persistency::instance().get_word(Persistency::kPotentiometerMaxVal);
+    calibrated_min_val_ = Persistency::instance().get<Persistency::kPotentiometerMinVal>();
+    calibrated_max_val_ = Persistency::instance().get<Persistency::kPotentiometerMaxVal>();
 
     DEBUG_PRINTLN(String{"Read from Persistency: calibrated range: "} + String{calibrated_min_val_} + "-" +
                   String{calibrated_max_val_});
+
+    timer_id_ = Utils::TimerWheel::instance().add("potentiometer", sampling_ms_, 0,
+                                                  Utils::TimerWheel::Priority::kNormal, [this]() { sample(); });
 }
 
 void
-Potentiometer::loop()
+Potentiometer::sample()
 {
-    static unsigned long last_sampling_time{0};
-    auto                 now = millis();
-    if ((now - last_sampling_time) < sampling_ms_) {
-        return;
-    }
-    last_sampling_time = now;
-
     current_value_ = filter(analogRead(pin_));
     auto_calibrate();
 }
@@ -98,11 +89,14 @@ Potentiometer::auto_calibrate()
         uint16_t median_value{0};
         auto_calibration_filter_.filter_median_n_get_result(&median_value);
         auto_calibration_filter_.filter_median_n_clear();
-        bool should_update_min_val{current_value_ < calibrated_min_val_};
-        (should_update_min_val ? calibrated_min_val_ : calibrated_max_val_) = median_value;
-        Persistency::instance().set_word(
-            should_update_min_val ? Persistency::kPotentiometerMinVal : Persistency::kPotentiometerMaxVal,
-            median_value);
+        if (current_value_ < calibrated_min_val_) {
+            calibrated_min_val_ = median_value;
+            Persistency::instance().set<Persistency::kPotentiometerMinVal>(median_value);
+        }
+        else {
+            calibrated_max_val_ = median_value;
+            Persistency::instance().set<Persistency::kPotentiometerMaxVal>(median_value);
+        }
     }
     else {
         // Autocalibration was not started previously
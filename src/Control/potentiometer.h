@@ -4,18 +4,23 @@
 #include <stdint.h>
 
 #include "Filter.h"
+#include "src/Utils/TimerWheel.h"
 
+// Value is sampled by TimerWheel every sampling_ms
 class Potentiometer
 {
 public:
     Potentiometer(uint8_t pin, uint32_t sampling_ms);
+    Potentiometer(Potentiometer const&) = delete;
+    Potentiometer& operator=(Potentiometer const&) = delete;
+    ~Potentiometer();
     void setup();
-    void loop();
 
     // 0.0-1.0
     float read() const;
 
 private:
+    void     sample();
     uint16_t filter(uint16_t value);
     void     auto_calibrate();
     float    map_to_calibrated_range() const;
@@ -31,6 +36,8 @@ private:
     uint16_t calibrated_min_val_;
     uint16_t calibrated_max_val_;
 
+    Utils::TimerWheel::Id timer_id_;
+
     // This is for debugging and confuguring filters
     // void print_debug(uint16_t new_value);
 };
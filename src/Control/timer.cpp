@@ -1,12 +1,29 @@
 #include "Timer.h"
 
-#include <DS1307RTC.h>
+#include <algorithm>
+#include <functional>
 
 #include "Persistency.h"
 #include "src/Utils/Logger.h"
 
 namespace
 {
+// Alarms are stored in Persistency as single binary blob: version, number of alarms and then packed alarms.
+// Each packed alarm is: hour, minute, DoW mask with "enabled" flag in MSB, sunrise duration (2 bytes, little endian)
+constexpr uint8_t kAlarmsBlobVersion{1};
+constexpr uint8_t kAlarmsBlobHeaderSize{2};
+constexpr uint8_t kPackedAlarmSize{5};
+constexpr uint8_t kAlarmEnabledFlag{0x80};
+constexpr size_t  kAlarmsBlobMaxSize{kAlarmsBlobHeaderSize + Timer::kMaxNumOfAlarms * kPackedAlarmSize};
+
+constexpr size_t   kAlarmStrLength{10};         // E HH:MM WW
+constexpr size_t   kIndexedAlarmStrLength{15};  // E HH:MM WW DDDD
+constexpr uint32_t kAlarmCheckPeriodMs{1000};   // Time of alarm is in minutes, time of clock - in seconds
+constexpr time_t   kMinValidTime{1609459200};   // 2021-01-01. Clock, which is not set, starts from 1970
+
+static_assert((uint8_t)Timer::DaysOfWeek::kEveryDay == Utils::DateTime::kEveryDayMask,
+              "Days of week of alarm are parsed by DateTime");
+
 Timer::DaysOfWeek
 timelib_wday_to_dow(uint8_t c)
 {
@@ -31,74 +48,74 @@ timelib_wday_to_dow(uint8_t c)
 }
 }  // namespace
 
-Timer::Timer(unsigned long reading_period_ms)
-  : reading_period_ms_{reading_period_ms}
-  , last_triggered_alarm_{0xFF, 0xFF, DaysOfWeek::kEveryDay}
+constexpr uint8_t Timer::kMaxNumOfAlarms;
+
+Timer::Timer(ClockService& clock_service)
+  : clock_service_{clock_service}
+  , schedule_size_{0}
   , is_alarm_enabled_{false}
   , alarm_handler_{nullptr}
+  , last_check_time_{0}
+  , timer_id_{Utils::TimerWheel::kInvalidId}
 {
 }
 
+// clock_service_ may outlive Timer, so its handler is reset too
+Timer::~Timer()
+{
+    Utils::TimerWheel::instance().remove(timer_id_);
+    clock_service_.set_time_step_handler(nullptr);
+}
+
 void
 Timer::setup()
 {
-    // Rework this code as it is done in Potentiometer: consider 1st run, when these variables are not set.
-    if (!Persistency::instance().is_variable_stored(Persistency::kAlarmHours)) {
-        Persistency::instance().set_byte(Persistency::kAlarmHours, 0);
-    }
-    if (!Persistency::instance().is_variable_stored(Persistency::kAlarmMinutes)) {
-        Persistency::instance().set_byte(Persistency::kAlarmMinutes, 0);
-    }
-    if (!Persistency::instance().is_variable_stored(Persistency::kAlarmDow)) {
-        Persistency::instance().set_byte(Persistency::kAlarmDow, 0);
-    }
-    if (!Persistency::instance().is_variable_stored(Persistency::kIsAlarmOn)) {
-        Persistency::instance().set_byte(Persistency::kIsAlarmOn, 0);
-    }
+    is_alarm_enabled_ = (Persistency::instance().get<Persistency::kIsAlarmOn>() == 1);
 
-    alarm_.hour       = Persistency::instance().get_byte(Persistency::kAlarmHours);
-    alarm_.minute     = Persistency::instance().get_byte(Persistency::kAlarmMinutes);
-    alarm_.dow        = static_cast<Timer::DaysOfWeek>(Persistency::instance().get_byte(Persistency::kAlarmDow));
-    is_alarm_enabled_ = (Persistency::instance().get_byte(Persistency::kIsAlarmOn) == 1);
+    load_alarms();
 
-    String message{String{"Read from Persistency: alarm time "} + String{alarm_.hour} + ":" + String{alarm_.minute} +
-                   " DoW= 0x" + String{(int)alarm_.dow, HEX} + ". Alarm is " +
+    String message{String{"Read from Persistency: alarm time "} + String{alarms_[0].hour} + ":" +
+                   String{alarms_[0].minute} + " DoW= 0x" + String{(int)alarms_[0].dow, HEX} + ". Alarm is " +
                    ((is_alarm_enabled_ ? "enabled" : "disabled"))};
     DEBUG_PRINTLN(message);
+
+    clock_service_.set_time_step_handler([this]() { on_time_step(); });
+    schedule_alarms();
+    timer_id_ = Utils::TimerWheel::instance().add("alarm", kAlarmCheckPeriodMs, 0, Utils::TimerWheel::Priority::kHigh,
+                                                  [this]() { check_alarm(); });
 }
 
 // We are not using hardware alarm. Reason: there are only 2 alarms. They can be configured to trigger either on
 // specified day of week, either on specified day of month. But in case of SAD Lamp we want alarm to trigger every day.
-// The only option to do it is to check current hour and minute in ESP's main loop.
+//
+// Time of next alarm is calculated only when alarm or time is changed. Current time is taken from ESP's system clock,
+// which is disciplined by ClockService, so there is no I2C communication, when alarm is checked. Alarm is checked by
+// TimerWheel once per second and is triggered as soon as current time reaches (or passes) time of next alarm, so it
+// can not be missed even if some iteration of loop() took too long.
+//
+// Scheduled alarms are kept in min-heap by time of next alarm. So, checking for alarm is O(1) and re-scheduling of
+// triggered alarm is O(log N).
 void
 Timer::check_alarm()
 {
-    if ((!is_alarm_enabled_) || (alarm_handler_ == nullptr)) {
+    auto now         = clock_service_.get_time();
+    last_check_time_ = now;
+    if ((!is_alarm_enabled_) || (alarm_handler_ == nullptr) || (schedule_size_ == 0)) {
         return;
     }
 
-    // Do not read from RTC on every iteration of loop(). Reading 2 times per second is quite safe.
-    static unsigned long last_reading_time{0};
-    auto                 now = millis();
-    if ((now - last_reading_time) < reading_period_ms_) {
+    if (now < schedule_[0].time) {
         return;
     }
-    last_reading_time = now;
 
-    tmElements_t datetime;
-    if (!RTC.read(datetime)) {
-        return;
-    }
+    // Schedule next alarm before calling handler. Calculate it starting from current time to avoid triggering alarm
+    // several times in a row if, for some reason, we passed several alarm times
+    std::pop_heap(schedule_.begin(), schedule_.begin() + schedule_size_, std::greater<ScheduledAlarm>{});
+    auto& triggered = schedule_[schedule_size_ - 1];
+    triggered.time  = calculate_next_alarm_time(alarms_[triggered.index], now);
+    std::push_heap(schedule_.begin(), schedule_.begin() + schedule_size_, std::greater<ScheduledAlarm>{});
 
-    bool does_dow_match{(uint8_t)alarm_.dow & (uint8_t)timelib_wday_to_dow(datetime.Wday)};
-    if (does_dow_match && (datetime.Hour == alarm_.hour) && (datetime.Minute == alarm_.minute) &&
-        (datetime.Second == 0)) {
-        // Trigger alarm only once
-        if (!(last_triggered_alarm_ == datetime)) {
-            last_triggered_alarm_ = datetime;
-            alarm_handler_->on_alarm();
-        }
-    }
+    alarm_handler_->on_alarm(alarms_[triggered.index].sunrise_duration_m);
 }
 
 void
@@ -109,64 +126,176 @@ Timer::register_alarm_handler(AlarmHandler* alarm_handler)
 
 String
 Timer::get_time_str() const
+{
+    char str[Utils::DateTime::kDateTimeStrLength + 1];
+    get_time_str(str, sizeof(str));
+    return String(str);
+}
+
+size_t
+Timer::get_time_str(char* buffer, size_t size) const
 {
     tmElements_t datetime;
-    String       result;
-    if (RTC.read(datetime)) {
-        result = datetime_to_str(datetime);
-    }
-    return result;
+    breakTime(get_time(), datetime);
+    return Utils::DateTime::format_datetime(datetime, buffer, size);
 }
 
 time_t
 Timer::get_time() const
 {
-    return RTC.get();
+    return clock_service_.get_time();
 }
 
-void
-Timer::set_time_str(const String& str) const
+Utils::DateTime::Error
+Timer::set_time_str(const String& str)
 {
-    DEBUG_PRINTLN(String{"Received command 'Set time' "} + str);
-    auto datetime{str_to_datetime(str)};
-    RTC.write(datetime);
+    DEBUG_PRINT("Received command 'Set time' ");
+    DEBUG_PRINTLN(str);
+
+    tmElements_t datetime;
+    auto         error = Utils::DateTime::parse_datetime(str.c_str(), str.length(), datetime);
+    if (error != Utils::DateTime::Error::kOk) {
+        DEBUG_PRINT("ERROR: invalid time: ");
+        DEBUG_PRINTLN(Utils::DateTime::error_to_str(error));
+        return error;
+    }
+    clock_service_.set_time(makeTime(datetime));
+
+    // Time was set by user, so do not trigger alarms which were passed
+    schedule_alarms();
+    return Utils::DateTime::Error::kOk;
 }
 
-void
+Utils::DateTime::Error
 Timer::set_alarm_str(const String& str)
 {
-    DEBUG_PRINTLN(String{"Received command 'Set alarm' "} + str);
-
-    alarm_ = str_to_alarm(str);
+    DEBUG_PRINT("Received command 'Set alarm' ");
+    DEBUG_PRINTLN(str);
+
+    AlarmData alarm;
+    auto      error = parse_alarm(str.c_str(), str.length(), alarm);
+    if (error != Utils::DateTime::Error::kOk) {
+        DEBUG_PRINT("ERROR: invalid alarm: ");
+        DEBUG_PRINTLN(Utils::DateTime::error_to_str(error));
+        return error;
+    }
 
-    // Store new alarm value to Persistency
-    Persistency::instance().set_byte(Persistency::kAlarmHours, alarm_.hour);
-    Persistency::instance().set_byte(Persistency::kAlarmMinutes, alarm_.minute);
-    Persistency::instance().set_byte(Persistency::kAlarmDow, (uint8_t)(alarm_.dow));
+    // Alarm #0 is always enabled. It is controlled only by common enabling/disabling of alarms
+    alarms_[0]            = alarm;
+    alarms_[0].is_enabled = true;
+    store_alarms();
+    schedule_alarms();
 
-    String message{String{"Stored to Persistency alarm at "} + String{alarm_.hour} + ":" + String{alarm_.minute} +
-                   " DoW= 0x" + String{(int)alarm_.dow, HEX}};
+    String message{String{"Stored to Persistency alarm at "} + String{alarms_[0].hour} + ":" +
+                   String{alarms_[0].minute} + " DoW= 0x" + String{(int)alarms_[0].dow, HEX}};
     DEBUG_PRINTLN(message);
+    return Utils::DateTime::Error::kOk;
 }
 
 String
 Timer::get_alarm_str() const
+{
+    char str[kAlarmStrLength + 1];
+    get_alarm_str(str, sizeof(str));
+    return String(str);
+}
+
+size_t
+Timer::get_alarm_str(char* buffer, size_t size) const
 {
     // E HH:MM WW
-    char str[11];
+    if (size < kAlarmStrLength + 1) {
+        return 0;
+    }
+
+    // Format full alarm (with sunrise duration) and cut it
+    char str[kIndexedAlarmStrLength + 1];
+    format_alarm(alarms_[0], str, sizeof(str));
+    memcpy(buffer, str, kAlarmStrLength);
+    buffer[0]               = (is_alarm_enabled_) ? 'E' : 'D';
+    buffer[kAlarmStrLength] = '\0';
+    return kAlarmStrLength;
+}
+
+Utils::DateTime::Error
+Timer::set_indexed_alarm_str(const String& str)
+{
+    DEBUG_PRINT("Received command 'Set indexed alarm' ");
+    DEBUG_PRINTLN(str);
+
+    // II HH:MM WW DDDD
+    uint8_t index;
+    auto    error = parse_alarm_index(str.c_str(), str.length(), index);
+    if (error != Utils::DateTime::Error::kOk) {
+        return error;
+    }
+
+    AlarmData alarm;
+    error = parse_alarm(str.c_str() + 3, str.length() - 3, alarm);
+    if (error != Utils::DateTime::Error::kOk) {
+        DEBUG_PRINT("ERROR: invalid alarm: ");
+        DEBUG_PRINTLN(Utils::DateTime::error_to_str(error));
+        return error;
+    }
+
+    alarm.is_enabled = alarms_[index].is_enabled;
+    alarms_[index]   = alarm;
+    store_alarms();
+    schedule_alarms();
+    return Utils::DateTime::Error::kOk;
+}
+
+bool
+Timer::enable_indexed_alarm_str(const String& str)
+{
+    DEBUG_PRINT("Received command 'Enable indexed alarm' ");
+    DEBUG_PRINTLN(str);
+
+    // II E
+    uint8_t index;
+    if ((parse_alarm_index(str.c_str(), str.length(), index) != Utils::DateTime::Error::kOk) ||
+        (str.length() != 4) || ((str[3] != 'E') && (str[3] != 'D'))) {
+        return false;
+    }
 
-    str[0] = (is_alarm_enabled_) ? 'E' : 'D';
-    str[1] = ' ';
+    alarms_[index].is_enabled = (str[3] == 'E');
+    store_alarms();
+    schedule_alarms();
+    return true;
+}
 
-    // A terminating null character is automatically appended by snprintf
-    snprintf_P(str + 2, 9, "%02d:%02d %02x", alarm_.hour, alarm_.minute, (uint8_t)alarm_.dow);
+String
+Timer::get_alarms_str() const
+{
+    char str[kMaxNumOfAlarms * (kIndexedAlarmStrLength + 1)];
+    get_alarms_str(str, sizeof(str));
     return String(str);
 }
 
+size_t
+Timer::get_alarms_str(char* buffer, size_t size) const
+{
+    // E HH:MM WW DDDD,E HH:MM WW DDDD,...
+    if (size < kMaxNumOfAlarms * (kIndexedAlarmStrLength + 1)) {
+        return 0;
+    }
+
+    size_t length{0};
+    for (auto const& alarm : alarms_) {
+        if (length != 0) {
+            buffer[length++] = ',';
+        }
+        length += format_alarm(alarm, buffer + length, size - length);
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
 bool
 Timer::enable_alarm_str(const String& str)
 {
-    DEBUG_PRINTLN(String{"Received command 'Enable alarm' "} + str);
+    DEBUG_PRINT("Received command 'Enable alarm' ");
+    DEBUG_PRINTLN(str);
 
     if (str[0] == 'E') {
         if (!is_alarm_enabled_) {
@@ -188,11 +317,13 @@ Timer::toggle_alarm()
 {
     if (is_alarm_enabled_) {
         is_alarm_enabled_ = false;
-        Persistency::instance().set_byte(Persistency::kIsAlarmOn, 0);
+        Persistency::instance().set<Persistency::kIsAlarmOn>(0);
     }
     else {
         is_alarm_enabled_ = true;
-        Persistency::instance().set_byte(Persistency::kIsAlarmOn, 1);
+        Persistency::instance().set<Persistency::kIsAlarmOn>(1);
+        // Alarm times, calculated before, can be already passed while alarms were disabled
+        schedule_alarms();
     }
 
     DEBUG_PRINTLN(String{"Alarm is "} + (is_alarm_enabled_ ? "enabled" : "disabled"));
@@ -203,82 +334,185 @@ Timer::AlarmData::AlarmData()
 {
 }
 
-Timer::AlarmData::AlarmData(uint8_t h, uint8_t m, DaysOfWeek dw)
+Timer::AlarmData::AlarmData(uint8_t h, uint8_t m, DaysOfWeek dw, uint16_t duration_m, bool enabled)
   : hour{h}
   , minute{m}
   , dow{dw}
+  , sunrise_duration_m{duration_m}
+  , is_enabled{enabled}
+{
+}
+
+void
+Timer::load_alarms()
 {
+    uint8_t buffer[kAlarmsBlobMaxSize];
+    size_t  size{Persistency::instance().get_bytes<Persistency::kAlarms>(buffer, sizeof(buffer))};
+
+    if ((size < kAlarmsBlobHeaderSize) || (buffer[0] != kAlarmsBlobVersion)) {
+        // 1st run or migration from single alarm, stored in separate variables
+        DEBUG_PRINTLN("Alarms are not found in Persistency. Creating them from single alarm");
+        alarms_.fill(AlarmData{});
+        if (Persistency::instance().is_variable_stored(Persistency::kAlarmHours)) {
+            alarms_[0].hour   = Persistency::instance().get<Persistency::kAlarmHours>();
+            alarms_[0].minute = Persistency::instance().get<Persistency::kAlarmMinutes>();
+            alarms_[0].dow    = static_cast<Timer::DaysOfWeek>(Persistency::instance().get<Persistency::kAlarmDow>());
+            alarms_[0].is_enabled = true;
+        }
+        store_alarms();
+        return;
+    }
+
+    uint8_t num_of_alarms = std::min<uint8_t>(buffer[1], kMaxNumOfAlarms);
+    num_of_alarms = std::min<uint8_t>(num_of_alarms, (size - kAlarmsBlobHeaderSize) / kPackedAlarmSize);
+    alarms_.fill(AlarmData{});
+    for (uint8_t i = 0; i < num_of_alarms; ++i) {
+        uint8_t const* packed{buffer + kAlarmsBlobHeaderSize + i * kPackedAlarmSize};
+        alarms_[i].hour               = packed[0];
+        alarms_[i].minute             = packed[1];
+        alarms_[i].dow                = static_cast<Timer::DaysOfWeek>(packed[2] & ~kAlarmEnabledFlag);
+        alarms_[i].is_enabled         = (packed[2] & kAlarmEnabledFlag) != 0;
+        alarms_[i].sunrise_duration_m = packed[3] | (packed[4] << 8);
+    }
 }
 
-Timer::AlarmData&
-Timer::AlarmData::operator=(const tmElements_t& time_elements)
+void
+Timer::store_alarms() const
 {
-    hour   = time_elements.Hour;
-    minute = time_elements.Minute;
-    // Do NOT take DoW into account
-    return *this;
+    uint8_t buffer[kAlarmsBlobMaxSize];
+    buffer[0] = kAlarmsBlobVersion;
+    buffer[1] = kMaxNumOfAlarms;
+    for (uint8_t i = 0; i < kMaxNumOfAlarms; ++i) {
+        uint8_t* packed{buffer + kAlarmsBlobHeaderSize + i * kPackedAlarmSize};
+        packed[0] = alarms_[i].hour;
+        packed[1] = alarms_[i].minute;
+        packed[2] = (uint8_t)alarms_[i].dow | (alarms_[i].is_enabled ? kAlarmEnabledFlag : 0);
+        packed[3] = alarms_[i].sunrise_duration_m & 0xFF;
+        packed[4] = alarms_[i].sunrise_duration_m >> 8;
+    }
+
+    // Alarms and common enabling of alarms are always stored together and immediately
+    Persistency::Transaction transaction;
+    transaction.set_bytes<Persistency::kAlarms>(buffer, sizeof(buffer))
+        .set<Persistency::kIsAlarmOn>(is_alarm_enabled_ ? 1 : 0);
+    if (!Persistency::instance().commit(transaction)) {
+        DEBUG_PRINTLN("ERROR: can not store alarms to Persistency");
+    }
 }
 
 bool
-Timer::AlarmData::operator==(const tmElements_t& time_elements) const
+Timer::ScheduledAlarm::operator>(const ScheduledAlarm& other) const
 {
-    // Do NOT take DoW into account
-    return ((hour == time_elements.Hour) && (minute == time_elements.Minute));
+    return time > other.time;
 }
 
-tmElements_t
-Timer::str_to_datetime(const String& str) const
+void
+Timer::on_time_step()
 {
-    tmElements_t tm;
-    // HH:MM:SS DD/MM/YYYY
-    tm.Hour   = str.substring(0, 2).toInt();
-    tm.Minute = str.substring(3, 5).toInt();
-    tm.Second = str.substring(6, 8).toInt();
-    tm.Day    = str.substring(9, 11).toInt();
-    tm.Month  = str.substring(12, 14).toInt();
-    tm.Year   = CalendarYrToTm(str.substring(15, 19).toInt());
-
-    // We have to set week day manually, because DS1307RTC library doesn't do it.
-    // We are doing this calculation by building time_t (seconds since 19700) from input data and by converting it
-    // back to tmElements_t by breakTime() function. This function calculates week day.
-    tmElements_t datetime;
-    breakTime(makeTime(tm), datetime);
+    // Time jumped. If it jumped forward over the nearest alarm, keep schedule as is to trigger it in check_alarm().
+    // Alarm is stepped over only if it was still pending at the last check before the step (not more than one check
+    // period ago) and clock was set at that moment. Otherwise it was scheduled by wrong clock (ex. at boot, when RTC
+    // could not be read, it is scheduled in 1970) and firing it now would be wrong, so alarms are recalculated
+    bool is_alarm_stepped_over{(schedule_size_ != 0) && (schedule_[0].time <= clock_service_.get_time()) &&
+                               (last_check_time_ >= kMinValidTime) &&
+                               (schedule_[0].time + (time_t)(kAlarmCheckPeriodMs / 1000) >= last_check_time_)};
+    if (!is_alarm_stepped_over) {
+        schedule_alarms();
+    }
+}
 
-    return datetime;
+void
+Timer::schedule_alarms()
+{
+    auto now       = clock_service_.get_time();
+    schedule_size_ = 0;
+    for (uint8_t i = 0; i < kMaxNumOfAlarms; ++i) {
+        if (!alarms_[i].is_enabled) {
+            continue;
+        }
+        auto alarm_time = calculate_next_alarm_time(alarms_[i], now);
+        if (alarm_time != kNoAlarmScheduled) {
+            schedule_[schedule_size_++] = ScheduledAlarm{alarm_time, i};
+        }
+    }
+    std::make_heap(schedule_.begin(), schedule_.begin() + schedule_size_, std::greater<ScheduledAlarm>{});
 }
 
-Timer::AlarmData
-Timer::str_to_alarm(const String& str) const
+time_t
+Timer::calculate_next_alarm_time(const AlarmData& alarm, time_t after) const
 {
-    // HH:MM
-    uint8_t h = str.substring(0, 2).toInt();
-    uint8_t m = str.substring(3, 5).toInt();
-
-    DaysOfWeek dow = DaysOfWeek::kEveryDay;
-    if (str.length() >= 7) {
-        auto res = strtoul(str.substring(6, 8).c_str(), 0, 16);
-        if (!((res == 0) || (res == ULONG_MAX))) {
-            dow = static_cast<Timer::DaysOfWeek>(res & 0x7F);
+    if (alarm.dow == static_cast<DaysOfWeek>(0)) {
+        return kNoAlarmScheduled;
+    }
+
+    // Check today and next 7 days. Alarm today can be already passed, so in worst case it will trigger in 7 days
+    time_t alarm_offset{alarm.hour * SECS_PER_HOUR + alarm.minute * SECS_PER_MIN};
+    time_t midnight{previousMidnight(after)};
+    for (uint8_t day = 0; day <= DAYS_PER_WEEK; ++day, midnight += SECS_PER_DAY) {
+        time_t candidate{midnight + alarm_offset};
+        if (candidate <= after) {
+            continue;
+        }
+        if ((uint8_t)alarm.dow & (uint8_t)timelib_wday_to_dow(dayOfWeek(candidate))) {
+            return candidate;
         }
     }
+    return kNoAlarmScheduled;
+}
+
+Utils::DateTime::Error
+Timer::parse_alarm_index(char const* str, size_t length, uint8_t& index) const
+{
+    // II ...
+    if (length < 3) {
+        return Utils::DateTime::Error::kInvalidLength;
+    }
+    if (str[2] != ' ') {
+        return Utils::DateTime::Error::kInvalidSeparator;
+    }
 
-    return Timer::AlarmData{h, m, dow};
+    uint16_t value;
+    auto     error = Utils::DateTime::parse_fixed_uint(str, 2, value);
+    if (error != Utils::DateTime::Error::kOk) {
+        return error;
+    }
+    if (value >= kMaxNumOfAlarms) {
+        return Utils::DateTime::Error::kOutOfRange;
+    }
+    index = value;
+    return Utils::DateTime::Error::kOk;
 }
 
-String
-Timer::datetime_to_str(const tmElements_t& datetime) const
+Utils::DateTime::Error
+Timer::parse_alarm(char const* str, size_t length, AlarmData& alarm) const
 {
-    // H:MM:SS DD/MM/YYYY
-    char str[20];
-    // A terminating null character is automatically appended by snprintf
-    snprintf_P(str,
-               20,
-               "%02d:%02d:%02d %02d/%02d/%04d",
-               datetime.Hour,
-               datetime.Minute,
-               datetime.Second,
-               datetime.Day,
-               datetime.Month,
-               tmYearToCalendar(datetime.Year));
-    return String(str);
+    Utils::DateTime::Alarm parsed_alarm;
+    auto                   error = Utils::DateTime::parse_alarm(str, length, parsed_alarm);
+    if (error != Utils::DateTime::Error::kOk) {
+        return error;
+    }
+    alarm = AlarmData{parsed_alarm.hour, parsed_alarm.minute, static_cast<DaysOfWeek>(parsed_alarm.days_of_week),
+                      parsed_alarm.sunrise_duration_m};
+    return Utils::DateTime::Error::kOk;
+}
+
+size_t
+Timer::format_alarm(const AlarmData& alarm, char* buffer, size_t size) const
+{
+    // E HH:MM WW DDDD
+    if (size < kIndexedAlarmStrLength + 1) {
+        return 0;
+    }
+
+    buffer[0] = alarm.is_enabled ? 'E' : 'D';
+    buffer[1] = ' ';
+    Utils::DateTime::format_fixed_uint(buffer + 2, 2, alarm.hour);
+    buffer[4] = ':';
+    Utils::DateTime::format_fixed_uint(buffer + 5, 2, alarm.minute);
+    buffer[7] = ' ';
+    Utils::DateTime::format_fixed_hex(buffer + 8, 2, (uint8_t)alarm.dow);
+    buffer[10] = ' ';
+    Utils::DateTime::format_fixed_uint(buffer + 11, 4, alarm.sunrise_duration_m);
+    buffer[kIndexedAlarmStrLength] = '\0';
+    return kIndexedAlarmStrLength;
 }
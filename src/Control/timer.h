@@ -1,16 +1,23 @@
 #ifndef SRC_CONTROL_TIMER_H_
 #define SRC_CONTROL_TIMER_H_
 
+#include <array>
+
 #include <TimeLib.h>
 #include <WString.h>
 
+#include "ClockService.h"
+#include "src/Utils/DateTime.h"
+#include "src/Utils/TimerWheel.h"
+
 class Timer
 {
 public:
     class AlarmHandler
     {
     public:
-        virtual void on_alarm() = 0;
+        // sunrise_duration_m == 0 means that default sunrise duration should be used
+        virtual void on_alarm(uint16_t sunrise_duration_m) = 0;
     };
 
     enum class DaysOfWeek : uint8_t
@@ -25,42 +32,82 @@ public:
         kEveryDay  = 0b01111111
     };
 
-    explicit Timer(unsigned long reading_period_ms = 500);
+    static constexpr uint8_t kMaxNumOfAlarms{16};
+
+    // Time is taken from clock_service. It should be set up before Timer
+    explicit Timer(ClockService& clock_service);
+    Timer(Timer const&) = delete;
+    Timer& operator=(Timer const&) = delete;
+    ~Timer();
     void setup();
-    void check_alarm();
 
-    void   set_alarm_str(const String& str);
-    String get_alarm_str() const;
-    bool   enable_alarm_str(const String& str);
-    void   register_alarm_handler(AlarmHandler* alarm_handler);
-    void   toggle_alarm();
+    // Functions, taking output buffer, do not allocate memory. They return length of result or 0 if buffer is too small
+    // Setters return error of parsing, which should be reported to client (ex. Utils::DateTime::error_to_str())
 
-    void   set_time_str(const String& str) const;
-    String get_time_str() const;
-    time_t get_time() const;
+    // Alarm #0. Kept for compatibility with single-alarm commands
+    Utils::DateTime::Error set_alarm_str(const String& str) __attribute__((warn_unused_result));
+    String                 get_alarm_str() const;
+    size_t                 get_alarm_str(char* buffer, size_t size) const;
+
+    // Alarm with specified index
+    Utils::DateTime::Error set_indexed_alarm_str(const String& str) __attribute__((warn_unused_result));
+    bool                   enable_indexed_alarm_str(const String& str);
+    String                 get_alarms_str() const;
+    size_t                 get_alarms_str(char* buffer, size_t size) const;
+
+    // Enables/disables all alarms at once
+    bool enable_alarm_str(const String& str);
+    void register_alarm_handler(AlarmHandler* alarm_handler);
+    void toggle_alarm();
+
+    Utils::DateTime::Error set_time_str(const String& str) __attribute__((warn_unused_result));
+    String                 get_time_str() const;
+    size_t                 get_time_str(char* buffer, size_t size) const;
+    time_t                 get_time() const;
 
 private:
     struct AlarmData
     {
         AlarmData();
-        AlarmData(uint8_t h, uint8_t m, DaysOfWeek dw);
-        AlarmData& operator=(const tmElements_t& time_elements);
-        bool       operator==(const tmElements_t& time_elements) const;
+        AlarmData(uint8_t h, uint8_t m, DaysOfWeek dw, uint16_t duration_m = 0, bool enabled = false);
 
         uint8_t    hour;
         uint8_t    minute;
         DaysOfWeek dow;
+        uint16_t   sunrise_duration_m;
+        bool       is_enabled;
     };
 
-    tmElements_t str_to_datetime(const String& str) const;
-    AlarmData    str_to_alarm(const String& str) const;
-    String       datetime_to_str(const tmElements_t& datetime) const;
+    struct ScheduledAlarm
+    {
+        bool operator>(const ScheduledAlarm& other) const;
+
+        time_t  time;
+        uint8_t index;
+    };
+
+    Utils::DateTime::Error parse_alarm_index(char const* str, size_t length, uint8_t& index) const;
+    Utils::DateTime::Error parse_alarm(char const* str, size_t length, AlarmData& alarm) const;
+    size_t                 format_alarm(const AlarmData& alarm, char* buffer, size_t size) const;
+
+    void check_alarm();
+    void load_alarms();
+    void store_alarms() const;
+
+    void   on_time_step();
+    void   schedule_alarms();
+    time_t calculate_next_alarm_time(const AlarmData& alarm, time_t after) const;
+
+    static constexpr time_t kNoAlarmScheduled{0};
 
-    const unsigned long reading_period_ms_;
-    AlarmData           alarm_;
-    AlarmData           last_triggered_alarm_;
-    bool                is_alarm_enabled_;
-    AlarmHandler*       alarm_handler_;
+    ClockService&                               clock_service_;
+    std::array<AlarmData, kMaxNumOfAlarms>      alarms_;
+    std::array<ScheduledAlarm, kMaxNumOfAlarms> schedule_;  // Min-heap by time of next alarm
+    uint8_t                                     schedule_size_;
+    bool                                        is_alarm_enabled_;
+    AlarmHandler*                               alarm_handler_;
+    time_t                                      last_check_time_;  // Time before step of clock
+    Utils::TimerWheel::Id                       timer_id_;
 };
 
 #endif  // SRC_CONTROL_TIMER_H_
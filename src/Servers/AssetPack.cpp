@@ -0,0 +1,135 @@
+#include "AssetPack.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <rom/crc.h>
+
+#include "src/Utils/Hash.h"
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr uint32_t kMagic{0x50414C53};  // "SLAP"
+constexpr uint16_t kFormatVersion{1};
+
+constexpr esp_partition_subtype_t kPartitionSubtype{static_cast<esp_partition_subtype_t>(0x40)};
+constexpr char const*             kPartitionLabel{"assets"};
+
+}  // namespace
+
+namespace Servers
+{
+AssetPack::~AssetPack()
+{
+    unmap();
+}
+
+bool
+AssetPack::begin()
+{
+    if (!map()) {
+        DEBUG_PRINTLN("Asset pack is not found");
+        return false;
+    }
+    if (!is_valid()) {
+        DEBUG_PRINTLN("ERROR: asset pack is corrupted");
+        unmap();
+        return false;
+    }
+
+    auto const* header = reinterpret_cast<Header const*>(image_);
+    files_             = reinterpret_cast<FileEntry const*>(image_ + sizeof(Header));
+    num_of_files_      = header->num_of_files;
+    DEBUG_PRINTLN(String{"Asset pack loaded. Files: "} + String{num_of_files_});
+    return true;
+}
+
+bool
+AssetPack::find(String const& path, Asset& asset) const
+{
+    if (files_ == nullptr) {
+        return false;
+    }
+
+    uint32_t hash{Utils::fnv1a_hash(path.c_str())};
+    auto     file = std::lower_bound(files_, files_ + num_of_files_, hash, [](FileEntry const& entry, uint32_t hash) {
+        return entry.path_hash < hash;
+    });
+    for (; (file != files_ + num_of_files_) && (file->path_hash == hash); ++file) {
+        if (strcmp(reinterpret_cast<char const*>(image_ + file->path_offset), path.c_str()) == 0) {
+            asset.data = image_ + file->content_offset;
+            asset.size = file->content_size;
+            asset.crc  = file->content_crc;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+AssetPack::exists(String const& path) const
+{
+    Asset asset;
+    return find(path, asset);
+}
+
+bool
+AssetPack::map()
+{
+    auto const* partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, kPartitionSubtype, kPartitionLabel);
+    if (partition == nullptr) {
+        return false;
+    }
+    void const* image;
+    if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &image, &mmap_handle_) != ESP_OK) {
+        DEBUG_PRINTLN("ERROR: can not map asset pack partition");
+        return false;
+    }
+    image_       = static_cast<uint8_t const*>(image);
+    mapped_size_ = partition->size;
+    return true;
+}
+
+void
+AssetPack::unmap()
+{
+    if (image_ != nullptr) {
+        spi_flash_munmap(mmap_handle_);
+    }
+    image_        = nullptr;
+    mapped_size_  = 0;
+    files_        = nullptr;
+    num_of_files_ = 0;
+}
+
+bool
+AssetPack::is_valid() const
+{
+    if (mapped_size_ < sizeof(Header)) {
+        return false;
+    }
+    auto const* header = reinterpret_cast<Header const*>(image_);
+    if ((header->magic != kMagic) || (header->version != kFormatVersion) || (header->image_size > mapped_size_) ||
+        (sizeof(Header) + header->num_of_files * sizeof(FileEntry) > header->image_size)) {
+        return false;
+    }
+    if (crc32_le(0, image_ + sizeof(Header), header->image_size - sizeof(Header)) != header->crc) {
+        return false;
+    }
+
+    // Image is valid, but make sure that broken packer can not make server read outside of it
+    auto const* files = reinterpret_cast<FileEntry const*>(image_ + sizeof(Header));
+    for (uint16_t i = 0; i < header->num_of_files; ++i) {
+        if ((files[i].path_offset >= header->image_size) ||
+            (memchr(image_ + files[i].path_offset, '\0', header->image_size - files[i].path_offset) == nullptr) ||
+            (files[i].content_offset > header->image_size) ||
+            (files[i].content_size > header->image_size - files[i].content_offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace Servers
@@ -0,0 +1,79 @@
+#ifndef SRC_SERVERS_ASSETPACK_H_
+#define SRC_SERVERS_ASSETPACK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <WString.h>
+
+#include <esp_partition.h>
+
+namespace Servers
+{
+// Read-only pack of web UI files, which is written to its own flash partition ("assets" in partitions.csv) by
+// tools/pack_asset_image.py. Partition is memory-mapped, so file is found without filesystem calls and is sent right
+// from flash, without allocation of buffers.
+//
+// Image (all numbers are little-endian):
+// - header: magic "SLAP", format version (2 bytes), number of files (2 bytes), image size (4 bytes), CRC32 of the rest
+//   of image (4 bytes)
+// - table of files, sorted by hash of path: FNV-1a hash of path, offset of path, offset of content, size of content,
+//   CRC32 of content (4 bytes each)
+// - null-terminated paths
+// - contents, aligned to 4 bytes. Compressed variants of files are stored as separate files (ex. "/style.css.br")
+//
+// Pack can not be changed by web server. File, uploaded to FS, overrides file of pack with the same path (see
+// SadLampWebServer::handle_file_read()).
+class AssetPack
+{
+public:
+    struct Asset
+    {
+        uint8_t const* data;
+        size_t         size;
+        uint32_t       crc;  // CRC32 of content
+    };
+
+    AssetPack() = default;
+    AssetPack(AssetPack const&) = delete;
+    AssetPack& operator=(AssetPack const&) = delete;
+    ~AssetPack();
+
+    // Return false if partition does not contain valid image. All files are not found then
+    bool begin();
+
+    bool find(String const& path, Asset& asset) const;
+    bool exists(String const& path) const;
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t num_of_files;
+        uint32_t image_size;
+        uint32_t crc;
+    };
+    struct FileEntry
+    {
+        uint32_t path_hash;
+        uint32_t path_offset;
+        uint32_t content_offset;
+        uint32_t content_size;
+        uint32_t content_crc;
+    };
+
+    bool map();
+    void unmap();
+    bool is_valid() const;
+
+    uint8_t const*   image_{nullptr};
+    size_t           mapped_size_{0};
+    FileEntry const* files_{nullptr};
+    uint16_t         num_of_files_{0};
+    spi_flash_mmap_handle_t mmap_handle_{0};
+};
+
+}  // namespace Servers
+
+#endif  // SRC_SERVERS_ASSETPACK_H_
@@ -3,11 +3,22 @@
 #include "src/Utils/BufferedLogger.h"
 #include "src/Utils/Logger.h"
 
+namespace
+{
+constexpr uint32_t kSendingPeriodMs{1000};
+}  // namespace
+
 namespace Servers
 {
 DebugServer::DebugServer(SadLampWebSocketServer& web_socket_server)
   : web_socket_server_(web_socket_server)
+  , timer_id_{Utils::TimerWheel::kInvalidId}
+{
+}
+
+DebugServer::~DebugServer()
 {
+    Utils::TimerWheel::instance().remove(timer_id_);
 }
 
 void
@@ -31,20 +42,14 @@ DebugServer::init()
                 std::remove(debugger_clients_ids_.begin(), debugger_clients_ids_.end(), client_id),
                 debugger_clients_ids_.end());
         });
+    // Logs are not urgent, so they go after control of light
+    timer_id_ = Utils::TimerWheel::instance().add("debug_server", kSendingPeriodMs, kSendingPeriodMs,
+                                                  Utils::TimerWheel::Priority::kLow,
+                                                  [this]() { send_buffered_logs(); });
 
     DEBUG_PRINTLN("Debug server initialized");
 }
 
-void
-DebugServer::loop()
-{
-    static unsigned long last_print{0};
-    if (millis() - last_print > 1000) {
-        send_buffered_logs();
-        last_print = millis();
-    }
-}
-
 void
 DebugServer::send_buffered_logs()
 {
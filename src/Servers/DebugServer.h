@@ -4,22 +4,27 @@
 #include <vector>
 
 #include "SadLampWebSocketServer.h"
+#include "src/Utils/TimerWheel.h"
 
 namespace Servers
 {
-// Uses BufferedLogger singleton to get buffered logs and send them to all connected debugger clients
+// Uses BufferedLogger singleton to get buffered logs and send them to all connected debugger clients. Logs are sent
+// by TimerWheel once per second
 class DebugServer
 {
 public:
     explicit DebugServer(SadLampWebSocketServer& web_socket_server);
+    DebugServer(DebugServer const&) = delete;
+    DebugServer& operator=(DebugServer const&) = delete;
+    ~DebugServer();
     void init();
-    void loop();
 
 private:
     void send_buffered_logs();
 
     SadLampWebSocketServer& web_socket_server_;
     std::vector<uint8_t>    debugger_clients_ids_;
+    Utils::TimerWheel::Id   timer_id_;
 };
 
 }  // namespace Servers
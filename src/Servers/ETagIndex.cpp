@@ -0,0 +1,286 @@
+#include "ETagIndex.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <Arduino.h>
+#include <rom/crc.h>
+
+#include "src/Utils/FS.h"
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr size_t        kReadChunkSize{512};
+// Reading of bigger file would delay response and other connections. ETag of such file is calculated in loop()
+constexpr size_t        kMaxCalculatedFileSize{4 * 1024};
+constexpr size_t        kMaxQueuedFiles{8};
+constexpr unsigned long kCalculationBudgetMs{5};  // Time of calculation of ETags per loop()
+
+String
+without_trailing_slash(String path)
+{
+    if (path.endsWith("/")) {
+        path.remove(path.length() - 1);
+    }
+    return path;
+}
+
+bool
+is_nested(String const& path, String const& folder)
+{
+    return path.startsWith(folder) && (path.length() > folder.length()) && (path[folder.length()] == '/');
+}
+
+}  // namespace
+
+namespace Servers
+{
+constexpr char const* ETagIndex::kIndexPath;
+
+// Index file is text. Line per file: "<CRC32 hex> <size hex> <path>\n"
+void
+ETagIndex::load()
+{
+    entries_.clear();
+    external_change_count_ = Utils::FS::get_external_change_count();
+    Utils::FS::File file{Utils::FS::open(kIndexPath, Utils::FS::OpenMode::kRead)};
+    if (!file) {
+        return;
+    }
+    std::vector<char> data(file.size() + 1, '\0');
+    data.resize(file.read(reinterpret_cast<uint8_t*>(data.data()), data.size() - 1) + 1);
+    data.back() = '\0';
+    Utils::FS::close(file);
+
+    char* line{data.data()};
+    while (*line != '\0') {
+        char* line_end{strchr(line, '\n')};
+        if (line_end == nullptr) {
+            break;  // Incomplete line. Index was not written completely
+        }
+        *line_end = '\0';
+
+        char* end;
+        Entry entry;
+        entry.crc  = strtoul(line, &end, 16);
+        entry.size = strtoul(end, &end, 16);
+        if (*end == ' ') {
+            entries_[String{end + 1}] = entry;
+        }
+        line = line_end + 1;
+    }
+    DEBUG_PRINTLN(String{"ETag index loaded. Files: "} + String{entries_.size()});
+}
+
+// File is read by parts. The next file is taken from queue, when the current one is finished
+void
+ETagIndex::loop()
+{
+    drop_if_changed_externally();
+    if (!calculated_file_) {
+        if (queued_paths_.empty()) {
+            return;
+        }
+        calculated_path_ = queued_paths_.front();
+        queued_paths_.erase(queued_paths_.begin());
+        calculated_file_  = Utils::FS::open(calculated_path_, Utils::FS::OpenMode::kRead);
+        calculated_entry_ = Entry{0, 0};
+        if (!calculated_file_) {
+            calculated_path_ = String{};
+            return;
+        }
+    }
+
+    uint8_t       buffer[kReadChunkSize];
+    unsigned long start_ms{millis()};
+    while (millis() - start_ms < kCalculationBudgetMs) {
+        size_t size{calculated_file_.read(buffer, sizeof(buffer))};
+        if (size == 0) {
+            finish_calculation();
+            return;
+        }
+        calculated_entry_.crc = crc32_le(calculated_entry_.crc, buffer, size);
+        calculated_entry_.size += size;
+    }
+}
+
+String
+ETagIndex::get(String const& path)
+{
+    if (path == kIndexPath) {
+        return String{};  // Index file itself is never given an ETag
+    }
+
+    // Size is taken first: it also checks FS for external changes
+    auto file_size = Utils::FS::get_file_size(path);
+    drop_if_changed_externally();
+    auto it = entries_.find(path);
+    if ((it != entries_.end()) && (it->second.size == file_size)) {
+        return make_etag(it->second.crc, it->second.size);
+    }
+    if (it != entries_.end()) {
+        entries_.erase(it);  // File is changed bypassing web server
+    }
+
+    if (file_size > kMaxCalculatedFileSize) {
+        queue_calculation(path);
+        return String{};
+    }
+    // Index is not written here: request should not wait for writing to flash. Calculated ETag is kept in RAM and gets
+    // to index file with the next upload
+    Entry entry;
+    if (!calculate(path, entry)) {
+        return String{};
+    }
+    entries_[path] = entry;
+    return make_etag(entry.crc, entry.size);
+}
+
+void
+ETagIndex::set(String const& path, uint32_t crc, size_t size)
+{
+    entries_[path] = Entry{crc, size};
+    save();
+}
+
+void
+ETagIndex::remove(String const& entry_path)
+{
+    String path{without_trailing_slash(entry_path)};
+    bool   is_changed{false};
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if ((it->first == path) || is_nested(it->first, path)) {
+            it         = entries_.erase(it);
+            is_changed = true;
+        }
+        else {
+            ++it;
+        }
+    }
+    if (is_changed) {
+        save();
+    }
+}
+
+void
+ETagIndex::rename(String const& from_path, String const& to_path)
+{
+    String                  from{without_trailing_slash(from_path)};
+    String                  to{without_trailing_slash(to_path)};
+    std::map<String, Entry> renamed;
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if ((it->first == from) || is_nested(it->first, from)) {
+            renamed[to + it->first.substring(from.length())] = it->second;
+            it = entries_.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    if (!renamed.empty()) {
+        entries_.insert(renamed.begin(), renamed.end());
+        save();
+    }
+}
+
+String
+ETagIndex::make_etag(uint32_t crc, size_t size)
+{
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "\"%08lx-%lx\"", (unsigned long)crc, (unsigned long)size);
+    return String{buffer};
+}
+
+bool
+ETagIndex::calculate(String const& path, Entry& entry)
+{
+    Utils::FS::File file{Utils::FS::open(path, Utils::FS::OpenMode::kRead)};
+    if (!file) {
+        return false;
+    }
+
+    uint8_t buffer[kReadChunkSize];
+    entry.crc  = 0;
+    entry.size = 0;
+    size_t size;
+    while ((size = file.read(buffer, sizeof(buffer))) > 0) {
+        entry.crc = crc32_le(entry.crc, buffer, size);
+        entry.size += size;
+    }
+    Utils::FS::close(file);
+    return true;
+}
+
+void
+ETagIndex::queue_calculation(String const& path)
+{
+    if ((path != calculated_path_) && (queued_paths_.size() < kMaxQueuedFiles) &&
+        (std::find(queued_paths_.begin(), queued_paths_.end(), path) == queued_paths_.end())) {
+        queued_paths_.push_back(path);
+    }
+}
+
+// ETag is kept, if file was not uploaded or changed while it was being read. Index is written here, because big files
+// are rare and their ETags should not be calculated again after reboot
+void
+ETagIndex::finish_calculation()
+{
+    Utils::FS::close(calculated_file_);
+    String path{calculated_path_};
+    calculated_path_ = String{};
+
+    auto file_size = Utils::FS::get_file_size(path);
+    if (!drop_if_changed_externally() && (file_size == calculated_entry_.size) &&
+        (entries_.find(path) == entries_.end())) {
+        entries_[path] = calculated_entry_;
+        save();
+    }
+}
+
+// Return true if ETags are dropped. Calculation in progress is aborted: file could be changed while it was being read
+bool
+ETagIndex::drop_if_changed_externally()
+{
+    auto external_change_count = Utils::FS::get_external_change_count();
+    if (external_change_count == external_change_count_) {
+        return false;
+    }
+    external_change_count_ = external_change_count;
+    DEBUG_PRINTLN("FS is changed outside of web server. ETags are dropped");
+    entries_.clear();
+    save();
+    if (calculated_file_) {
+        Utils::FS::close(calculated_file_);
+        queued_paths_.insert(queued_paths_.begin(), calculated_path_);
+        calculated_path_ = String{};
+    }
+    return true;
+}
+
+void
+ETagIndex::save() const
+{
+    Utils::FS::File file{Utils::FS::open(kIndexPath, Utils::FS::OpenMode::kWrite)};
+    if (!file) {
+        DEBUG_PRINTLN("ERROR: can not write ETag index");
+        return;
+    }
+
+    String line;
+    for (auto const& entry : entries_) {
+        char buffer[24];
+        snprintf(
+            buffer, sizeof(buffer), "%lx %lx ", (unsigned long)entry.second.crc, (unsigned long)entry.second.size);
+        line = buffer;
+        line += entry.first + '\n';
+        Utils::FS::write(file, reinterpret_cast<uint8_t const*>(line.c_str()), line.length());
+    }
+    Utils::FS::close(file);
+}
+
+}  // namespace Servers
@@ -0,0 +1,61 @@
+#ifndef SRC_SERVERS_ETAGINDEX_H_
+#define SRC_SERVERS_ETAGINDEX_H_
+
+#include <map>
+#include <vector>
+
+#include <WString.h>
+
+#include "src/Utils/FS.h"
+
+namespace Servers
+{
+// Strong ETags of files on FS. ETag is built from CRC32 of file content and its size. It is calculated, when file is
+// uploaded, and is kept in sidecar index file, so it is not needed to read file to check if client's copy is still
+// valid. ETag of small file, which is not in index (ex. it was flashed as part of FS image), is calculated at its first
+// request. ETag of bigger file is calculated by parts in loop() after its first request, which is replied without ETag.
+// Files, changed bypassing web server (ex. via FTP), are detected by change of size or by Utils::FS (see
+// Utils::FS::get_external_change_count()). In the latter case changed file is unknown, so all ETags are dropped.
+class ETagIndex
+{
+public:
+    static constexpr char const* kIndexPath{"/.etags"};
+
+    void load();
+    // Calculate ETags of requested big files
+    void loop();
+
+    // Return quoted ETag or empty string if file can not be read or its ETag is not calculated yet
+    String get(String const& path);
+    // "crc" is CRC32 of entire content of file
+    void set(String const& path, uint32_t crc, size_t size);
+    // Remove entries of file or of all files in folder
+    void remove(String const& path);
+    void rename(String const& from, String const& to);
+
+    static String make_etag(uint32_t crc, size_t size);
+
+private:
+    struct Entry
+    {
+        uint32_t crc;
+        size_t   size;
+    };
+
+    static bool calculate(String const& path, Entry& entry);
+    void        queue_calculation(String const& path);
+    void        finish_calculation();
+    bool        drop_if_changed_externally();
+    void        save() const;
+
+    std::map<String, Entry> entries_;
+    uint32_t                external_change_count_{0};
+    std::vector<String>     queued_paths_;  // Big files, whose ETags are calculated in loop()
+    String                  calculated_path_;
+    Utils::FS::File         calculated_file_;
+    Entry                   calculated_entry_{0, 0};
+};
+
+}  // namespace Servers
+
+#endif  // SRC_SERVERS_ETAGINDEX_H_
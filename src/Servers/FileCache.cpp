@@ -0,0 +1,123 @@
+#include "FileCache.h"
+
+#include <stdlib.h>
+
+#include <iterator>
+
+#include <Arduino.h>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+// Without PSRAM budget is enough for the most used pages and scripts of UI
+constexpr size_t kRamBudget{40 * 1024};
+constexpr size_t kRamMaxFileSize{20 * 1024};
+constexpr size_t kPsramBudget{512 * 1024};
+constexpr size_t kPsramMaxFileSize{128 * 1024};
+
+bool
+is_nested(String const& path, String const& folder)
+{
+    return path.startsWith(folder) && (path.length() > folder.length()) &&
+           ((path[folder.length()] == '/') || folder.endsWith("/"));
+}
+
+uint8_t*
+allocate(size_t size)
+{
+    void* data{psramFound() ? ps_malloc(size) : nullptr};
+    if (data == nullptr) {
+        data = malloc(size);
+    }
+    return static_cast<uint8_t*>(data);
+}
+
+}  // namespace
+
+namespace Servers
+{
+FileCache::FileCache()
+  : budget_{psramFound() ? kPsramBudget : kRamBudget}
+  , max_file_size_{psramFound() ? kPsramMaxFileSize : kRamMaxFileSize}
+{
+}
+
+FileCache::Buffer
+FileCache::get(String const& path, String const& etag, size_t& size)
+{
+    auto it = index_.find(path);
+    if ((it == index_.end()) || (it->second->etag != etag)) {
+        ++misses_;
+        return Buffer{};
+    }
+
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);  // Iterators stay valid
+    size = it->second->size;
+    return it->second->data;
+}
+
+FileCache::Buffer
+FileCache::put(String const& path, String const& etag, Utils::FS::File& file)
+{
+    size_t size{file.size()};
+    if ((size == 0) || (size > max_file_size_)) {
+        return Buffer{};
+    }
+
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        erase(it->second);
+    }
+    while (used_bytes_ + size > budget_) {
+        erase(std::prev(entries_.end()));
+    }
+
+    uint8_t* data{allocate(size)};
+    if (data == nullptr) {
+        DEBUG_PRINTLN(String{"ERROR: not enough memory to cache "} + path);
+        return Buffer{};
+    }
+    Buffer buffer{data, [](uint8_t const* data) { free(const_cast<uint8_t*>(data)); }};
+    if (file.read(data, size) != size) {
+        DEBUG_PRINTLN(String{"ERROR: can not read "} + path);
+        file.seek(0);  // Let caller send file without cache
+        return Buffer{};
+    }
+
+    entries_.push_front(Entry{path, etag, buffer, size});
+    index_[path] = entries_.begin();
+    used_bytes_ += size;
+    return buffer;
+}
+
+void
+FileCache::invalidate(String const& path)
+{
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        auto next = std::next(it);
+        if ((it->path == path) || is_nested(it->path, path)) {
+            erase(it);
+        }
+        it = next;
+    }
+}
+
+String
+FileCache::get_stats_json() const
+{
+    return String{"{\"hits\":"} + String{hits_} + ",\"misses\":" + String{misses_} +
+           ",\"files\":" + String{entries_.size()} + ",\"used_bytes\":" + String{used_bytes_} +
+           ",\"budget_bytes\":" + String{budget_} + "}";
+}
+
+void
+FileCache::erase(Entries::iterator entry)
+{
+    used_bytes_ -= entry->size;
+    index_.erase(entry->path);
+    entries_.erase(entry);
+}
+
+}  // namespace Servers
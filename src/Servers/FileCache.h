@@ -0,0 +1,58 @@
+#ifndef SRC_SERVERS_FILECACHE_H_
+#define SRC_SERVERS_FILECACHE_H_
+
+#include <list>
+#include <map>
+
+#include <WString.h>
+
+#include "HttpServer.h"
+#include "src/Utils/FS.h"
+
+namespace Servers
+{
+// LRU cache of small files in RAM (or in PSRAM, if it is available). Total size of cached files is limited by budget:
+// when new file does not fit, least recently used files are evicted. Every file is cached together with its ETag, so
+// cached copy is used only while file is not changed.
+// Buffers are shared with HttpServer, so file, which is evicted while it is being sent, stays in memory till the end
+// of response.
+class FileCache
+{
+public:
+    using Buffer = HttpServer::SharedBuffer;
+
+    FileCache();
+
+    // Return empty buffer if file is not cached or ETag of cached copy is different
+    Buffer get(String const& path, String const& etag, size_t& size);
+    // Read file to cache. Return empty buffer if file is too big or there is not enough memory
+    Buffer put(String const& path, String const& etag, Utils::FS::File& file);
+    // Remove file or all files in folder
+    void invalidate(String const& path);
+
+    String get_stats_json() const;
+
+private:
+    struct Entry
+    {
+        String path;
+        String etag;
+        Buffer data;
+        size_t size;
+    };
+    using Entries = std::list<Entry>;
+
+    void erase(Entries::iterator entry);
+
+    size_t                              budget_;
+    size_t                              max_file_size_;
+    size_t                              used_bytes_{0};
+    uint32_t                            hits_{0};
+    uint32_t                            misses_{0};
+    Entries                             entries_;  // The most recently used file is the first one
+    std::map<String, Entries::iterator> index_;
+};
+
+}  // namespace Servers
+
+#endif  // SRC_SERVERS_FILECACHE_H_
@@ -0,0 +1,1190 @@
+#include "HttpServer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <lwip/sockets.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "src/Utils/Logger.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace
+{
+constexpr size_t        kReceiveChunkSize{1460};  // TCP MSS
+constexpr size_t        kSendChunkSize{1460};
+constexpr size_t        kMaxHeadSize{2048};
+constexpr size_t        kMaxFormSize{1024};
+constexpr unsigned long kConnectionTimeoutMs{5000};  // Also timeout of idle persistent connection
+constexpr uint16_t      kMaxRequestsPerConnection{100};
+constexpr size_t        kUnknownContentLength{SIZE_MAX};  // Content is produced while it is being sent
+constexpr size_t        kChunkHeadSize{6};                // Chunk size in hex (up to 4 digits) and "\r\n"
+constexpr char          kHeadEnd[]        = "\r\n\r\n";
+constexpr size_t        kHeadEndSize      = sizeof(kHeadEnd) - 1;
+constexpr char          kContinue[]       = "HTTP/1.1 100 Continue\r\n\r\n";
+constexpr char          kTextPlain[]      = "text/plain";
+constexpr char          kMultipartForm[]  = "multipart/form-data";
+constexpr char          kUrlEncodedForm[] = "application/x-www-form-urlencoded";
+
+bool
+set_non_blocking(int socket, bool is_non_blocking)
+{
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    flags = is_non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) == 0;
+}
+
+bool
+is_would_block_error()
+{
+    return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+}
+
+// Return position of pattern in data or size of data if pattern is not found
+size_t
+find(std::vector<uint8_t> const& data, char const* pattern, size_t pattern_size)
+{
+    return std::search(data.begin(), data.end(), pattern, pattern + pattern_size) - data.begin();
+}
+
+void
+append(std::vector<uint8_t>& data, String const& str)
+{
+    data.insert(data.end(), str.c_str(), str.c_str() + str.length());
+}
+
+int8_t
+hex_digit_value(char c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F')) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// '+' means space only in query and in form data, but not in path
+String
+url_decode(char const* str, size_t length, bool is_plus_space)
+{
+    String result;
+    result.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+        if ((str[i] == '+') && is_plus_space) {
+            result += ' ';
+        }
+        else if ((str[i] == '%') && (i + 2 < length) && (hex_digit_value(str[i + 1]) >= 0) &&
+                 (hex_digit_value(str[i + 2]) >= 0)) {
+            result += static_cast<char>((hex_digit_value(str[i + 1]) << 4) | hex_digit_value(str[i + 2]));
+            i += 2;
+        }
+        else {
+            result += str[i];
+        }
+    }
+    return result;
+}
+
+// "name1=value1&name2=value2"
+void
+parse_args(char const* str, size_t length, std::vector<std::pair<String, String>>& args)
+{
+    size_t start{0};
+    while (start < length) {
+        size_t end{start};
+        while ((end < length) && (str[end] != '&')) {
+            ++end;
+        }
+        size_t equal{start};
+        while ((equal < end) && (str[equal] != '=')) {
+            ++equal;
+        }
+        if (end > start) {
+            args.emplace_back(url_decode(str + start, equal - start, true),
+                              (equal < end) ? url_decode(str + equal + 1, end - equal - 1, true) : String{});
+        }
+        start = end + 1;
+    }
+}
+
+// Return pointer to null-terminated line and move cursor to the next line. Return nullptr if there are no more lines
+char*
+next_line(char*& cursor)
+{
+    if ((cursor == nullptr) || (*cursor == '\0')) {
+        return nullptr;
+    }
+    char* line{cursor};
+    char* line_end{strstr(cursor, "\r\n")};
+    if (line_end == nullptr) {
+        cursor = nullptr;
+    }
+    else {
+        *line_end = '\0';
+        cursor    = line_end + 2;
+    }
+    return line;
+}
+
+// Return value of quoted parameter (ex. name="value") or empty string
+String
+get_quoted_parameter(char const* line, char const* parameter)
+{
+    char const* start{strstr(line, parameter)};
+    if (start == nullptr) {
+        return String{};
+    }
+    start += strlen(parameter);
+    char const* end{strchr(start, '"')};
+    if (end == nullptr) {
+        return String{};
+    }
+    String result;
+    result.reserve(end - start);
+    for (; start < end; ++start) {
+        result += *start;
+    }
+    return result;
+}
+
+String
+find_value(std::vector<std::pair<String, String>> const& pairs, String const& name, bool is_case_sensitive)
+{
+    for (auto const& pair : pairs) {
+        if (is_case_sensitive ? (pair.first == name) : pair.first.equalsIgnoreCase(name)) {
+            return pair.second;
+        }
+    }
+    return String{};
+}
+
+Servers::HttpServer::Method
+parse_method(char const* str)
+{
+    using Method = Servers::HttpServer::Method;
+    if (strcmp(str, "GET") == 0) {
+        return Method::kGet;
+    }
+    else if (strcmp(str, "HEAD") == 0) {
+        return Method::kHead;
+    }
+    else if (strcmp(str, "POST") == 0) {
+        return Method::kPost;
+    }
+    else if (strcmp(str, "PUT") == 0) {
+        return Method::kPut;
+    }
+    else if (strcmp(str, "DELETE") == 0) {
+        return Method::kDelete;
+    }
+    else if (strcmp(str, "OPTIONS") == 0) {
+        return Method::kOptions;
+    }
+    return Method::kUnknown;
+}
+
+char const*
+get_reason_phrase(int code)
+{
+    switch (code) {
+    case 200:
+        return "OK";
+    case 206:
+        return "Partial Content";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 413:
+        return "Payload Too Large";
+    case 416:
+        return "Range Not Satisfiable";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "";
+    }
+}
+
+enum class RangeType : uint8_t
+{
+    kNone = 0,  // Whole content should be sent
+    kSatisfiable,
+    kUnsatisfiable
+};
+
+// Only single range is supported: "bytes=first-last", "bytes=first-" or "bytes=-suffix_length". If range is invalid or
+// there are several ranges, whole content is sent
+RangeType
+parse_range(String const& range, size_t size, size_t& first, size_t& last)
+{
+    if (!range.startsWith("bytes=") || (range.indexOf(',') != -1)) {
+        return RangeType::kNone;
+    }
+
+    char const* spec{range.c_str() + 6};
+    char*       end;
+    if (*spec == '-') {
+        size_t suffix_length{strtoul(spec + 1, &end, 10)};
+        if ((end == spec + 1) || (*end != '\0')) {
+            return RangeType::kNone;
+        }
+        if ((suffix_length == 0) || (size == 0)) {
+            return RangeType::kUnsatisfiable;
+        }
+        first = (size > suffix_length) ? size - suffix_length : 0;
+        last  = size - 1;
+        return RangeType::kSatisfiable;
+    }
+
+    first = strtoul(spec, &end, 10);
+    if ((end == spec) || (*end != '-')) {
+        return RangeType::kNone;
+    }
+    char const* last_str{end + 1};
+    last = strtoul(last_str, &end, 10);
+    if (end == last_str) {
+        last = SIZE_MAX;  // Up to the end of content
+    }
+    else if ((*end != '\0') || (last < first)) {
+        return RangeType::kNone;
+    }
+    if (first >= size) {
+        return RangeType::kUnsatisfiable;
+    }
+    last = std::min(last, size - 1);
+    return RangeType::kSatisfiable;
+}
+
+}  // namespace
+
+namespace Servers
+{
+HttpServer::HttpServer(uint16_t port, uint8_t max_num_of_connections)
+  : port_{port}
+  , connections_(max_num_of_connections)
+{
+}
+
+HttpServer::~HttpServer()
+{
+    for (auto& connection : connections_) {
+        close(connection);
+    }
+    if (listen_socket_ >= 0) {
+        ::close(listen_socket_);
+    }
+}
+
+bool
+HttpServer::begin()
+{
+    listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket_ < 0) {
+        DEBUG_PRINTLN("ERROR: can not create socket for HTTP server");
+        return false;
+    }
+
+    int enable{1};
+    setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port        = htons(port_);
+    if ((bind(listen_socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) ||
+        (listen(listen_socket_, connections_.size()) < 0) || !set_non_blocking(listen_socket_, true)) {
+        DEBUG_PRINTLN(String{"ERROR: can not listen on port "} + String{port_} + ". Error " + String{errno});
+        ::close(listen_socket_);
+        listen_socket_ = -1;
+        return false;
+    }
+    return true;
+}
+
+void
+HttpServer::loop()
+{
+    if (listen_socket_ < 0) {
+        return;
+    }
+
+    accept_connections();
+    for (auto& connection : connections_) {
+        switch (connection.state) {
+        case State::kFree:
+            break;
+        case State::kReadingHead:
+        case State::kReadingBody:
+            if (connection.is_input_pending) {
+                // Pipelined request, which was received together with previous one
+                connection.is_input_pending = false;
+                process_input(connection);
+            }
+            else {
+                receive(connection);
+            }
+            break;
+        case State::kSending:
+            if (send_pending(connection)) {
+                finish_request(connection);
+            }
+            break;
+        }
+
+        if ((connection.state != State::kFree) &&
+            ((millis() - connection.last_activity_time) >= kConnectionTimeoutMs)) {
+            if (!is_idle(connection)) {
+                DEBUG_PRINTLN(String{"HTTP connection timeout: "} + connection.uri);
+            }
+            close(connection);
+        }
+    }
+}
+
+void
+HttpServer::on(String const& uri, Method method, Handler handler, Handler upload_handler)
+{
+    routes_.push_back(Route{uri, method, handler, upload_handler});
+}
+
+void
+HttpServer::on_not_found(Handler handler)
+{
+    not_found_handler_ = handler;
+}
+
+HttpServer::Method
+HttpServer::method() const
+{
+    return current_->method;
+}
+
+String const&
+HttpServer::uri() const
+{
+    return current_->uri;
+}
+
+size_t
+HttpServer::args() const
+{
+    return current_->args.size();
+}
+
+String
+HttpServer::arg(size_t index) const
+{
+    return (index < current_->args.size()) ? current_->args[index].second : String{};
+}
+
+String
+HttpServer::arg(String const& name) const
+{
+    return find_value(current_->args, name, true);
+}
+
+bool
+HttpServer::has_arg(String const& name) const
+{
+    return std::any_of(current_->args.begin(), current_->args.end(),
+                       [&name](std::pair<String, String> const& arg) { return arg.first == name; });
+}
+
+String
+HttpServer::header(String const& name) const
+{
+    return find_value(current_->headers, name, false);
+}
+
+HttpServer::Upload const&
+HttpServer::upload() const
+{
+    return current_->upload;
+}
+
+void
+HttpServer::send_header(String const& name, String const& value)
+{
+    current_->response_headers += name + ": " + value + "\r\n";
+    if (name.equalsIgnoreCase("ETag")) {
+        current_->response_etag = value;
+    }
+}
+
+void
+HttpServer::send(int code, char const* content_type, String const& content)
+{
+    send(code, content_type, reinterpret_cast<uint8_t const*>(content.c_str()), content.length());
+}
+
+void
+HttpServer::send(int code, char const* content_type, uint8_t const* content, size_t size)
+{
+    if (current_->is_response_queued) {
+        DEBUG_PRINTLN(String{"ERROR: response to "} + current_->uri + " is already sent");
+        return;
+    }
+    queue_response(code, content_type, size);
+    if (current_->method != Method::kHead) {
+        current_->out.insert(current_->out.end(), content, content + size);
+    }
+    if (current_->state == State::kSending) {
+        // Do not wait for the next loop(). Whatever fits in socket's buffer is sent right now
+        send_pending(*current_);
+    }
+}
+
+void
+HttpServer::send_shared(int code, char const* content_type, SharedBuffer content, size_t size)
+{
+    auto data = content.get();
+    queue_external_content(code, content_type, data, size, std::move(content));
+}
+
+void
+HttpServer::send_static(int code, char const* content_type, uint8_t const* content, size_t size)
+{
+    queue_external_content(code, content_type, content, size, SharedBuffer{});
+}
+
+void
+HttpServer::stream_file(Utils::FS::File& file, String const& content_type)
+{
+    if (current_->is_response_queued) {
+        DEBUG_PRINTLN(String{"ERROR: response to "} + current_->uri + " is already sent");
+        Utils::FS::close(file);
+        return;
+    }
+    size_t offset;
+    size_t length;
+    int    code{select_range(file.size(), offset, length)};
+    bool   is_content_sent{(current_->method != Method::kHead) && (length > 0)};
+    if (is_content_sent && !Utils::FS::seek(file, offset)) {
+        DEBUG_PRINTLN(String{"ERROR: can not seek in file "} + current_->uri);
+        Utils::FS::close(file);
+        current_->response_headers = String{};  // Headers of content
+        send(500, kTextPlain, String{get_reason_phrase(500)});
+        return;
+    }
+    queue_response(code, content_type.c_str(), length);
+    if (is_content_sent) {
+        current_->file           = file;
+        current_->file_remaining = length;
+        file                     = Utils::FS::File{};  // Connection owns the file now
+    }
+    else {
+        Utils::FS::close(file);
+    }
+    if (current_->state == State::kSending) {
+        send_pending(*current_);
+    }
+}
+
+void
+HttpServer::send_chunked(int code, char const* content_type, ContentProducer producer)
+{
+    if (current_->is_response_queued) {
+        DEBUG_PRINTLN(String{"ERROR: response to "} + current_->uri + " is already sent");
+        return;
+    }
+    if (!current_->is_http_1_1) {
+        // HTTP/1.0 does not support chunked encoding. End of content is marked by closing of connection
+        current_->is_keep_alive = false;
+    }
+    queue_response(code, content_type, kUnknownContentLength);
+    if (current_->method != Method::kHead) {
+        current_->producer = std::move(producer);
+    }
+    if (current_->state == State::kSending) {
+        send_pending(*current_);
+    }
+}
+
+int
+HttpServer::detach_client()
+{
+    int socket{current_->socket};
+    set_non_blocking(socket, false);
+    current_->socket        = -1;
+    current_->is_keep_alive = false;
+    return socket;
+}
+
+size_t
+HttpServer::request_count() const
+{
+    return current_->request_count;
+}
+
+void
+HttpServer::accept_connections()
+{
+    while (true) {
+        auto connection = std::find_if(connections_.begin(), connections_.end(),
+                                       [](Connection const& c) { return c.state == State::kFree; });
+        if (connection == connections_.end()) {
+            // All connections are busy. Close the oldest idle persistent connection if there is new client
+            unsigned long now{millis()};
+            for (auto it = connections_.begin(); it != connections_.end(); ++it) {
+                if (is_idle(*it) && ((connection == connections_.end()) ||
+                                     (now - it->last_activity_time > now - connection->last_activity_time))) {
+                    connection = it;
+                }
+            }
+            if ((connection == connections_.end()) || !has_pending_connection()) {
+                return;
+            }
+            close(*connection);
+        }
+
+        int socket{accept(listen_socket_, nullptr, nullptr)};
+        if (socket < 0) {
+            // There are no pending connections
+            return;
+        }
+        int enable{1};
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        set_non_blocking(socket, true);
+
+        connection->socket             = socket;
+        connection->state              = State::kReadingHead;
+        connection->last_activity_time = millis();
+    }
+}
+
+bool
+HttpServer::has_pending_connection() const
+{
+    fd_set sockets;
+    FD_ZERO(&sockets);
+    FD_SET(listen_socket_, &sockets);
+    timeval timeout{0, 0};
+    return select(listen_socket_ + 1, &sockets, nullptr, nullptr, &timeout) > 0;
+}
+
+bool
+HttpServer::is_idle(Connection const& connection)
+{
+    return (connection.state == State::kReadingHead) && (connection.request_count > 0) && connection.in.empty();
+}
+
+void
+HttpServer::receive(Connection& connection)
+{
+    uint8_t buffer[kReceiveChunkSize];
+    size_t  size_to_read{sizeof(buffer)};
+    if (connection.state == State::kReadingBody) {
+        size_to_read = std::min(size_to_read, connection.content_length - connection.body_received);
+    }
+
+    auto size = recv(connection.socket, buffer, size_to_read, 0);
+    if (size == 0) {
+        // Connection is closed by client
+        close(connection);
+        return;
+    }
+    if (size < 0) {
+        if (!is_would_block_error()) {
+            close(connection);
+        }
+        return;
+    }
+    connection.last_activity_time = millis();
+    connection.in.insert(connection.in.end(), buffer, buffer + size);
+    if (connection.state == State::kReadingBody) {
+        connection.body_received += size;
+    }
+    process_input(connection);
+}
+
+void
+HttpServer::process_input(Connection& connection)
+{
+    if (connection.state == State::kReadingHead) {
+        auto head_size = find(connection.in, kHeadEnd, kHeadEndSize);
+        if (head_size == connection.in.size()) {
+            if (connection.in.size() > kMaxHeadSize) {
+                reply_error(connection, 431);
+            }
+            return;
+        }
+        connection.in[head_size] = '\0';
+        if (!parse_head(connection, reinterpret_cast<char*>(connection.in.data()))) {
+            reply_error(connection, 400);
+            return;
+        }
+
+        // The rest is beginning of body. Anything after body is pipelined requests. They are processed after response
+        // is sent, so responses are in the same order as requests
+        connection.in.erase(connection.in.begin(), connection.in.begin() + head_size + kHeadEndSize);
+        if (connection.in.size() > connection.content_length) {
+            connection.pipelined.assign(connection.in.begin() + connection.content_length, connection.in.end());
+            connection.in.resize(connection.content_length);
+        }
+        connection.body_received = connection.in.size();
+        connection.state         = State::kReadingBody;
+        if (connection.body_type == BodyType::kMultipart) {
+            // First delimiter is not preceded by CRLF. Add it to find all delimiters in the same way
+            connection.in.insert(connection.in.begin(), {'\r', '\n'});
+        }
+    }
+    process_body(connection);
+}
+
+bool
+HttpServer::parse_head(Connection& connection, char* head)
+{
+    // Request line: "METHOD URI HTTP/1.x"
+    char* cursor{head};
+    char* line{next_line(cursor)};
+    char* method_end{(line != nullptr) ? strchr(line, ' ') : nullptr};
+    if (method_end == nullptr) {
+        return false;
+    }
+    *method_end = '\0';
+    char* uri{method_end + 1};
+    char* uri_end{strchr(uri, ' ')};
+    if ((uri_end == nullptr) || (strncmp(uri_end + 1, "HTTP/1.", 7) != 0)) {
+        return false;
+    }
+    *uri_end = '\0';
+    connection.is_http_1_1 = (uri_end[8] == '1');
+
+    connection.method = parse_method(line);
+    char* query{strchr(uri, '?')};
+    if (query == nullptr) {
+        connection.uri = url_decode(uri, uri_end - uri, false);
+    }
+    else {
+        connection.uri = url_decode(uri, query - uri, false);
+        parse_args(query + 1, uri_end - query - 1, connection.args);
+    }
+
+    // Headers: "Name: value"
+    while ((line = next_line(cursor)) != nullptr) {
+        char* colon{strchr(line, ':')};
+        if (colon == nullptr) {
+            return false;
+        }
+        *colon = '\0';
+        String value{colon + 1};
+        value.trim();
+        connection.headers.emplace_back(String{line}, std::move(value));
+    }
+
+    // Connections of HTTP/1.1 are persistent by default
+    String connection_header{find_value(connection.headers, "Connection", false)};
+    ++connection.request_count;
+    connection.is_keep_alive = (connection.is_http_1_1 ? !connection_header.equalsIgnoreCase("close")
+                                                       : connection_header.equalsIgnoreCase("keep-alive")) &&
+                               (connection.request_count < kMaxRequestsPerConnection);
+
+    connection.content_length = strtoul(find_value(connection.headers, "Content-Length", false).c_str(), nullptr, 10);
+    String content_type{find_value(connection.headers, "Content-Type", false)};
+    if (content_type.startsWith(kMultipartForm)) {
+        auto boundary_start = content_type.indexOf("boundary=");
+        if (boundary_start < 0) {
+            return false;
+        }
+        String boundary{content_type.substring(boundary_start + 9)};
+        auto   boundary_end = boundary.indexOf(';');
+        if (boundary_end >= 0) {
+            boundary = boundary.substring(0, boundary_end);
+        }
+        boundary.trim();
+        if (boundary.startsWith("\"") && boundary.endsWith("\"") && (boundary.length() > 1)) {
+            boundary = boundary.substring(1, boundary.length() - 1);
+        }
+        connection.delimiter = String{"\r\n--"} + boundary;
+        connection.body_type = BodyType::kMultipart;
+    }
+    else if (content_type.startsWith(kUrlEncodedForm)) {
+        connection.body_type = BodyType::kForm;
+    }
+    else if (connection.content_length > 0) {
+        connection.body_type = BodyType::kOther;
+    }
+
+    for (auto const& route : routes_) {
+        if ((route.uri == connection.uri) &&
+            ((route.method == connection.method) ||
+             ((route.method == Method::kGet) && (connection.method == Method::kHead)))) {
+            connection.route = &route;
+            break;
+        }
+    }
+
+    if ((connection.content_length > 0) &&
+        find_value(connection.headers, "Expect", false).equalsIgnoreCase("100-continue")) {
+        ::send(connection.socket, kContinue, sizeof(kContinue) - 1, MSG_NOSIGNAL);
+    }
+    return true;
+}
+
+void
+HttpServer::process_body(Connection& connection)
+{
+    switch (connection.body_type) {
+    case BodyType::kNone:
+        connection.in.clear();
+        break;
+    case BodyType::kForm:
+    case BodyType::kOther:
+        if (connection.in.size() > kMaxFormSize) {
+            if (connection.body_type == BodyType::kForm) {
+                reply_error(connection, 413);
+                return;
+            }
+            // Too big to be an argument. Just skip it
+            connection.in.clear();
+            connection.body_type = BodyType::kNone;
+        }
+        break;
+    case BodyType::kMultipart:
+        if (!process_multipart(connection)) {
+            reply_error(connection, 400);
+            return;
+        }
+        break;
+    }
+
+    if (connection.body_received < connection.content_length) {
+        return;
+    }
+
+    if (connection.body_type == BodyType::kForm) {
+        parse_args(reinterpret_cast<char const*>(connection.in.data()), connection.in.size(), connection.args);
+    }
+    else if (connection.body_type == BodyType::kOther) {
+        connection.in.push_back('\0');
+        connection.args.emplace_back("plain", String{reinterpret_cast<char const*>(connection.in.data())});
+    }
+    else if ((connection.body_type == BodyType::kMultipart) && connection.is_file_part) {
+        // Body is over, but file is not finished
+        call_upload_handler(connection, UploadStatus::kAborted, nullptr, 0);
+    }
+    connection.in.clear();
+    dispatch(connection);
+}
+
+// Data of parts is passed on as soon as it is received, except of the last bytes, which can be beginning of delimiter
+bool
+HttpServer::process_multipart(Connection& connection)
+{
+    auto& in        = connection.in;
+    auto& delimiter = connection.delimiter;
+    while (true) {
+        switch (connection.multipart_state) {
+        case MultipartState::kPreamble:
+        case MultipartState::kPartData: {
+            auto position = find(in, delimiter.c_str(), delimiter.length());
+            if (position == in.size()) {
+                if (in.size() >= delimiter.length()) {
+                    emit_part_data(connection, in.size() - delimiter.length() + 1);
+                }
+                return true;
+            }
+            emit_part_data(connection, position);
+            in.erase(in.begin(), in.begin() + delimiter.length());
+
+            if (connection.multipart_state == MultipartState::kPartData) {
+                if (connection.is_file_part) {
+                    call_upload_handler(connection, UploadStatus::kEnd, nullptr, 0);
+                }
+                else {
+                    connection.args.emplace_back(connection.upload.name, connection.field_value);
+                }
+            }
+            connection.multipart_state = MultipartState::kPartHead;
+            break;
+        }
+        case MultipartState::kPartHead: {
+            // Delimiter is followed either by "--" (the last one), either by CRLF and headers of next part
+            if (in.size() < 2) {
+                return true;
+            }
+            if ((in[0] == '-') && (in[1] == '-')) {
+                connection.multipart_state = MultipartState::kEpilogue;
+                break;
+            }
+            auto head_size = find(in, kHeadEnd, kHeadEndSize);
+            if (head_size == in.size()) {
+                return in.size() <= kMaxHeadSize;
+            }
+            if (head_size < 2) {
+                return false;
+            }
+            in[head_size] = '\0';
+            if (!parse_part_head(connection, reinterpret_cast<char*>(in.data()) + 2)) {
+                return false;
+            }
+            in.erase(in.begin(), in.begin() + head_size + kHeadEndSize);
+            connection.multipart_state = MultipartState::kPartData;
+            break;
+        }
+        case MultipartState::kEpilogue:
+            in.clear();
+            return true;
+        }
+    }
+}
+
+bool
+HttpServer::parse_part_head(Connection& connection, char* head)
+{
+    // Content-Disposition: form-data; name="field"; filename="file.txt"
+    connection.upload.name     = String{};
+    connection.upload.filename = String{};
+    connection.field_value     = String{};
+    bool is_file_part{false};
+
+    char* cursor{head};
+    char* line;
+    while ((line = next_line(cursor)) != nullptr) {
+        if (strncasecmp(line, "Content-Disposition:", 20) == 0) {
+            connection.upload.name     = get_quoted_parameter(line, " name=\"");
+            connection.upload.filename = get_quoted_parameter(line, "filename=\"");
+            is_file_part               = (strstr(line, "filename=\"") != nullptr);
+        }
+    }
+    if (connection.upload.name.isEmpty()) {
+        return false;
+    }
+
+    if (is_file_part) {
+        connection.is_file_part = true;
+        call_upload_handler(connection, UploadStatus::kStart, nullptr, 0);
+    }
+    return true;
+}
+
+void
+HttpServer::emit_part_data(Connection& connection, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+
+    if (connection.multipart_state == MultipartState::kPartData) {
+        if (connection.is_file_part) {
+            call_upload_handler(connection, UploadStatus::kWrite, connection.in.data(), size);
+        }
+        else if (connection.field_value.length() + size <= kMaxFormSize) {
+            connection.field_value.reserve(connection.field_value.length() + size);
+            for (size_t i = 0; i < size; ++i) {
+                connection.field_value += static_cast<char>(connection.in[i]);
+            }
+        }
+    }
+    connection.in.erase(connection.in.begin(), connection.in.begin() + size);
+}
+
+void
+HttpServer::call_upload_handler(Connection& connection, UploadStatus status, uint8_t const* buf, size_t size)
+{
+    auto& upload        = connection.upload;
+    upload.status       = status;
+    upload.buf          = buf;
+    upload.current_size = size;
+    upload.total_size   = (status == UploadStatus::kStart) ? 0 : upload.total_size + size;
+    if ((status == UploadStatus::kEnd) || (status == UploadStatus::kAborted)) {
+        connection.is_file_part = false;
+    }
+
+    if ((connection.route != nullptr) && (connection.route->upload_handler != nullptr)) {
+        current_ = &connection;
+        connection.route->upload_handler();
+        current_ = nullptr;
+    }
+}
+
+void
+HttpServer::dispatch(Connection& connection)
+{
+    // Response is sent while handler is still running
+    connection.state = State::kSending;
+
+    current_ = &connection;
+    if (connection.route != nullptr) {
+        connection.route->handler();
+    }
+    else if (not_found_handler_ != nullptr) {
+        not_found_handler_();
+    }
+    current_ = nullptr;
+
+    if (connection.socket < 0) {
+        // Connection is detached by handler
+        connection = Connection{};
+    }
+    else if (!connection.is_response_queued) {
+        close(connection);
+    }
+    else if (send_pending(connection)) {
+        finish_request(connection);
+    }
+}
+
+void
+HttpServer::finish_request(Connection& connection)
+{
+    if (!connection.is_keep_alive) {
+        close(connection);
+        return;
+    }
+
+    // Keep only connection itself and received data of the next request
+    Connection next;
+    next.socket             = connection.socket;
+    next.state              = State::kReadingHead;
+    next.last_activity_time = millis();
+    next.request_count      = connection.request_count;
+    next.in                 = std::move(connection.pipelined);
+    next.is_input_pending   = !next.in.empty();
+    connection              = std::move(next);
+}
+
+void
+HttpServer::queue_response(int code, char const* content_type, size_t content_length)
+{
+    String head{"HTTP/1.1 "};
+    head.reserve(128 + current_->response_headers.length());
+    head += String{code} + " " + get_reason_phrase(code) + "\r\n";
+    if (content_type != nullptr) {
+        head += String{"Content-Type: "} + content_type + "\r\n";
+    }
+    if (content_length == kUnknownContentLength) {
+        if (current_->is_http_1_1) {
+            head += "Transfer-Encoding: chunked\r\n";
+        }
+    }
+    else if (code != 304) {
+        // Response to conditional request has no body
+        head += String{"Content-Length: "} + String{content_length} + "\r\n";
+    }
+    head += current_->response_headers;
+    if (current_->is_keep_alive) {
+        head += String{"Connection: keep-alive\r\nKeep-Alive: timeout="} + String{kConnectionTimeoutMs / 1000} +
+                ", max=" + String{kMaxRequestsPerConnection - current_->request_count} + "\r\n\r\n";
+    }
+    else {
+        head += "Connection: close\r\n\r\n";
+    }
+
+    current_->response_headers   = String{};
+    current_->is_response_queued = true;
+    append(current_->out, head);
+}
+
+void
+HttpServer::queue_external_content(
+    int code, char const* content_type, uint8_t const* content, size_t size, SharedBuffer owner)
+{
+    if (current_->is_response_queued) {
+        DEBUG_PRINTLN(String{"ERROR: response to "} + current_->uri + " is already sent");
+        return;
+    }
+    size_t offset{0};
+    size_t length{size};
+    if (code == 200) {
+        code = select_range(size, offset, length);
+    }
+    queue_response(code, content_type, length);
+    if (current_->method != Method::kHead) {
+        current_->external_content       = content + offset;
+        current_->external_content_size  = length;
+        current_->external_content_owner = std::move(owner);
+    }
+    if (current_->state == State::kSending) {
+        send_pending(*current_);
+    }
+}
+
+// Choose part of content, requested by Range header, and add related headers. Return code of response
+int
+HttpServer::select_range(size_t size, size_t& offset, size_t& length)
+{
+    offset = 0;
+    length = size;
+    current_->response_headers += "Accept-Ranges: bytes\r\n";
+
+    String range{find_value(current_->headers, "Range", false)};
+    if (range.isEmpty() || (current_->method != Method::kGet)) {
+        return 200;
+    }
+    // Range is applied only if content was not changed since client received its first part. Content is identified by
+    // strong ETag only, because there is no modification date
+    String if_range{find_value(current_->headers, "If-Range", false)};
+    if (!if_range.isEmpty() && (if_range != current_->response_etag)) {
+        return 200;
+    }
+
+    size_t first;
+    size_t last;
+    switch (parse_range(range, size, first, last)) {
+    case RangeType::kSatisfiable:
+        offset = first;
+        length = last - first + 1;
+        send_header("Content-Range", String{"bytes "} + String{first} + "-" + String{last} + "/" + String{size});
+        return 206;
+    case RangeType::kUnsatisfiable:
+        length = 0;
+        send_header("Content-Range", String{"bytes */"} + String{size});
+        return 416;
+    default:
+        return 200;
+    }
+}
+
+void
+HttpServer::reply_error(Connection& connection, int code)
+{
+    DEBUG_PRINTLN(String{"ERROR: HTTP request can not be processed: "} + String{code});
+    if (connection.is_file_part) {
+        call_upload_handler(connection, UploadStatus::kAborted, nullptr, 0);
+    }
+
+    // Rest of request is not read, connection is closed after response
+    connection.is_keep_alive = false;
+    connection.state         = State::kSending;
+    current_                 = &connection;
+    send(code, kTextPlain, String{get_reason_phrase(code)});
+    current_ = nullptr;
+}
+
+// Return true if there is nothing more to send: either everything is sent, either connection is broken
+bool
+HttpServer::send_pending(Connection& connection)
+{
+    while (true) {
+        // Head (and small content) is sent first, then shared content or file
+        uint8_t const* data;
+        size_t         data_size;
+        size_t*        offset;
+        if (connection.out_offset < connection.out.size()) {
+            data      = connection.out.data();
+            data_size = connection.out.size();
+            offset    = &connection.out_offset;
+        }
+        else if (connection.external_content_offset < connection.external_content_size) {
+            data      = connection.external_content;
+            data_size = connection.external_content_size;
+            offset    = &connection.external_content_offset;
+        }
+        else {
+            connection.out.clear();
+            connection.out_offset = 0;
+            connection.external_content        = nullptr;
+            connection.external_content_size   = 0;
+            connection.external_content_offset = 0;
+            connection.external_content_owner.reset();
+            if (connection.producer) {
+                produce_next_chunk(connection);
+                continue;
+            }
+            if (!connection.file) {
+                return true;
+            }
+
+            // Next part of file
+            connection.out.resize(kSendChunkSize);
+            auto size =
+                connection.file.read(connection.out.data(), std::min(kSendChunkSize, connection.file_remaining));
+            connection.file_remaining -= size;
+            if (size == 0) {
+                if (connection.file_remaining > 0) {
+                    // File is shorter than promised. The only way to let client know about it is to close connection
+                    DEBUG_PRINTLN(String{"ERROR: can not read file "} + connection.uri);
+                    connection.is_keep_alive = false;
+                }
+                Utils::FS::close(connection.file);
+                connection.out.clear();
+                return true;
+            }
+            connection.out.resize(size);
+            continue;
+        }
+
+        auto size = ::send(connection.socket, data + *offset, data_size - *offset, MSG_NOSIGNAL);
+        if (size < 0) {
+            if (is_would_block_error()) {
+                return false;
+            }
+            if (connection.file) {
+                Utils::FS::close(connection.file);
+            }
+            connection.out.clear();
+            connection.out_offset = 0;
+            connection.external_content        = nullptr;
+            connection.external_content_size   = 0;
+            connection.external_content_offset = 0;
+            connection.external_content_owner.reset();
+            connection.producer = nullptr;
+            return true;
+        }
+        *offset += size;
+        connection.last_activity_time = millis();
+    }
+}
+
+void
+HttpServer::produce_next_chunk(Connection& connection)
+{
+    // Data is produced right after space for chunk's head. Head is written just before data, when size is known
+    connection.out.resize(kChunkHeadSize + kSendChunkSize + 2);
+    auto size = connection.producer(connection.out.data() + kChunkHeadSize, kSendChunkSize);
+    if (!connection.is_http_1_1) {
+        connection.out.erase(connection.out.begin(), connection.out.begin() + kChunkHeadSize);
+        connection.out.resize(size);
+    }
+    else {
+        char head[kChunkHeadSize + 1];
+        auto head_size = snprintf(head, sizeof(head), "%x\r\n", (unsigned)size);
+        connection.out_offset = kChunkHeadSize - head_size;
+        memcpy(connection.out.data() + connection.out_offset, head, head_size);
+        connection.out.resize(kChunkHeadSize + size);
+        connection.out.push_back('\r');
+        connection.out.push_back('\n');
+    }
+    if (size == 0) {
+        connection.producer = nullptr;  // The last (empty) chunk
+    }
+}
+
+void
+HttpServer::close(Connection& connection)
+{
+    if (connection.is_file_part) {
+        call_upload_handler(connection, UploadStatus::kAborted, nullptr, 0);
+    }
+    if (connection.file) {
+        Utils::FS::close(connection.file);
+    }
+    if (connection.socket >= 0) {
+        ::close(connection.socket);
+    }
+    connection = Connection{};
+}
+
+}  // namespace Servers
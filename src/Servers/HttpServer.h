@@ -0,0 +1,208 @@
+#ifndef SRC_SERVERS_HTTPSERVER_H_
+#define SRC_SERVERS_HTTPSERVER_H_
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <WString.h>
+
+#include "src/Utils/FS.h"
+
+namespace Servers
+{
+// Non-blocking HTTP/1.1 server. It serves several connections at a time: every connection has its own state machine,
+// which is advanced by loop() as far as it is possible without waiting for network. So, slow or idle client does not
+// delay other clients and loop() never blocks. Server is built on top of BSD sockets API of lwIP.
+//
+// Connections are persistent (HTTP/1.1 keep-alive), if client does not ask to close them. Idle persistent connection is
+// closed by timeout or when its slot is needed for new client. Pipelined requests are processed one by one, so
+// responses are sent in the same order.
+//
+// Handler is called from loop(), when request (including body) is received completely. Functions, which give access
+// to request and send response, are valid only inside of handler. Response is not sent immediately, but is queued in
+// connection and is sent by loop(). Uploaded files (multipart/form-data) are passed to upload handler by chunks, while
+// they are being received.
+class HttpServer
+{
+public:
+    enum class Method : uint8_t
+    {
+        kGet = 0,
+        kHead,
+        kPost,
+        kPut,
+        kDelete,
+        kOptions,
+        kUnknown
+    };
+    enum class UploadStatus : uint8_t
+    {
+        kStart = 0,
+        kWrite,
+        kEnd,
+        kAborted
+    };
+    struct Upload
+    {
+        UploadStatus   status{UploadStatus::kStart};
+        String         name;  // Name of form field
+        String         filename;
+        uint8_t const* buf{nullptr};
+        size_t         current_size{0};
+        size_t         total_size{0};
+    };
+    using Handler      = std::function<void()>;
+    using SharedBuffer = std::shared_ptr<uint8_t const>;
+    // Write the next part of content to buffer. Return number of written bytes, 0 at the end of content
+    using ContentProducer = std::function<size_t(uint8_t* buffer, size_t size)>;
+
+    explicit HttpServer(uint16_t port, uint8_t max_num_of_connections = 5);
+    ~HttpServer();
+    bool begin();
+    void loop();
+
+    void on(String const& uri, Method method, Handler handler, Handler upload_handler = nullptr);
+    void on_not_found(Handler handler);
+
+    // Request
+    Method        method() const;
+    String const& uri() const;
+    size_t        args() const;
+    String        arg(size_t index) const;
+    String        arg(String const& name) const;
+    bool          has_arg(String const& name) const;
+    String        header(String const& name) const;
+    Upload const& upload() const;
+    // Number of requests, received via current connection, including current one
+    size_t request_count() const;
+
+    // Response. Headers should be added before send()
+    void send_header(String const& name, String const& value);
+    void send(int code, char const* content_type, String const& content);
+    void send(int code, char const* content_type, uint8_t const* content, size_t size);
+    // Content is not copied, it is sent right from the buffer. Buffer is kept alive till it is sent
+    void send_shared(int code, char const* content_type, SharedBuffer content, size_t size);
+    // Content is not copied. It should never be freed (ex. constant or memory-mapped flash)
+    void send_static(int code, char const* content_type, uint8_t const* content, size_t size);
+    // Content of the following functions is sent partially (206), if client requests single range by Range header.
+    // File is sent by parts from loop() and is closed after that. If requested part of file can not be reached, error
+    // 500 is sent instead. If less than promised can be read, connection is closed after it
+    void stream_file(Utils::FS::File& file, String const& content_type);
+    // Content of unknown size is produced by parts, while it is being sent (chunked transfer encoding). So, it is not
+    // needed to keep it in RAM entirely
+    void send_chunked(int code, char const* content_type, ContentProducer producer);
+    // Stop serving current connection and return its (blocking) socket. Caller is responsible for closing it
+    int detach_client();
+
+private:
+    using Pairs = std::vector<std::pair<String, String>>;
+
+    enum class State : uint8_t
+    {
+        kFree = 0,
+        kReadingHead,
+        kReadingBody,
+        kSending
+    };
+    enum class BodyType : uint8_t
+    {
+        kNone = 0,
+        kForm,       // application/x-www-form-urlencoded
+        kMultipart,  // multipart/form-data
+        kOther       // Available as "plain" argument, if it is small enough
+    };
+    enum class MultipartState : uint8_t
+    {
+        kPreamble = 0,
+        kPartHead,
+        kPartData,
+        kEpilogue
+    };
+
+    struct Route
+    {
+        String  uri;
+        Method  method;
+        Handler handler;
+        Handler upload_handler;
+    };
+
+    struct Connection
+    {
+        int           socket{-1};
+        State         state{State::kFree};
+        unsigned long last_activity_time{0};
+        uint16_t      request_count{0};
+        bool          is_http_1_1{false};
+        bool          is_keep_alive{false};
+        bool          is_input_pending{false};  // "in" contains unprocessed pipelined request
+
+        // Request
+        Method               method{Method::kUnknown};
+        String               uri;
+        Pairs                args;
+        Pairs                headers;
+        Route const*         route{nullptr};
+        BodyType             body_type{BodyType::kNone};
+        size_t               content_length{0};
+        size_t               body_received{0};
+        std::vector<uint8_t> in;         // Received, but not processed yet data
+        std::vector<uint8_t> pipelined;  // Received data of next requests
+
+        // multipart/form-data
+        String         delimiter;
+        MultipartState multipart_state{MultipartState::kPreamble};
+        bool           is_file_part{false};
+        String         field_value;
+        Upload         upload;
+
+        // Response
+        String               response_headers;
+        String               response_etag;
+        bool                 is_response_queued{false};
+        std::vector<uint8_t> out;
+        size_t               out_offset{0};
+        uint8_t const*       external_content{nullptr};  // Content, which is sent without copying to "out"
+        size_t               external_content_size{0};
+        size_t               external_content_offset{0};
+        SharedBuffer         external_content_owner;
+        Utils::FS::File      file;
+        size_t               file_remaining{0};  // Bytes of file, which should be sent
+        ContentProducer      producer;
+    };
+
+    void accept_connections();
+    bool has_pending_connection() const;
+    static bool is_idle(Connection const& connection);
+    void receive(Connection& connection);
+    void process_input(Connection& connection);
+    bool parse_head(Connection& connection, char* head);
+    void process_body(Connection& connection);
+    bool process_multipart(Connection& connection);
+    bool parse_part_head(Connection& connection, char* head);
+    void emit_part_data(Connection& connection, size_t size);
+    void call_upload_handler(Connection& connection, UploadStatus status, uint8_t const* buf, size_t size);
+    void dispatch(Connection& connection);
+    void finish_request(Connection& connection);
+    void queue_response(int code, char const* content_type, size_t content_length);
+    int  select_range(size_t size, size_t& offset, size_t& length);
+    void queue_external_content(
+        int code, char const* content_type, uint8_t const* content, size_t size, SharedBuffer owner);
+    void reply_error(Connection& connection, int code);
+    bool send_pending(Connection& connection);
+    void produce_next_chunk(Connection& connection);
+    void close(Connection& connection);
+
+    const uint16_t          port_;
+    int                     listen_socket_{-1};
+    std::vector<Connection> connections_;
+    std::vector<Route>      routes_;
+    Handler                 not_found_handler_{nullptr};
+    Connection*             current_{nullptr};  // Connection, whose request is being handled
+};
+
+}  // namespace Servers
+
+#endif  // SRC_SERVERS_HTTPSERVER_H_
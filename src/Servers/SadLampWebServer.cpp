@@ -1,24 +1,19 @@
 #include "SadLampWebServer.h"
 
+#include <stdlib.h>
+
 #include <map>
+#include <memory>
 
-#include <Update.h>
+#include <rom/crc.h>
 
+#include "src/Control/Persistency.h"
 #include "src/Utils/Logger.h"
+#include "src/Utils/Scheduler.h"
+#include "src/Utils/TimerWheel.h"
 
-// NOTE!
-// There is a bug in WebServer. In short: it supports only 1 connection at a time. So, if browser opens another
-// connection in parallel, it leads to waiting for HTTP_MAX_DATA_WAIT (5 s) unitl incomming request will be processed
-// In more details it is described here:
-// https://www.reddit.com/r/esp8266/comments/ohrqyp/slow_http_web_server_response_time/
-// Solution is to apply patch from here: https://github.com/esp8266/Arduino/pull/8216
-// It seems to be applied in neew versions of Arduino Core for ESP8266, but not sure if they will apply it for ESP32.
-// I applied simplified version (the forst on page, not entire pull-request) - it seems work. BUT if you read details,
-// you will see that it will cause problems in case several clients will want to work with ESP in parallel. But this is
-// not my case, so I'm OK with this solution, at least till proper solution will appear in Arduino Core for ESP32
-//
-// Pay attention that in case of upgrade to newer version of Arduino Core for ESP32 you may need to apply this patch
-// again (if they will not provide proper fix)
+// Requests are served by HttpServer, which handles several connections at a time without blocking. So, parallel
+// requests of browser (ex. page and its resources) do not wait for each other.
 
 namespace
 {
@@ -26,6 +21,92 @@ static const char TEXT_PLAIN[]     = "text/plain";
 static const char TEXT_JSON[]      = "text/json";
 static const char FS_INIT_ERROR[]  = "FS INIT ERROR";
 static const char FILE_NOT_FOUND[] = "FileNotFound";
+static const char OCTET_STREAM[]   = "application/octet-stream";
+
+constexpr size_t        kMaxConfigSnapshotSize{1024};
+constexpr uint32_t      kSecondsPerDay{24 * 60 * 60};
+constexpr unsigned long kTreeOperationBudgetMs{20};  // Time of delete/move of folder per loop()
+constexpr unsigned long kOtaReportPeriodMs{500};
+constexpr uint32_t      kResetWifiSettingsDelayMs{500};
+
+// '*' matches any sequence of characters
+bool
+matches_pattern(char const* str, char const* pattern)
+{
+    char const* star{nullptr};  // Position of the last '*' in pattern
+    char const* star_str{nullptr};
+    while (*str != '\0') {
+        if (*pattern == '*') {
+            star     = pattern++;
+            star_str = str;
+        }
+        else if (*pattern == *str) {
+            ++pattern;
+            ++str;
+        }
+        else if (star != nullptr) {
+            // Let the last '*' match one more character
+            pattern = star + 1;
+            str     = ++star_str;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') {
+        ++pattern;
+    }
+    return *pattern == '\0';
+}
+
+// Precompressed variants of file in order of preference
+struct EncodedVariant
+{
+    char const* extension;
+    char const* encoding;
+};
+constexpr EncodedVariant kEncodedVariants[] = {{".br", "br"}, {".gz", "gzip"}};
+
+// Accept-Encoding is list of codings with optional weights, ex. "gzip, deflate, br;q=0.5, *;q=0". Coding with weight 0
+// is not acceptable. "*" matches any coding, which is not listed explicitly
+bool
+is_encoding_accepted(String const& accept_encoding, char const* encoding)
+{
+    bool is_any_accepted{false};
+    int  start{0};
+    while (start < (int)accept_encoding.length()) {
+        int end{accept_encoding.indexOf(',', start)};
+        if (end == -1) {
+            end = accept_encoding.length();
+        }
+        String item{accept_encoding.substring(start, end)};
+        start = end + 1;
+
+        int    params_start{item.indexOf(';')};
+        String name{(params_start == -1) ? item : item.substring(0, params_start)};
+        name.trim();
+        bool is_accepted{true};
+        if (params_start != -1) {
+            int weight_start{item.indexOf("q=", params_start)};
+            is_accepted = (weight_start == -1) || (strtod(item.c_str() + weight_start + 2, nullptr) > 0);
+        }
+
+        if (name.equalsIgnoreCase(encoding)) {
+            return is_accepted;
+        }
+        if (name == "*") {
+            is_any_accepted = is_accepted;
+        }
+    }
+    return is_any_accepted;
+}
+
+// If-None-Match contains "*" or list of ETags. Weak comparison is used, as required for GET
+bool
+is_etag_matched(String const& if_none_match, String const& etag)
+{
+    return (if_none_match == "*") || (if_none_match.indexOf(etag) != -1);
+}
 
 String
 getContentType(String const& filename)
@@ -78,42 +159,80 @@ SadLampWebServer::SadLampWebServer()
   , handlers_{
         nullptr,
     }
+  , cache_rules_{
+        // UI pages, styles and scripts are revalidated (by ETag) every time, so changes, uploaded via editor, are
+        // visible immediately. Images are rarely changed
+        {"*.css", 0},
+        {"*.js", 0},
+        {"*.ico", kSecondsPerDay},
+        {"*.gif", kSecondsPerDay},
+        {"*.jpg", kSecondsPerDay},
+        {"*.png", kSecondsPerDay},
+    }
 {
 }
 
 void
 SadLampWebServer::init()
 {
+    etag_index_.load();
+    asset_pack_.begin();
+
     // SSDP description
-    web_server_.on("/ssdp_description.xml", HTTP_GET, [this]() {
+    web_server_.on("/ssdp_description.xml", HttpServer::Method::kGet, [this]() {
         if (get_ssdp_description_handler_ != nullptr) {
-            get_ssdp_description_handler_(std::move(web_server_.client()));
+            // SSDP library writes entire response by itself
+            get_ssdp_description_handler_(WiFiClient{web_server_.detach_client()});
         }
     });
 
     // HTTP pages to work with file system
     // List directory
-    web_server_.on("/list", HTTP_GET, [this]() { handle_file_list(); });
+    web_server_.on("/list", HttpServer::Method::kGet, [this]() { handle_file_list(); });
     // Load editor
-    web_server_.on("/edit", HTTP_GET, [this]() {
+    web_server_.on("/edit", HttpServer::Method::kGet, [this]() {
         if (!handle_file_read("/edit.htm")) {
             reply_not_found(FILE_NOT_FOUND);
         }
     });
     // Create file
-    web_server_.on("/edit", HTTP_PUT, [this]() { handle_file_create(); });
+    web_server_.on("/edit", HttpServer::Method::kPut, [this]() { handle_file_create(); });
     // Delete file
-    web_server_.on("/edit", HTTP_DELETE, [this]() { handle_file_delete(); });
+    web_server_.on("/edit", HttpServer::Method::kDelete, [this]() { handle_file_delete(); });
+    // Statistics of cache of static files
+    web_server_.on("/cache_stats", HttpServer::Method::kGet, [this]() {
+        reply_ok_json_with_msg(file_cache_.get_stats_json());
+    });
+    // How late and how long periodic work of modules was
+    web_server_.on("/timer_stats", HttpServer::Method::kGet, [this]() {
+        reply_ok_json_with_msg(Utils::TimerWheel::instance().get_stats_json());
+    });
+    // Progress of the last delete or move of folder
+    web_server_.on("/edit_progress", HttpServer::Method::kGet, [this]() {
+        reply_ok_json_with_msg(tree_operation_ ? tree_operation_->get_progress_json() : String{"{}"});
+    });
+    // Speed of filesystem. Benchmark is started by POST and is run by steps in loop(). GET returns its progress or
+    // result
+    web_server_.on("/fs_benchmark", HttpServer::Method::kPost, [this]() {
+        if (fs_benchmark_ && (fs_benchmark_->get_state() == Utils::FsBenchmark::State::kInProgress)) {
+            return reply_server_error("BENCHMARK IS IN PROGRESS");
+        }
+        fs_benchmark_.reset(new Utils::FsBenchmark{});
+        reply_ok_json_with_msg(fs_benchmark_->get_result_json());
+    });
+    web_server_.on("/fs_benchmark", HttpServer::Method::kGet, [this]() {
+        reply_ok_json_with_msg(fs_benchmark_ ? fs_benchmark_->get_result_json() : String{"{}"});
+    });
 
     // Upload file
     // - first callback is called after the request has ended with all parsed arguments
     // - second callback handles file upload at that location
     web_server_.on(
-        "/edit", HTTP_POST, [this]() { reply_ok(); }, [this]() { handle_file_upload(); });
+        "/edit", HttpServer::Method::kPost, [this]() { reply_ok(); }, [this]() { handle_file_upload(); });
 
     // Called when the url is not defined here
     // Use it to load content from FS
-    web_server_.onNotFound([this]() {
+    web_server_.on_not_found([this]() {
         if (!handle_file_read(web_server_.uri())) {
             reply_not_found(FILE_NOT_FOUND);
         }
@@ -123,7 +242,7 @@ SadLampWebServer::init()
     // Update ESP firmware
     web_server_.on(
         "/update",
-        HTTP_POST,
+        HttpServer::Method::kPost,
         [this]() {
             // This code is from example. Not sure if we really need it
             //
@@ -139,31 +258,48 @@ SadLampWebServer::init()
                 esp_firmware_upload_error_ = "";
             }
             else {
-                web_server_.client().setNoDelay(true);
                 reply_ok_with_msg("ESP firmware update completed! Rebooting...");
-                delay(100);
-                web_server_.client().stop();
-
                 DEBUG_PRINTLN("Rebooting...");
-                handle_reboot_esp();  // Schedule reboot
+                handle_reboot_esp();  // Schedule reboot. It happens after response is sent
             }
         },
         [this]() { handle_esp_sw_upload(); });
+    // Update ESP firmware from file on FS or from HTTP mirror in background. Progress is reported by OTA_PROGRESS
+    web_server_.on("/update_from", HttpServer::Method::kPost, [this]() { handle_esp_sw_update_from(); });
 
-    web_server_.on("/reset_wifi_settings", HTTP_POST, [this]() { handle_reset_wifi_settings(); });
-    web_server_.on("/reboot_esp", HTTP_POST, [this]() {
+    // Export/import of configuration (all variables from Persistency) as single binary snapshot
+    web_server_.on("/config", HttpServer::Method::kGet, [this]() { handle_config_export(); });
+    web_server_.on(
+        "/config",
+        HttpServer::Method::kPost,
+        [this]() { handle_config_import(); },
+        [this]() { handle_config_upload(); });
+
+    web_server_.on("/reset_wifi_settings", HttpServer::Method::kPost, [this]() { handle_reset_wifi_settings(); });
+    web_server_.on("/reboot_esp", HttpServer::Method::kPost, [this]() {
         reply_ok();
         handle_reboot_esp();
     });
 
-    web_server_.begin();
+    if (!web_server_.begin()) {
+        DEBUG_PRINTLN("ERROR: can not start web server");
+        return;
+    }
     DEBUG_PRINTLN("Web server initialized");
 }
 
 void
 SadLampWebServer::loop()
 {
-    web_server_.handleClient();
+    web_server_.loop();
+    if (tree_operation_ && (tree_operation_->get_state() == Utils::FS::TreeOperation::State::kInProgress)) {
+        tree_operation_->run_for(kTreeOperationBudgetMs);
+    }
+    if (fs_benchmark_ && (fs_benchmark_->get_state() == Utils::FsBenchmark::State::kInProgress)) {
+        fs_benchmark_->step();
+    }
+    etag_index_.loop();
+    report_ota_progress();
 }
 
 void
@@ -178,6 +314,12 @@ SadLampWebServer::set_get_ssdp_description_handler(GetSsdpDescriptionHandler han
     get_ssdp_description_handler_ = handler;
 }
 
+void
+SadLampWebServer::set_cache_max_age(String const& pattern, uint32_t max_age_s)
+{
+    cache_rules_.push_back(CacheRule{pattern, max_age_s});
+}
+
 void
 SadLampWebServer::reply_ok()
 {
@@ -220,8 +362,8 @@ SadLampWebServer::reply_server_error(String const& msg)
 void
 SadLampWebServer::handle_file_list()
 {
-    if (!web_server_.hasArg("dir")) {
-        reply_bad_request("DIR ARG MISSING");
+    if (!web_server_.has_arg("dir")) {
+        return reply_bad_request("DIR ARG MISSING");
     }
     String path{web_server_.arg("dir")};
     if (!Utils::FS::is_directory(path)) {
@@ -229,8 +371,11 @@ SadLampWebServer::handle_file_list()
     }
 
     DEBUG_PRINTLN(String{"handle_file_list: "} + path);
-    auto output = Utils::FS::get_file_list_json(path);
-    web_server_.sendContent(Utils::FS::get_file_list_json(path));
+    // Listing may be long, so it is sent by chunks, while it is being produced
+    auto list = std::make_shared<Utils::FS::FileList>(path);
+    web_server_.send_chunked(200, TEXT_JSON, [list](uint8_t* buffer, size_t size) {
+        return list->read(reinterpret_cast<char*>(buffer), size);
+    });
 }
 
 // Handle the creation/rename of a new file
@@ -245,8 +390,8 @@ SadLampWebServer::handle_file_list()
 void
 SadLampWebServer::handle_file_create()
 {
-    if (!web_server_.hasArg("path")) {
-        reply_bad_request("PATH ARG MISSING");
+    if (!web_server_.has_arg("path")) {
+        return reply_bad_request("PATH ARG MISSING");
     }
 
     String path{web_server_.arg("path")};
@@ -261,6 +406,8 @@ SadLampWebServer::handle_file_create()
     if (src.isEmpty()) {
         // No source specified: creation
         DEBUG_PRINTLN(String{"handle_file_create: "} + path);
+        etag_index_.remove(path);  // In case if file was deleted bypassing web server
+        file_cache_.invalidate(path);
         if (path.endsWith("/")) {
             // Create a folder
             auto result{Utils::FS::create_folder(std::move(path))};
@@ -289,11 +436,13 @@ SadLampWebServer::handle_file_create()
         }
 
         DEBUG_PRINTLN(String{"handle_file_create: renaming "} + src + " to " + path);
-        auto result{Utils::FS::rename(std::move(src), std::move(path))};
-        if (!result.first) {
-            return reply_server_error(result.second);
+        if (!start_tree_operation(Utils::FS::TreeOperation::Type::kMove, src, path)) {
+            return;
         }
-        reply_ok_with_msg(result.second);
+        etag_index_.rename(src, path);
+        file_cache_.invalidate(src);
+        file_cache_.invalidate(path);
+        reply_ok_with_msg(Utils::FS::last_existing_parent(src.substring(0, src.lastIndexOf('/'))));
     }
 }
 
@@ -321,11 +470,29 @@ SadLampWebServer::handle_file_delete()
     }
 
     DEBUG_PRINTLN(String{"handle_file_delete: "} + path);
-    auto result{Utils::FS::remove(path)};
-    if (!result.first) {
-        return reply_server_error(result.second);
+    if (!start_tree_operation(Utils::FS::TreeOperation::Type::kDelete, path, String{})) {
+        return;
+    }
+    etag_index_.remove(path);
+    file_cache_.invalidate(path);
+    reply_ok_with_msg(Utils::FS::last_existing_parent(path.substring(0, path.lastIndexOf('/'))));
+}
+
+// Big folder is deleted or moved by parts in loop(). Client gets reply at once and can watch progress by
+// GET /edit_progress. Return false, if reply is already sent
+bool
+SadLampWebServer::start_tree_operation(Utils::FS::TreeOperation::Type type, String const& from, String const& to)
+{
+    if (tree_operation_ && (tree_operation_->get_state() == Utils::FS::TreeOperation::State::kInProgress)) {
+        reply_server_error("ANOTHER OPERATION IS IN PROGRESS");
+        return false;
+    }
+    tree_operation_.reset(new Utils::FS::TreeOperation{type, from, to});
+    if (tree_operation_->run_for(kTreeOperationBudgetMs) == Utils::FS::TreeOperation::State::kFailed) {
+        reply_server_error(tree_operation_->get_error());
+        return false;
     }
-    reply_ok_with_msg(result.second);
+    return true;
 }
 
 void
@@ -335,50 +502,100 @@ SadLampWebServer::handle_file_upload()
         return;
     }
 
-    HTTPUpload& upload{web_server_.upload()};
-    if (upload.status == UPLOAD_FILE_START) {
+    auto const& upload = web_server_.upload();
+    if (upload.status == HttpServer::UploadStatus::kStart) {
         DEBUG_PRINTLN(String{"handle_file_upload: filename: "} + upload.filename);
-        auto result{Utils::FS::create_file(std::move(upload.filename))};
-        if (!result.first) {
-            return reply_server_error(result.second);
+        upload_path_ = upload.filename.startsWith("/") ? upload.filename : String{"/"} + upload.filename;
+        upload_crc_  = 0;
+        // Data goes to temporary file, target file is replaced at the end (see BufferedFileWriter.h)
+        String error{upload_writer_.begin(upload_path_)};
+        if (!error.isEmpty()) {
+            return reply_server_error(error);
         }
-        upload_file_ = result.first;
         DEBUG_PRINTLN("handle_file_upload: STARTED");
     }
-    else if (upload.status == UPLOAD_FILE_WRITE) {
-        if (upload_file_) {
-            size_t bytesWritten{Utils::FS::write(upload_file_, upload.buf, upload.currentSize)};
-            if (bytesWritten != upload.currentSize) {
+    else if (upload.status == HttpServer::UploadStatus::kWrite) {
+        if (upload_writer_.is_active()) {
+            if (!upload_writer_.write(upload.buf, upload.current_size)) {
+                // Content of file is not known anymore. Do not write the rest of it
+                upload_writer_.abort();
                 return reply_server_error("WRITE FAILED");
             }
+            // ETag is calculated while file is being uploaded, so it is not needed to read file again
+            upload_crc_ = crc32_le(upload_crc_, upload.buf, upload.current_size);
         }
-        DEBUG_PRINTLN(String{"Upload: WRITE, Bytes: "} + String(upload.currentSize));
+        DEBUG_PRINTLN(String{"Upload: WRITE, Bytes: "} + String(upload.current_size));
     }
-    else if (upload.status == UPLOAD_FILE_END) {
-        if (upload_file_) {
-            Utils::FS::close(upload_file_);
+    else if (upload.status == HttpServer::UploadStatus::kEnd) {
+        if (upload_writer_.is_active()) {
+            String error{upload_writer_.end()};
+            if (!error.isEmpty()) {
+                return reply_server_error(error);
+            }
+            etag_index_.set(upload_path_, upload_crc_, upload.total_size);
+            file_cache_.invalidate(upload_path_);
         }
-        DEBUG_PRINTLN(String{"Upload: END, Size: "} + String(upload.totalSize));
+        DEBUG_PRINTLN(String{"Upload: END, Size: "} + String(upload.total_size));
+    }
+    else if (upload.status == HttpServer::UploadStatus::kAborted) {
+        // Target file is not changed
+        upload_writer_.abort();
+        DEBUG_PRINTLN("Upload: ABORTED");
     }
 }
 
 bool
 SadLampWebServer::handle_file_read(String path)
 {
-    DEBUG_PRINTLN(String{"handle_file_read: "} + path);
+    DEBUG_PRINTLN(String{"handle_file_read: "} + path + " (request #" + String{web_server_.request_count()} +
+                  " of connection)");
 
     if (path.endsWith("/")) {
         path += "index.htm";
     }
 
-    String contentType{web_server_.hasArg("download") ? "application/octet-stream" : getContentType(path)};
-    if (!Utils::FS::is_file(path)) {
-        // File not found, try gzip version
-        path += ".gz";
+    String      contentType{web_server_.has_arg("download") ? OCTET_STREAM : getContentType(path)};
+    String      cache_control{get_cache_control(path)};
+    char const* encoding{nullptr};
+
+    // File, uploaded to FS, overrides file of asset pack with the same path together with all its compressed variants
+    // in pack. Otherwise edited page would never be served. Existence of file on FS is checked in RAM (PathIndex)
+    String fs_variant{find_variant(path, encoding, Utils::FS::is_file)};
+    if (fs_variant.isEmpty()) {
+        // Files from asset pack are sent right from flash
+        String variant{find_variant(path, encoding, [this](String const& p) { return asset_pack_.exists(p); })};
+
+        AssetPack::Asset asset;
+        if (variant.isEmpty() || !asset_pack_.find(variant, asset)) {
+            return false;
+        }
+        if (reply_if_not_modified(cache_control, ETagIndex::make_etag(asset.crc, asset.size))) {
+            return true;
+        }
+        if (encoding != nullptr) {
+            web_server_.send_header("Content-Encoding", encoding);
+        }
+        web_server_.send_static(200, contentType.c_str(), asset.data, asset.size);
+        return true;
     }
+    path = fs_variant;
 
-    if (!Utils::FS::is_file(path)) {
-        return false;
+    // If client has actual version of file, it is not even opened
+    String etag{etag_index_.get(path)};
+    if (reply_if_not_modified(cache_control, etag)) {
+        return true;
+    }
+
+    if (encoding != nullptr) {
+        web_server_.send_header("Content-Encoding", encoding);
+    }
+
+    // Hot files are sent from RAM
+    size_t size{0};
+    auto   cached = file_cache_.get(path, etag, size);
+    if (cached) {
+        web_server_.send_shared(200, contentType.c_str(), std::move(cached), size);
+        return true;
     }
 
     Utils::FS::File file{Utils::FS::open(path, Utils::FS::OpenMode::kRead)};
@@ -387,15 +604,84 @@ SadLampWebServer::handle_file_read(String path)
         return false;
     }
 
-    if (web_server_.streamFile(file, contentType) != file.size()) {
-        DEBUG_PRINTLN("Sent less data than expected!");
-        Utils::FS::close(file);
+    if (!etag.isEmpty()) {
+        size   = file.size();
+        cached = file_cache_.put(path, etag, file);
+        if (cached) {
+            Utils::FS::close(file);
+            web_server_.send_shared(200, contentType.c_str(), std::move(cached), size);
+            return true;
+        }
+    }
+
+    // File is sent asynchronously and is closed by web server
+    web_server_.stream_file(file, contentType);
+    return true;
+}
+
+// Add caching headers to response. Return true (and reply 304) if client has actual version of file
+bool
+SadLampWebServer::reply_if_not_modified(String const& cache_control, String const& etag)
+{
+    web_server_.send_header("Cache-Control", cache_control);
+    // Response depends on Accept-Encoding, so caches should keep different variants separately
+    web_server_.send_header("Vary", "Accept-Encoding");
+    if (etag.isEmpty()) {
         return false;
     }
-    Utils::FS::close(file);
+    web_server_.send_header("ETag", etag);
+    if (!is_etag_matched(web_server_.header("If-None-Match"), etag)) {
+        return false;
+    }
+    web_server_.send(304, nullptr, String{});
     return true;
 }
 
+// Return path of variant of file, which is the best for client, or empty string if file does not exist. "encoding" is
+// Content-Encoding of variant or nullptr for original file
+String
+SadLampWebServer::find_variant(String const& path, char const*& encoding, FileExists const& exists) const
+{
+    encoding = nullptr;
+    if (web_server_.has_arg("download")) {
+        // File is downloaded as it is stored
+        if (exists(path)) {
+            return path;
+        }
+        return exists(path + ".gz") ? path + ".gz" : String{};
+    }
+
+    String accept_encoding{web_server_.header("Accept-Encoding")};
+    for (auto const& variant : kEncodedVariants) {
+        String variant_path{path + variant.extension};
+        if (is_encoding_accepted(accept_encoding, variant.encoding) && exists(variant_path)) {
+            encoding = variant.encoding;
+            return variant_path;
+        }
+    }
+    if (exists(path)) {
+        return path;
+    }
+
+    // There is only variant, which is not accepted by client. Gzip is supported by all browsers, so send it anyway
+    if (exists(path + ".gz")) {
+        encoding = "gzip";
+        return path + ".gz";
+    }
+    return String{};
+}
+
+String
+SadLampWebServer::get_cache_control(String const& path) const
+{
+    for (auto it = cache_rules_.rbegin(); it != cache_rules_.rend(); ++it) {
+        if (matches_pattern(path.c_str(), it->pattern.c_str())) {
+            return (it->max_age_s > 0) ? String{"max-age="} + String{it->max_age_s} : String{"no-cache"};
+        }
+    }
+    return "no-cache";
+}
+
 void
 SadLampWebServer::handle_esp_sw_upload()
 {
@@ -404,26 +690,23 @@ SadLampWebServer::handle_esp_sw_upload()
     // completely and only then send error. But error should be sent only once, otherwise when client will finish
     // uploading it will receive all error messages, sent during upload, at one time
 
-    if (web_server_.args() < 1) {
-        esp_firmware_upload_error_ = "ERROR: file size is not provided!";
-        return;
-    }
-
-    HTTPUpload& upload{web_server_.upload()};
-    if (upload.status == UPLOAD_FILE_START) {
-        auto file_size = web_server_.arg("file_size").toInt();
-        if (!Update.begin(file_size)) {
-            Update.end();
-            Update.printError(DGB_STREAM);
-            esp_firmware_upload_error_ = "ERROR: not enough space! Available: " + String(ESP.getFreeSketchSpace());
+    // Image can be raw or compressed by gzip. Size of file is known only for raw image, optional SHA-256 is for raw
+    // image in both cases (see FirmwareUpdater.h)
+    auto const& upload = web_server_.upload();
+    if (upload.status == HttpServer::UploadStatus::kStart) {
+        if (ota_task_.get_state() == Utils::OtaTask::State::kInProgress) {
+            esp_firmware_upload_error_ = "ERROR: another update is in progress";
             return;
         }
-
         DGB_STREAM.setDebugOutput(true);
         DEBUG_PRINTLN(String{"Start uploading file: "} + upload.filename);
-        esp_firmware_upload_error_ = "";
+        esp_firmware_upload_error_ =
+            firmware_updater_.begin(web_server_.arg("file_size").toInt(), web_server_.arg("sha256"));
+        if (esp_firmware_upload_error_.length() != 0) {
+            DGB_STREAM.setDebugOutput(false);
+        }
     }
-    else if (upload.status == UPLOAD_FILE_WRITE) {
+    else if (upload.status == HttpServer::UploadStatus::kWrite) {
         if (esp_firmware_upload_error_.length() != 0) {
             // Ignore uploading of file which is already marked as invalid. Do NOT send any errors to client here,
             // because there is no way to stop uploading but all sent messages will come together to client when it
@@ -431,15 +714,13 @@ SadLampWebServer::handle_esp_sw_upload()
             return;
         }
 
-        if (Update.write(upload.buf, upload.currentSize) != upload.currentSize) {
-            Update.end();
-            Update.printError(DGB_STREAM);
-            esp_firmware_upload_error_ = String{"ERROR: can not write file! Update error "} + String(Update.getError());
+        esp_firmware_upload_error_ = firmware_updater_.write(upload.buf, upload.current_size);
+        if (esp_firmware_upload_error_.length() != 0) {
             DGB_STREAM.setDebugOutput(false);
             return;
         }
     }
-    else if (upload.status == UPLOAD_FILE_END) {
+    else if (upload.status == HttpServer::UploadStatus::kEnd) {
         if (esp_firmware_upload_error_.length() != 0) {
             // Ignore finalizing of upload of file which is already marked as invalid. Do NOT send any errors to client
             // here, because there is no way to stop uploading but all sent messages will come together to client when
@@ -447,20 +728,14 @@ SadLampWebServer::handle_esp_sw_upload()
             return;
         }
 
-        if (Update.end(true)) {  // true to set the size to the current progress
-            DEBUG_PRINTLN(String{"Update completed. Uploaded file size: "} + String(upload.totalSize));
-        }
-        else {
-            Update.end();
-            Update.printError(DGB_STREAM);
-            esp_firmware_upload_error_ =
-                String{"ERROR: can not finalize file! Update error "} + String(Update.getError());
+        esp_firmware_upload_error_ = firmware_updater_.end();
+        if (esp_firmware_upload_error_.length() == 0) {
+            DEBUG_PRINTLN(String{"Uploaded file size: "} + String(upload.total_size));
         }
         DGB_STREAM.setDebugOutput(false);
     }
     else {
-        Update.end();
-        Update.printError(DGB_STREAM);
+        firmware_updater_.abort();
         esp_firmware_upload_error_ = "ERROR: uploading of file was aborted";
         DGB_STREAM.setDebugOutput(false);
         return;
@@ -468,16 +743,56 @@ SadLampWebServer::handle_esp_sw_upload()
     yield();
 }
 
+void
+SadLampWebServer::handle_esp_sw_update_from()
+{
+    if (!web_server_.has_arg("source")) {
+        return reply_bad_request("SOURCE ARG MISSING");
+    }
+    if (firmware_updater_.is_active()) {
+        return reply_server_error("ERROR: another update is in progress");
+    }
+
+    String error{ota_task_.start(web_server_.arg("source"), web_server_.arg("sha256"))};
+    if (!error.isEmpty()) {
+        return reply_server_error(error);
+    }
+    reported_ota_state_ = Utils::OtaTask::State::kIdle;  // Report start even if previous update had the same result
+    reply_ok_with_msg("ESP firmware update started");
+}
+
+// Progress is reported periodically, result - once. Lamp reboots after successful update
+void
+SadLampWebServer::report_ota_progress()
+{
+    auto state = ota_task_.get_state();
+    if ((state == reported_ota_state_) &&
+        ((state != Utils::OtaTask::State::kInProgress) || (millis() - ota_report_time_ms_ < kOtaReportPeriodMs))) {
+        return;
+    }
+    reported_ota_state_ = state;
+    ota_report_time_ms_ = millis();
+    if (handlers_[static_cast<size_t>(Event::OTA_PROGRESS)] != nullptr) {
+        handlers_[static_cast<size_t>(Event::OTA_PROGRESS)](ota_task_.get_progress_json());
+    }
+    if (state == Utils::OtaTask::State::kDone) {
+        DEBUG_PRINTLN("Rebooting...");
+        handle_reboot_esp();
+    }
+}
+
 void
 SadLampWebServer::handle_reset_wifi_settings()
 {
     reply_ok();
-    delay(500);  // Add delay to make sure response is sent to client
 
+    // WiFi settings are reset with delay to make sure response is sent to client. Server keeps working meanwhile
     DEBUG_PRINTLN("handle_reset_wifi_settings");
-    if (handlers_[static_cast<size_t>(Event::RESET_WIFI_SETTINGS)] != nullptr) {
-        handlers_[static_cast<size_t>(Event::RESET_WIFI_SETTINGS)]("");
-    }
+    Utils::Scheduler::instance().schedule_once(kResetWifiSettingsDelayMs, [this]() {
+        if (handlers_[static_cast<size_t>(Event::RESET_WIFI_SETTINGS)] != nullptr) {
+            handlers_[static_cast<size_t>(Event::RESET_WIFI_SETTINGS)]("");
+        }
+    });
 }
 
 void
@@ -489,4 +804,54 @@ SadLampWebServer::handle_reboot_esp()
     }
 }
 
+void
+SadLampWebServer::handle_config_export()
+{
+    DEBUG_PRINTLN("handle_config_export");
+    auto snapshot = Persistency::instance().export_snapshot();
+    web_server_.send_header("Content-Disposition", "attachment; filename=\"sad_lamp_config.bin\"");
+    web_server_.send(200, OCTET_STREAM, snapshot.data(), snapshot.size());
+}
+
+void
+SadLampWebServer::handle_config_upload()
+{
+    // Snapshot is small, so it is collected in RAM and is imported only when it is received completely
+    auto const& upload = web_server_.upload();
+    if (upload.status == HttpServer::UploadStatus::kStart) {
+        DEBUG_PRINTLN(String{"handle_config_upload: filename: "} + upload.filename);
+        config_snapshot_.clear();
+        config_upload_error_ = "";
+    }
+    else if (upload.status == HttpServer::UploadStatus::kWrite) {
+        if (config_snapshot_.size() + upload.current_size > kMaxConfigSnapshotSize) {
+            config_upload_error_ = "SNAPSHOT IS TOO BIG";
+            return;
+        }
+        config_snapshot_.insert(config_snapshot_.end(), upload.buf, upload.buf + upload.current_size);
+    }
+    else if (upload.status == HttpServer::UploadStatus::kAborted) {
+        config_upload_error_ = "UPLOAD ABORTED";
+    }
+}
+
+void
+SadLampWebServer::handle_config_import()
+{
+    std::vector<uint8_t> snapshot;
+    snapshot.swap(config_snapshot_);
+    if (config_upload_error_.length() != 0) {
+        reply_bad_request(config_upload_error_);
+        config_upload_error_ = "";
+        return;
+    }
+    if (!Persistency::instance().import_snapshot(snapshot)) {
+        return reply_bad_request("INVALID SNAPSHOT");
+    }
+
+    // Modules read their settings from Persistency only at start
+    reply_ok_with_msg("Configuration imported! Rebooting...");
+    handle_reboot_esp();
+}
+
 }  // namespace Servers
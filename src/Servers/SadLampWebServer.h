@@ -3,12 +3,21 @@
 
 #include <array>
 #include <functional>
+#include <memory>
+#include <vector>
 
 #include <WString.h>
-#include <WebServer.h>
 #include <WiFiClient.h>
 
+#include "AssetPack.h"
+#include "ETagIndex.h"
+#include "FileCache.h"
+#include "HttpServer.h"
+#include "src/Utils/BufferedFileWriter.h"
 #include "src/Utils/FS.h"
+#include "src/Utils/FirmwareUpdater.h"
+#include "src/Utils/FsBenchmark.h"
+#include "src/Utils/OtaTask.h"
 
 namespace Servers
 {
@@ -20,6 +29,7 @@ public:
         RESET_WIFI_SETTINGS = 0,
         REBOOT_ESP,
         GET_SSDP_DESCRIPTION,
+        OTA_PROGRESS,  // Parameters are progress of update from file or mirror in JSON (see OtaTask.h)
 
         NUM_OF_EVENTS
     };
@@ -32,8 +42,17 @@ public:
 
     void set_handler(Event event, EventHandler handler);
     void set_get_ssdp_description_handler(GetSsdpDescriptionHandler handler);
+    // Set max-age of Cache-Control of static files, whose path matches pattern ('*' matches any characters). Rules,
+    // added later, take precedence. 0 means that client should revalidate file (by ETag) on every use
+    void set_cache_max_age(String const& pattern, uint32_t max_age_s);
 
 private:
+    struct CacheRule
+    {
+        String   pattern;
+        uint32_t max_age_s;
+    };
+
     void reply_ok();
     void reply_ok_with_msg(String const& msg);
     void reply_ok_json_with_msg(String const& msg);
@@ -45,18 +64,44 @@ private:
     void handle_file_create();
     void delete_recursive(String const& path);
     void handle_file_delete();
+    bool start_tree_operation(Utils::FS::TreeOperation::Type type, String const& from, String const& to);
     void handle_file_upload();
     bool handle_file_read(String path);
     void handle_esp_sw_upload();
+    void handle_esp_sw_update_from();
+    void report_ota_progress();
     void handle_reset_wifi_settings();
     void handle_reboot_esp();
+    void handle_config_export();
+    void handle_config_upload();
+    void handle_config_import();
+
+    using FileExists = std::function<bool(String const& path)>;
+
+    bool   reply_if_not_modified(String const& cache_control, String const& etag);
+    String find_variant(String const& path, char const*& encoding, FileExists const& exists) const;
+    String get_cache_control(String const& path) const;
 
     const uint16_t                                                       port_{80};
-    WebServer                                                            web_server_;
-    Utils::FS::File                                                      upload_file_;
+    HttpServer                                                           web_server_;
+    Utils::BufferedFileWriter                                            upload_writer_;
+    String                                                               upload_path_;
+    uint32_t                                                             upload_crc_{0};
+    ETagIndex                                                            etag_index_;
+    AssetPack                                                            asset_pack_;
+    FileCache                                                            file_cache_;
     std::array<EventHandler, static_cast<uint8_t>(Event::NUM_OF_EVENTS)> handlers_;
     GetSsdpDescriptionHandler                                            get_ssdp_description_handler_{nullptr};
+    Utils::FirmwareUpdater                                               firmware_updater_;
     String                                                               esp_firmware_upload_error_;
+    Utils::OtaTask                                                       ota_task_;
+    Utils::OtaTask::State                                                reported_ota_state_{};  // kIdle
+    unsigned long                                                        ota_report_time_ms_{0};
+    std::vector<uint8_t>                                                 config_snapshot_;
+    String                                                               config_upload_error_;
+    std::vector<CacheRule>                                               cache_rules_;
+    std::unique_ptr<Utils::FS::TreeOperation>                            tree_operation_;  // The last one
+    std::unique_ptr<Utils::FsBenchmark>                                  fs_benchmark_;    // The last one
 };
 
 }  // namespace Servers
@@ -42,6 +42,12 @@ SadLampWebSocketServer::send(uint8_t client_id, String const& message)
     web_socket_server_.sendBIN(client_id, (const uint8_t*)message.c_str(), message.length());
 }
 
+void
+SadLampWebSocketServer::broadcast(String const& message)
+{
+    web_socket_server_.broadcastBIN((const uint8_t*)message.c_str(), message.length());
+}
+
 void
 SadLampWebSocketServer::on_event(uint8_t client_id, WStype_t event_type, uint8_t* payload, size_t lenght)
 {
@@ -121,12 +127,21 @@ SadLampWebSocketServer::process_command(uint8_t client_id, String const& command
         }
         return;
     }
+    else if (command == "get_arduino_alarms") {
+        DEBUG_PRINTLN(String{"Received command \""} + command + "\"");
+        if (handlers_[static_cast<size_t>(Event::GET_ARDUINO_ALARMS)] != nullptr) {
+            handlers_[static_cast<size_t>(Event::GET_ARDUINO_ALARMS)](client_id, "");
+        }
+        return;
+    }
 
     String arduino_command_str{"arduino_command"};
     String upload_arduino_firmware_str{"upload_arduino_firmware"};
     String set_arduino_datetime_str{"set_arduino_datetime"};
     String enable_arduino_alarm_str{"enable_arduino_alarm"};
     String set_arduino_alarm_time_str{"set_arduino_alarm_time"};
+    String enable_arduino_indexed_alarm_str{"enable_arduino_indexed_alarm"};
+    String set_arduino_indexed_alarm_time_str{"set_arduino_indexed_alarm_time"};
     String set_arduino_sunrise_duration_str{"set_arduino_sunrise_duration"};
     String set_arduino_brightness_str{"set_arduino_brightness"};
     if (command.startsWith(arduino_command_str)) {
@@ -145,6 +160,16 @@ SadLampWebSocketServer::process_command(uint8_t client_id, String const& command
         trigger_event(client_id, command, set_arduino_alarm_time_str, Event::SET_ARDUINO_ALARM_TIME);
         return;
     }
+    else if (command.startsWith(enable_arduino_indexed_alarm_str)) {
+        // Parameters: "II E" or "II D", where II is index of alarm
+        trigger_event(client_id, command, enable_arduino_indexed_alarm_str, Event::ENABLE_ARDUINO_INDEXED_ALARM);
+        return;
+    }
+    else if (command.startsWith(set_arduino_indexed_alarm_time_str)) {
+        // Parameters: "II HH:MM WW DDDD", where II is index of alarm and DDDD is sunrise duration in minutes
+        trigger_event(client_id, command, set_arduino_indexed_alarm_time_str, Event::SET_ARDUINO_INDEXED_ALARM_TIME);
+        return;
+    }
     else if (command.startsWith(set_arduino_sunrise_duration_str)) {
         trigger_event(client_id, command, set_arduino_sunrise_duration_str, Event::SET_ARDUINO_SUNRISE_DURATION);
         return;
@@ -26,6 +26,9 @@ public:
         SET_ARDUINO_ALARM_TIME,
         SET_ARDUINO_SUNRISE_DURATION,
         SET_ARDUINO_BRIGHTNESS,
+        GET_ARDUINO_ALARMS,
+        ENABLE_ARDUINO_INDEXED_ALARM,
+        SET_ARDUINO_INDEXED_ALARM_TIME,
 
         NUM_OF_EVENTS
     };
@@ -38,6 +41,7 @@ public:
 
     // Send to all connected clients
     void send(uint8_t client_id, String const& message);
+    void broadcast(String const& message);
 
 private:
     void on_event(uint8_t client_id, WStype_t event_type, uint8_t* payload, size_t lenght);
@@ -0,0 +1,217 @@
+#include "BufferedFileWriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+// Name is short for SPIFFS (31 characters). One name is enough, because only one file is written at a time
+constexpr char const* kTempPath{"/.upload.tmp"};
+constexpr uint8_t     kFlushMarker{Utils::BufferedFileWriter::kNumOfBuffers};  // Is put to queue instead of buffer
+constexpr uint32_t    kTaskStackSize{4096};
+constexpr UBaseType_t kTaskPriority{1};
+constexpr BaseType_t  kTaskCore{0};  // loop() runs on core 1, so buffers are filled and written in parallel
+}  // namespace
+
+namespace Utils
+{
+constexpr size_t BufferedFileWriter::kBlockSize;
+constexpr size_t BufferedFileWriter::kNumOfBuffers;
+
+BufferedFileWriter::~BufferedFileWriter()
+{
+    abort();
+    if (task_ != nullptr) {
+        vTaskDelete(task_);
+    }
+    if (full_buffers_ != nullptr) {
+        vQueueDelete(full_buffers_);
+    }
+    if (free_buffers_ != nullptr) {
+        vQueueDelete(free_buffers_);
+    }
+}
+
+String
+BufferedFileWriter::begin(String const& path)
+{
+    abort();
+    if (!FS::is_valid_path(path)) {
+        return "INVALID FILENAME";
+    }
+
+    // Task lives till the end, it is created at the first use
+    if (task_ == nullptr) {
+        if (full_buffers_ == nullptr) {
+            full_buffers_ = xQueueCreate(kNumOfBuffers + 1, sizeof(uint8_t));
+        }
+        if (free_buffers_ == nullptr) {
+            free_buffers_ = xQueueCreate(kNumOfBuffers + 1, sizeof(uint8_t));
+        }
+        if ((full_buffers_ == nullptr) || (free_buffers_ == nullptr) ||
+            (xTaskCreatePinnedToCore(
+                 task_main, "file_writer", kTaskStackSize, this, kTaskPriority, &task_, kTaskCore) != pdPASS)) {
+            DEBUG_PRINTLN("ERROR: can not create file writer task");
+            return "WRITER INIT FAILED";
+        }
+    }
+
+    memory_ = static_cast<uint8_t*>(malloc(kBlockSize * kNumOfBuffers));
+    if (memory_ == nullptr) {
+        return "NOT ENOUGH MEMORY";
+    }
+    file_ = FS::open(kTempPath, FS::OpenMode::kWrite);
+    if (!file_) {
+        release();
+        return "CREATE FILE FAILED";
+    }
+
+    path_ = path;
+    sizes_.fill(0);
+    current_   = 0;
+    is_failed_ = false;
+    xQueueReset(full_buffers_);
+    xQueueReset(free_buffers_);
+    for (uint8_t i = 1; i < kNumOfBuffers; ++i) {
+        xQueueSend(free_buffers_, &i, 0);
+    }
+    return String{};
+}
+
+bool
+BufferedFileWriter::write(uint8_t const* data, size_t size)
+{
+    if (!is_active()) {
+        return false;
+    }
+    while ((size > 0) && !is_failed_) {
+        size_t chunk_size{std::min(kBlockSize - sizes_[current_], size)};
+        memcpy(memory_ + current_ * kBlockSize + sizes_[current_], data, chunk_size);
+        sizes_[current_] += chunk_size;
+        data += chunk_size;
+        size -= chunk_size;
+        if (sizes_[current_] == kBlockSize) {
+            submit_current_buffer();
+        }
+    }
+    if (is_failed_) {
+        // Writer task only sets the flag, error is reported here in loop()
+        DEBUG_PRINTLN(String{"ERROR: can not write "} + path_);
+        return false;
+    }
+    return true;
+}
+
+String
+BufferedFileWriter::end()
+{
+    if (!is_active()) {
+        return "NO FILE IS WRITTEN";
+    }
+    flush();
+    FS::close(file_);
+    String path{path_};
+    bool   is_failed{is_failed_};
+    release();
+
+    if (is_failed) {
+        DEBUG_PRINTLN(String{"ERROR: can not write "} + path);
+        FS::remove(kTempPath);
+        return "WRITE FAILED";
+    }
+    auto result{FS::replace(kTempPath, path)};
+    if (!result.first) {
+        FS::remove(kTempPath);
+        return result.second;
+    }
+    return String{};
+}
+
+void
+BufferedFileWriter::abort()
+{
+    if (!is_active()) {
+        return;
+    }
+    // Buffers, which are already given to writer, are skipped
+    is_failed_       = true;
+    sizes_[current_] = 0;
+    flush();
+    FS::close(file_);
+    release();
+    FS::remove(kTempPath);
+}
+
+bool
+BufferedFileWriter::is_active() const
+{
+    return memory_ != nullptr;
+}
+
+void
+BufferedFileWriter::submit_current_buffer()
+{
+    // Queues are long enough for all buffers and marker, so sending never blocks. Receiving blocks, if all buffers are
+    // being written
+    xQueueSend(full_buffers_, &current_, portMAX_DELAY);
+    xQueueReceive(free_buffers_, &current_, portMAX_DELAY);
+    sizes_[current_] = 0;
+}
+
+void
+BufferedFileWriter::flush()
+{
+    if (sizes_[current_] > 0) {
+        xQueueSend(full_buffers_, &current_, portMAX_DELAY);
+    }
+    // Buffers are written in order of submission, so marker returns after all of them
+    xQueueSend(full_buffers_, &kFlushMarker, portMAX_DELAY);
+    uint8_t index{0};
+    do {
+        xQueueReceive(free_buffers_, &index, portMAX_DELAY);
+    } while (index != kFlushMarker);
+    sizes_[current_] = 0;
+}
+
+// Is called from writer task. It uses file directly, because Utils::FS is not thread safe. Index of Utils::FS is
+// updated, when file is replaced. Nothing is logged here, failure is only marked for write() and end()
+void
+BufferedFileWriter::write_buffer(uint8_t index)
+{
+    if (is_failed_) {
+        return;
+    }
+    if (file_.write(memory_ + index * kBlockSize, sizes_[index]) != sizes_[index]) {
+        is_failed_ = true;
+    }
+}
+
+void
+BufferedFileWriter::release()
+{
+    free(memory_);
+    memory_ = nullptr;
+    path_   = String{};
+}
+
+void
+BufferedFileWriter::task_main(void* writer)
+{
+    auto*   self = static_cast<BufferedFileWriter*>(writer);
+    uint8_t index{0};
+    for (;;) {
+        if (xQueueReceive(self->full_buffers_, &index, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (index != kFlushMarker) {
+            self->write_buffer(index);
+        }
+        xQueueSend(self->free_buffers_, &index, portMAX_DELAY);
+    }
+}
+
+}  // namespace Utils
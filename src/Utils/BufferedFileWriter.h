@@ -0,0 +1,70 @@
+#ifndef SRC_UTILS_BUFFEREDFILEWRITER_H_
+#define SRC_UTILS_BUFFEREDFILEWRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <atomic>
+
+#include <WString.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+#include "src/Utils/FS.h"
+
+namespace Utils
+{
+// Writes file, which comes by parts (ex. from network), in separate FreeRTOS task, so caller does not wait while flash
+// is being erased and written. Data is collected in one buffer, while other full buffers are being written by task.
+// Buffers are of size of flash sector, so FS gets whole pages. If all buffers are full, write() waits for task.
+// Data is written to temporary file /.upload.tmp. Temporary file replaces target file only when all data is written,
+// so partially written file never appears under its name.
+// Only one file can be written at a time. Errors of task are reported by write() and end() in caller's task.
+class BufferedFileWriter
+{
+public:
+    static constexpr size_t kBlockSize{4096};
+    static constexpr size_t kNumOfBuffers{3};
+
+    BufferedFileWriter() = default;
+    BufferedFileWriter(BufferedFileWriter const&) = delete;
+    BufferedFileWriter& operator=(BufferedFileWriter const&) = delete;
+    ~BufferedFileWriter();
+
+    // Return error or empty string
+    String begin(String const& path);
+    // Return false if data can not be written. Content of file is not known then, call abort()
+    bool   write(uint8_t const* data, size_t size);
+    // Write the rest of data and replace target file. Return error or empty string
+    String end();
+    // Remove temporary file
+    void   abort();
+    bool   is_active() const;
+
+private:
+    // Give full buffer to writer and take free one
+    void submit_current_buffer();
+    // Write current buffer and wait till all buffers are written
+    void flush();
+    void write_buffer(uint8_t index);
+    void release();
+
+    static void task_main(void* writer);
+
+    TaskHandle_t                      task_{nullptr};
+    QueueHandle_t                     full_buffers_{nullptr};
+    QueueHandle_t                     free_buffers_{nullptr};
+    String                            path_;
+    FS::File                          file_;
+    uint8_t*                          memory_{nullptr};  // All buffers in single block, allocated only during writing
+    std::array<size_t, kNumOfBuffers> sizes_{};
+    uint8_t                           current_{0};  // Buffer, which is filled by write()
+    std::atomic<bool>                 is_failed_{false};
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_BUFFEREDFILEWRITER_H_
@@ -0,0 +1,253 @@
+#include "DateTime.h"
+
+namespace
+{
+constexpr uint16_t kMinYear{2000};
+constexpr uint16_t kMaxYear{2099};
+
+bool
+is_leap_year(uint16_t year)
+{
+    return ((year % 4 == 0) && (year % 100 != 0)) || (year % 400 == 0);
+}
+
+int8_t
+hex_digit_value(char c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F')) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+}  // namespace
+
+namespace Utils
+{
+namespace DateTime
+{
+Error
+parse_fixed_uint(char const* str, uint8_t width, uint16_t& value)
+{
+    uint16_t result{0};
+    for (uint8_t i = 0; i < width; ++i) {
+        if ((str[i] < '0') || (str[i] > '9')) {
+            return Error::kInvalidDigit;
+        }
+        result = result * 10 + (str[i] - '0');
+    }
+    value = result;
+    return Error::kOk;
+}
+
+Error
+parse_fixed_hex(char const* str, uint8_t width, uint16_t& value)
+{
+    uint16_t result{0};
+    for (uint8_t i = 0; i < width; ++i) {
+        auto digit = hex_digit_value(str[i]);
+        if (digit < 0) {
+            return Error::kInvalidDigit;
+        }
+        result = (result << 4) | digit;
+    }
+    value = result;
+    return Error::kOk;
+}
+
+void
+format_fixed_uint(char* str, uint8_t width, uint16_t value)
+{
+    for (int8_t i = width - 1; i >= 0; --i) {
+        str[i] = '0' + (value % 10);
+        value /= 10;
+    }
+}
+
+void
+format_fixed_hex(char* str, uint8_t width, uint16_t value)
+{
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+    for (int8_t i = width - 1; i >= 0; --i) {
+        str[i] = kHexDigits[value & 0x0F];
+        value >>= 4;
+    }
+}
+
+uint8_t
+days_in_month(uint16_t year, uint8_t month)
+{
+    static constexpr uint8_t kDaysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if ((month < 1) || (month > 12)) {
+        return 0;
+    }
+    return ((month == 2) && is_leap_year(year)) ? 29 : kDaysInMonth[month - 1];
+}
+
+uint8_t
+day_of_week(uint16_t year, uint8_t month, uint8_t day)
+{
+    static constexpr uint8_t kMonthOffsets[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+    if (month < 3) {
+        year -= 1;
+    }
+    // Result of Sakamoto's algorithm is 0 for Sunday
+    return ((year + year / 4 - year / 100 + year / 400 + kMonthOffsets[month - 1] + day) % 7) + 1;
+}
+
+Error
+parse_datetime(char const* str, size_t length, tmElements_t& datetime)
+{
+    // HH:MM:SS DD/MM/YYYY
+    if (length != kDateTimeStrLength) {
+        return Error::kInvalidLength;
+    }
+    if ((str[2] != ':') || (str[5] != ':') || (str[8] != ' ') || (str[11] != '/') || (str[14] != '/')) {
+        return Error::kInvalidSeparator;
+    }
+
+    uint16_t hour, minute, second, day, month, year;
+    Error    error;
+    if (((error = parse_fixed_uint(str, 2, hour)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 3, 2, minute)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 6, 2, second)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 9, 2, day)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 12, 2, month)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 15, 4, year)) != Error::kOk)) {
+        return error;
+    }
+
+    if ((hour > 23) || (minute > 59) || (second > 59) || (year < kMinYear) || (year > kMaxYear) || (day < 1) ||
+        (day > days_in_month(year, month))) {
+        return Error::kOutOfRange;
+    }
+
+    datetime.Hour   = hour;
+    datetime.Minute = minute;
+    datetime.Second = second;
+    datetime.Day    = day;
+    datetime.Month  = month;
+    datetime.Year   = CalendarYrToTm(year);
+    datetime.Wday   = day_of_week(year, month, day);
+    return Error::kOk;
+}
+
+size_t
+format_datetime(tmElements_t const& datetime, char* buffer, size_t size)
+{
+    // HH:MM:SS DD/MM/YYYY
+    if (size < kDateTimeStrLength + 1) {
+        return 0;
+    }
+
+    format_fixed_uint(buffer, 2, datetime.Hour);
+    buffer[2] = ':';
+    format_fixed_uint(buffer + 3, 2, datetime.Minute);
+    buffer[5] = ':';
+    format_fixed_uint(buffer + 6, 2, datetime.Second);
+    buffer[8] = ' ';
+    format_fixed_uint(buffer + 9, 2, datetime.Day);
+    buffer[11] = '/';
+    format_fixed_uint(buffer + 12, 2, datetime.Month);
+    buffer[14] = '/';
+    format_fixed_uint(buffer + 15, 4, tmYearToCalendar(datetime.Year));
+    buffer[kDateTimeStrLength] = '\0';
+    return kDateTimeStrLength;
+}
+
+Error
+parse_alarm(char const* str, size_t length, Alarm& alarm)
+{
+    // HH:MM[ W[W][ DDDD]]
+    // Days of week are sent by WebUI without leading zero. Sunrise duration is optional, 0 means default duration
+    if (length < 5) {
+        return Error::kInvalidLength;
+    }
+    if (str[2] != ':') {
+        return Error::kInvalidSeparator;
+    }
+
+    uint16_t hour, minute;
+    Error    error;
+    if (((error = parse_fixed_uint(str, 2, hour)) != Error::kOk) ||
+        ((error = parse_fixed_uint(str + 3, 2, minute)) != Error::kOk)) {
+        return error;
+    }
+    if ((hour > 23) || (minute > 59)) {
+        return Error::kOutOfRange;
+    }
+
+    uint16_t days_of_week{kEveryDayMask};
+    uint16_t duration_m{0};
+    size_t   position{5};
+    if (position < length) {
+        if (str[position] != ' ') {
+            return Error::kInvalidSeparator;
+        }
+        ++position;
+
+        uint8_t dow_width = ((position + 1 < length) && (str[position + 1] != ' ')) ? 2 : 1;
+        if (position + dow_width > length) {
+            return Error::kInvalidLength;
+        }
+        if ((error = parse_fixed_hex(str + position, dow_width, days_of_week)) != Error::kOk) {
+            return error;
+        }
+        if (days_of_week > kEveryDayMask) {
+            return Error::kOutOfRange;
+        }
+        if (days_of_week == 0) {
+            // For compatibility with previous versions
+            days_of_week = kEveryDayMask;
+        }
+        position += dow_width;
+    }
+    if (position < length) {
+        if (str[position] != ' ') {
+            return Error::kInvalidSeparator;
+        }
+        ++position;
+
+        if (position + 4 != length) {
+            return Error::kInvalidLength;
+        }
+        if ((error = parse_fixed_uint(str + position, 4, duration_m)) != Error::kOk) {
+            return error;
+        }
+        if (duration_m > kMaxSunriseDurationMinutes) {
+            return Error::kOutOfRange;
+        }
+    }
+
+    alarm = Alarm{(uint8_t)hour, (uint8_t)minute, (uint8_t)days_of_week, duration_m};
+    return Error::kOk;
+}
+
+char const*
+error_to_str(Error error)
+{
+    switch (error) {
+    case Error::kOk:
+        return "OK";
+    case Error::kInvalidLength:
+        return "INVALID LENGTH";
+    case Error::kInvalidDigit:
+        return "INVALID DIGIT";
+    case Error::kInvalidSeparator:
+        return "INVALID SEPARATOR";
+    case Error::kOutOfRange:
+        return "VALUE OUT OF RANGE";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+}  // namespace DateTime
+
+}  // namespace Utils
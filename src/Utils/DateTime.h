@@ -0,0 +1,65 @@
+#ifndef SRC_UTILS_DATETIME_H_
+#define SRC_UTILS_DATETIME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <TimeLib.h>
+
+namespace Utils
+{
+// Parsing and formatting of date and time without heap allocations. All functions work on (pointer, length) pairs,
+// input strings do not have to be null-terminated.
+namespace DateTime
+{
+enum class Error : uint8_t
+{
+    kOk = 0,
+    kInvalidLength,
+    kInvalidDigit,
+    kInvalidSeparator,
+    kOutOfRange
+};
+
+// Length of "HH:MM:SS DD/MM/YYYY" without terminating null character
+constexpr size_t kDateTimeStrLength{19};
+
+// Alarm is set for days of week from bit mask: bit 0 is Monday, bit 6 is Sunday
+constexpr uint8_t  kEveryDayMask{0x7F};
+constexpr uint16_t kMaxSunriseDurationMinutes{24 * 60};
+
+struct Alarm
+{
+    uint8_t  hour;
+    uint8_t  minute;
+    uint8_t  days_of_week;
+    uint16_t sunrise_duration_m;  // 0 means default duration
+};
+
+// Parse exactly "width" decimal (or hex) digits
+Error parse_fixed_uint(char const* str, uint8_t width, uint16_t& value);
+Error parse_fixed_hex(char const* str, uint8_t width, uint16_t& value);
+
+// Write exactly "width" decimal (or lowercase hex) digits with leading zeros. Terminating null character is not added
+void format_fixed_uint(char* str, uint8_t width, uint16_t value);
+void format_fixed_hex(char* str, uint8_t width, uint16_t value);
+
+uint8_t days_in_month(uint16_t year, uint8_t month);
+// Sakamoto's algorithm. Return TimeLib's day of week: 1 is Sunday, 7 is Saturday
+uint8_t day_of_week(uint16_t year, uint8_t month, uint8_t day);
+
+// "HH:MM:SS DD/MM/YYYY". Week day is calculated. Year should be in range supported by RTC (2000-2099)
+Error parse_datetime(char const* str, size_t length, tmElements_t& datetime);
+// Buffer should have at least kDateTimeStrLength + 1 bytes. Return length of result (without null character) or 0 if
+// buffer is too small
+size_t format_datetime(tmElements_t const& datetime, char* buffer, size_t size);
+
+// "HH:MM[ W[W][ DDDD]]": time, hex mask of days of week (0 means every day) and sunrise duration in minutes
+Error parse_alarm(char const* str, size_t length, Alarm& alarm);
+
+char const* error_to_str(Error error);
+}  // namespace DateTime
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_DATETIME_H_
@@ -0,0 +1,233 @@
+#include "DeltaPatcher.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+
+namespace
+{
+constexpr uint16_t kFormatVersion{1};
+constexpr size_t   kBufferSize{512};
+// Offsets of fields in header
+constexpr size_t kVersionOffset{4};
+constexpr size_t kSourceSizeOffset{8};
+constexpr size_t kSourceSha256Offset{12};
+constexpr size_t kTargetSizeOffset{44};
+constexpr size_t kTargetSha256Offset{48};
+
+uint32_t
+read_uint32_le(uint8_t const* data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Read block of firmware, which is running now
+bool
+read_source(size_t offset, uint8_t* data, size_t size)
+{
+    auto const* partition = esp_ota_get_running_partition();
+    return (partition != nullptr) && (esp_partition_read(partition, offset, data, size) == ESP_OK);
+}
+
+}  // namespace
+
+namespace Utils
+{
+constexpr uint8_t DeltaPatcher::kMagic[];
+constexpr size_t  DeltaPatcher::kSha256Size;
+constexpr size_t  DeltaPatcher::kHeaderSize;
+constexpr size_t  DeltaPatcher::kControlSize;
+
+void
+DeltaPatcher::begin(Output output)
+{
+    output_              = output;
+    state_               = State::kHeader;
+    num_of_fields_bytes_ = 0;
+    source_size_         = 0;
+    target_size_         = 0;
+    source_position_     = 0;
+    target_position_     = 0;
+}
+
+String
+DeltaPatcher::write(uint8_t const* data, size_t size)
+{
+    while (size > 0) {
+        size_t consumed{0};
+        String error;
+        switch (state_) {
+        case State::kHeader:
+        case State::kControl: {
+            // Header and control of record can be split between parts of patch
+            size_t fields_size{(state_ == State::kHeader) ? kHeaderSize : kControlSize};
+            consumed = std::min(fields_size - num_of_fields_bytes_, size);
+            memcpy(fields_.data() + num_of_fields_bytes_, data, consumed);
+            num_of_fields_bytes_ += consumed;
+            if (num_of_fields_bytes_ == fields_size) {
+                num_of_fields_bytes_ = 0;
+                error                = (state_ == State::kHeader) ? parse_header() : parse_control();
+            }
+            break;
+        }
+        case State::kDiff:
+            consumed = std::min(diff_size_, size);
+            error    = apply_diff(data, consumed);
+            break;
+        case State::kExtra:
+            consumed = std::min(extra_size_, size);
+            error    = copy_extra(data, consumed);
+            break;
+        default:
+            return "ERROR: unexpected data after firmware delta";
+        }
+        if (!error.isEmpty()) {
+            return error;
+        }
+        data += consumed;
+        size -= consumed;
+    }
+    return String{};
+}
+
+bool
+DeltaPatcher::is_finished() const
+{
+    return state_ == State::kDone;
+}
+
+size_t
+DeltaPatcher::get_target_size() const
+{
+    return target_size_;
+}
+
+std::array<uint8_t, DeltaPatcher::kSha256Size> const&
+DeltaPatcher::get_target_sha256() const
+{
+    return target_sha256_;
+}
+
+String
+DeltaPatcher::parse_header()
+{
+    if ((memcmp(fields_.data(), kMagic, sizeof(kMagic)) != 0) ||
+        ((fields_[kVersionOffset] | (fields_[kVersionOffset + 1] << 8)) != kFormatVersion)) {
+        return "ERROR: unsupported format of firmware delta";
+    }
+    source_size_ = read_uint32_le(&fields_[kSourceSizeOffset]);
+    target_size_ = read_uint32_le(&fields_[kTargetSizeOffset]);
+    memcpy(target_sha256_.data(), &fields_[kTargetSha256Offset], kSha256Size);
+
+    // Delta is useless for another old firmware, check it before new firmware is written
+    auto const* partition = esp_ota_get_running_partition();
+    if ((partition == nullptr) || (source_size_ > partition->size)) {
+        return "ERROR: firmware delta is made for another firmware";
+    }
+    mbedtls_sha256_context context;
+    mbedtls_sha256_init(&context);
+    mbedtls_sha256_starts_ret(&context, 0);
+    uint8_t buffer[kBufferSize];
+    for (size_t offset = 0; offset < source_size_; offset += kBufferSize) {
+        size_t block_size{std::min(kBufferSize, source_size_ - offset)};
+        if (!read_source(offset, buffer, block_size)) {
+            mbedtls_sha256_free(&context);
+            return "ERROR: can not read running firmware";
+        }
+        mbedtls_sha256_update_ret(&context, buffer, block_size);
+    }
+    std::array<uint8_t, kSha256Size> source_sha256;
+    mbedtls_sha256_finish_ret(&context, source_sha256.data());
+    mbedtls_sha256_free(&context);
+    if (memcmp(source_sha256.data(), &fields_[kSourceSha256Offset], kSha256Size) != 0) {
+        return "ERROR: firmware delta is made for another firmware";
+    }
+
+    state_ = (target_size_ == 0) ? State::kDone : State::kControl;
+    return String{};
+}
+
+String
+DeltaPatcher::parse_control()
+{
+    diff_size_  = read_uint32_le(&fields_[0]);
+    extra_size_ = read_uint32_le(&fields_[4]);
+    seek_       = static_cast<int32_t>(read_uint32_le(&fields_[8]));
+    if ((diff_size_ > target_size_ - target_position_) ||
+        (extra_size_ > target_size_ - target_position_ - diff_size_)) {
+        return "ERROR: firmware delta is corrupted";
+    }
+    next_state();
+    return String{};
+}
+
+String
+DeltaPatcher::apply_diff(uint8_t const* data, size_t size)
+{
+    uint8_t buffer[kBufferSize];
+    while (size > 0) {
+        size_t block_size{std::min(kBufferSize, size)};
+        if ((source_position_ < 0) || (static_cast<size_t>(source_position_) + block_size > source_size_)) {
+            return "ERROR: firmware delta is corrupted";
+        }
+        if (!read_source(source_position_, buffer, block_size)) {
+            return "ERROR: can not read running firmware";
+        }
+        for (size_t i = 0; i < block_size; ++i) {
+            buffer[i] += data[i];
+        }
+        String error{output(buffer, block_size)};
+        if (!error.isEmpty()) {
+            return error;
+        }
+        source_position_ += block_size;
+        diff_size_ -= block_size;
+        data += block_size;
+        size -= block_size;
+    }
+    next_state();
+    return String{};
+}
+
+String
+DeltaPatcher::copy_extra(uint8_t const* data, size_t size)
+{
+    String error{output(data, size)};
+    if (!error.isEmpty()) {
+        return error;
+    }
+    extra_size_ -= size;
+    next_state();
+    return String{};
+}
+
+String
+DeltaPatcher::output(uint8_t const* data, size_t size)
+{
+    target_position_ += size;
+    return output_(data, size);
+}
+
+// Parts of record go in order: diff, extra, seek
+void
+DeltaPatcher::next_state()
+{
+    if (diff_size_ > 0) {
+        state_ = State::kDiff;
+    }
+    else if (extra_size_ > 0) {
+        state_ = State::kExtra;
+    }
+    else {
+        source_position_ += seek_;
+        seek_  = 0;
+        state_ = (target_position_ == target_size_) ? State::kDone : State::kControl;
+    }
+}
+
+}  // namespace Utils
@@ -0,0 +1,76 @@
+#ifndef SRC_UTILS_DELTAPATCHER_H_
+#define SRC_UTILS_DELTAPATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <functional>
+
+#include <WString.h>
+
+namespace Utils
+{
+// Applies delta patch, made by tools/make_firmware_delta.py, to firmware, which is running now. Patch comes by parts,
+// new firmware goes to output by parts as well. Old firmware is read from running partition by small blocks, so
+// neither old nor new firmware is kept in RAM.
+// Patch format (little endian):
+// - header: "SLDP", version (uint16), reserved (uint16), size and SHA-256 of old firmware, size and SHA-256 of new
+//   firmware;
+// - records till the end of new firmware (bsdiff-like): diff size (uint32), extra size (uint32), seek (int32), diff
+//   bytes, extra bytes. Diff bytes are added to bytes of old firmware, extra bytes are copied to new firmware as they
+//   are, then position in old firmware is moved by seek.
+// SHA-256 of old firmware is checked before the first byte is written. SHA-256 of new firmware is checked by caller.
+// Methods return error or empty string.
+class DeltaPatcher
+{
+public:
+    using Output = std::function<String(uint8_t const* data, size_t size)>;
+
+    static constexpr uint8_t kMagic[]{'S', 'L', 'D', 'P'};
+    static constexpr size_t  kSha256Size{32};
+
+    void                                    begin(Output output);
+    String                                  write(uint8_t const* data, size_t size);
+    bool                                    is_finished() const;
+    // Valid after header is received
+    size_t                                  get_target_size() const;
+    std::array<uint8_t, kSha256Size> const& get_target_sha256() const;
+
+private:
+    enum class State : uint8_t
+    {
+        kHeader = 0,
+        kControl,
+        kDiff,
+        kExtra,
+        kDone
+    };
+
+    static constexpr size_t kHeaderSize{80};
+    static constexpr size_t kControlSize{12};
+
+    String parse_header();
+    String parse_control();
+    String apply_diff(uint8_t const* data, size_t size);
+    String copy_extra(uint8_t const* data, size_t size);
+    String output(uint8_t const* data, size_t size);
+    void   next_state();
+
+    Output                           output_;
+    State                            state_{State::kHeader};
+    std::array<uint8_t, kHeaderSize> fields_{};  // Header or control of record, which is being received
+    size_t                           num_of_fields_bytes_{0};
+    size_t                           source_size_{0};
+    size_t                           target_size_{0};
+    std::array<uint8_t, kSha256Size> target_sha256_{};
+    int64_t                          source_position_{0};
+    size_t                           target_position_{0};
+    size_t                           diff_size_{0};   // Bytes of diff, which are not received yet
+    size_t                           extra_size_{0};  // Bytes of extra, which are not received yet
+    int32_t                          seek_{0};
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_DELTAPATCHER_H_
@@ -1,16 +1,31 @@
 #include "FS.h"
 
 #include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 
-#include <map>
+#include <algorithm>
 
-#include <SPIFFS.h>
+#include <Arduino.h>
+
+#include "src/Utils/FsBackend.h"
 #include "src/Utils/Logger.h"
+#include "src/Utils/PathIndex.h"
 
 namespace
 {
-const String kSpiffsMountingPoint{"/spiffs"};  // Check it in SPIFFS.h
+constexpr unsigned long kExternalChangeCheckPeriodMs{1000};
+
+Utils::FsBackend& backend{Utils::FsBackend::instance()};
+Utils::PathIndex  path_index{backend.has_real_directories()};
+bool              is_index_built{false};
+bool              is_write_pending{false};  // Data is written to file, which is not closed yet
+size_t            num_of_running_tree_operations{0};
+size_t            indexed_used_bytes{0};    // Used bytes of FS, when index was up to date
+uint32_t          num_of_external_changes{0};
+unsigned long     last_external_change_check_ms{0};
 
 bool
 is_real_SPIFFS_dir(String const& dir_path)
@@ -46,80 +61,127 @@ check_for_unsupported_path(String const& filename)
     return error;
 }
 
-String
-last_existing_parent(String path)
+void
+build_index()
 {
-    while (!path.isEmpty() && !Utils::FS::exists(path)) {
-        if (path.lastIndexOf('/') > 0) {
-            path = path.substring(0, path.lastIndexOf('/'));
-        }
-        else {
-            path.clear();  // No slash => the top folder does not exist
+    path_index.clear();
+    is_index_built     = true;
+    indexed_used_bytes = backend.used_bytes();
+
+    // Walk directories without recursion. On SPIFFS all files are listed from root
+    std::vector<String> dirs{"/"};
+    while (!dirs.empty()) {
+        File dir = backend.get_fs().open(dirs.back(), "r");
+        dirs.pop_back();
+        while (File file = dir.openNextFile()) {
+            String path{file.name()};
+            if (!path.startsWith("/")) {
+                path = "/" + path;
+            }
+            if (file.isDirectory()) {
+                path_index.add_directory(path);
+                dirs.push_back(path);
+            }
+            else {
+                path_index.add_file(path, file.size());
+            }
         }
     }
-    DEBUG_PRINTLN(String{"Last existing parent: '"} + path + "'");
-    return path;
+    DEBUG_PRINTLN(String{"FS index is built. Entries: "} + String{path_index.size()});
 }
 
-// Delete the file or folder designed by the given path.
-// If it's a file, delete it.
-// If it's a folder, delete all nested contents first then the folder itself
-
-// IMPORTANT NOTE: using recursion is generally not recommended on embedded devices and can lead to crashes
-// (stack overflow errors). It might crash in case of deeply nested filesystems.
-// Please don't do this on a production system.
-void
-delete_recursive(String const& path)
+// Files may be changed bypassing Utils::FS (ex. by FTP server). Such changes are detected by change of used bytes,
+// which is checked not often, because on LittleFS it takes traversal of metadata. Rename of file and changes of small
+// files on LittleFS (they are inlined into metadata) can not be detected this way
+Utils::PathIndex&
+get_index()
 {
-    // If it's a plain file, delete it
-    if (!Utils::FS::is_directory(path)) {
-        SPIFFS.remove(path);
-        return;
+    if (!is_index_built) {
+        build_index();
     }
-
-    // Otherwise delete its contents first
-    File dir = Utils::FS::open(path, Utils::FS::OpenMode::kRead);
-    while (File file = dir.openNextFile()) {
-        delete_recursive(path + '/' + file.name());
+    else if (!is_write_pending && (num_of_running_tree_operations == 0) &&
+             (millis() - last_external_change_check_ms >= kExternalChangeCheckPeriodMs)) {
+        last_external_change_check_ms = millis();
+        if (backend.used_bytes() != indexed_used_bytes) {
+            DEBUG_PRINTLN("FS is changed outside of Utils::FS. Rebuilding FS index");
+            ++num_of_external_changes;
+            build_index();
+        }
     }
+    return path_index;
+}
 
-    // Then delete the folder itself
-    SPIFFS.rmdir(path);
+// Call after every change of FS, made through Utils::FS
+void
+on_index_updated()
+{
+    indexed_used_bytes = backend.used_bytes();
 }
 
-bool
-case_insensitive_string_less(String const& str1, String const& str2)
+String
+parent_of(String const& path)
 {
-    auto min_size = (str1.length() < str2.length()) ? str1.length() : str2.length();
-    for (size_t i = 0; i < min_size; ++i) {
-        if (std::toupper(str1[i]) != std::toupper(str2[i])) {
-            return std::toupper(str1[i]) < std::toupper(str2[i]);
-        }
-    }
-    return str1.length() < str2.length();
+    return (path.lastIndexOf('/') > -1) ? path.substring(0, path.lastIndexOf('/')) : path;
 }
 
-auto filename_less = [](String const& l, String const& r) {
-    // return std::lexicographical_compare(l.begin(), l.end(), r.begin(), r.end());
-    if ((l[0] == '/') && (r[0] != '/')) {
-        // "l" is directory
-        return true;
+void
+remove_trailing_slash(String& path)
+{
+    if ((path.length() > 1) && path.endsWith("/")) {
+        path.remove(path.length() - 1);
     }
-    else if ((r[0] == '/') && (l[0] != '/')) {
-        // "r" is directory
-        return false;
+}
+
+// Old way to find type of entry, by access to flash. Used only for paths, which index can not resolve
+Utils::FS::EntryType
+read_entry_type(String const& path)
+{
+    struct stat _stat;
+    String      fullPath{String{backend.get_mount_point()} + path};
+    if (!stat(fullPath.c_str(), &_stat)) {
+        // File found
+        if (S_ISREG(_stat.st_mode)) {
+            // Looks like regular file. But try to open it
+            FILE* file = fopen(fullPath.c_str(), "r");
+            if (!file) {
+                return Utils::FS::EntryType::kUnknown;
+            }
+            fclose(file);
+            return Utils::FS::EntryType::kFile;
+        }
+        else if (S_ISDIR(_stat.st_mode) && backend.has_real_directories()) {
+            return Utils::FS::EntryType::kDirectory;
+        }
+        else if (S_ISDIR(_stat.st_mode)) {
+            // Directory or non-existing item (on SPIFFS)
+            return is_real_SPIFFS_dir(fullPath) ? Utils::FS::EntryType::kDirectory : Utils::FS::EntryType::kUnknown;
+        }
+        else {
+            // Unknown type
+            return Utils::FS::EntryType::kUnknown;
+        }
     }
-    else if ((l[0] == '/') && (r[0] == '/')) {
-        // Both strings are directory names
-        return case_insensitive_string_less(l.substring(1), r.substring(1));
+    else {
+        // File not found. Try to open as directory
+        return is_real_SPIFFS_dir(fullPath) ? Utils::FS::EntryType::kDirectory : Utils::FS::EntryType::kUnknown;
     }
-    // Regular file names
-    return case_insensitive_string_less(l, r);
-};
+}
+
 }  // namespace
 
 namespace Utils
 {
+bool
+FS::begin()
+{
+    if (!backend.begin()) {
+        DEBUG_PRINTLN(String{"ERROR: can not mount "} + backend.get_name());
+        return false;
+    }
+    build_index();
+    return true;
+}
+
 bool
 FS::exists(String const& path)
 {
@@ -129,60 +191,10 @@ FS::exists(String const& path)
     return (get_entry_type(path) != FS::EntryType::kUnknown);
 }
 
-String
-FS::get_file_list_json(String const& path)
+bool
+FS::is_valid_path(String const& path)
 {
-    File root = open(path, OpenMode::kRead);
-
-    String                                            name;  // Use the same string for every line
-    std::map<String, String, decltype(filename_less)> files_data(filename_less);
-    String                                            output;
-    output.reserve(64);
-    while (File file = root.openNextFile()) {
-        String error{check_for_unsupported_path(file.name())};
-        if (!error.isEmpty()) {
-            DEBUG_PRINTLN(String{"Ignoring "} + file.name() + ": " + error);
-            continue;
-        }
-
-        output += "{\"type\":\"";
-        if (FS::is_directory(file.name())) {
-            // There is no directories on SPIFFS. This code is here for compatibility with another (possible)
-            // filesystems
-            output += "dir";
-        }
-        else {
-            output += "file\",\"size\":\"";
-            output += file.size();
-        }
-
-        output += "\",\"name\":\"";
-        // Always return names without leading "/"
-        if (file.name()[0] == '/') {
-            output += &(file.name()[1]);
-            name = file.name();  // name in map should contain leading "/"
-        }
-        else {
-            output += file.name();
-            name = '/' + file.name();  // name in map should contain leading "/"
-        }
-
-        output += "\"}";
-
-        files_data.insert({name, output});
-        output.clear();
-    }
-
-    // Sort file list before building output.
-    // NOTE: SPIFFS doesn't support directories! Path <directory_name/filename> can exist, but directory, as entity,
-    // not. Directories are used just as part of path.
-    output = '[';
-    for (auto const& data_pair : files_data) {
-        output += data_pair.second + ',';
-    }
-    output.remove(output.length() - 1);
-    output += ']';
-    return output;
+    return check_for_unsupported_path(path).isEmpty();
 }
 
 std::pair<File, String>
@@ -213,15 +225,19 @@ std::pair<bool, String>
 FS::create_folder(String path)
 {
     // Doesn't work for SPIFFS on ESP32. SPIFFS.mkdir("/testdir") returns true, but folder is not created.
-    // Most probably this is expected behavior, because SPIFFS doesn't support folders.
+    // Most probably this is expected behavior, because SPIFFS doesn't support folders. Works on other backends
     if (check_for_unsupported_path(path) != "!TRAILING_SLASH! ") {
         return {false, "INVALID FOLDER NAME"};
     }
 
     path.remove(path.length() - 1);
-    if (!SPIFFS.mkdir(path)) {
+    if (!backend.get_fs().mkdir(path)) {
         return {false, "MKDIR FAILED"};
     }
+    if (backend.has_real_directories()) {
+        get_index().add_directory(path);
+        on_index_updated();
+    }
 
     if (path.lastIndexOf('/') > -1) {
         path = path.substring(0, path.lastIndexOf('/'));
@@ -233,62 +249,142 @@ void
 FS::close(File& file)
 {
     file.close();
+    if (is_write_pending) {
+        // FS allocates space, when buffered data is flushed
+        is_write_pending = false;
+        on_index_updated();
+    }
 }
 
 std::pair<bool, String>
 FS::rename(String from, String to)
 {
-    if (to.endsWith("/")) {
-        to.remove(to.length() - 1);
-    }
-    if (from.endsWith("/")) {
-        from.remove(from.length() - 1);
-    }
-    if (!check_for_unsupported_path(to).isEmpty()) {
-        return {false, "INVALID FINAL FILENAME"};
+    TreeOperation operation{TreeOperation::Type::kMove, from, std::move(to)};
+    while (operation.step() == TreeOperation::State::kInProgress) {
     }
-    if (!check_for_unsupported_path(from).isEmpty()) {
-        return {false, "INVALID SOURCE FILENAME"};
-    }
-
-    if (!SPIFFS.rename(from, to)) {
-        return {false, "RENAME FAILED"};
+    if (operation.get_state() == TreeOperation::State::kFailed) {
+        return {false, operation.get_error()};
     }
 
     // As some FS (e.g. LittleFS) delete the parent folder when the last child has been removed,
     // return the path of the closest parent still existing
+    remove_trailing_slash(from);
     return {true, last_existing_parent(std::move(from))};
 }
 
 std::pair<bool, String>
 FS::remove(String const& path)
 {
-    delete_recursive(path);
+    TreeOperation operation{TreeOperation::Type::kDelete, path};
+    while (operation.step() == TreeOperation::State::kInProgress) {
+    }
+    if (operation.get_state() == TreeOperation::State::kFailed) {
+        return {false, operation.get_error()};
+    }
     return {true, last_existing_parent(path)};
 }
 
+std::pair<bool, String>
+FS::copy(String from, String to)
+{
+    TreeOperation operation{TreeOperation::Type::kCopy, std::move(from), to};
+    while (operation.step() == TreeOperation::State::kInProgress) {
+    }
+    if (operation.get_state() == TreeOperation::State::kFailed) {
+        return {false, operation.get_error()};
+    }
+    remove_trailing_slash(to);
+    return {true, parent_of(to)};
+}
+
+std::pair<bool, String>
+FS::replace(String const& from, String const& to)
+{
+    if (!is_valid_path(to)) {
+        return {false, "INVALID FINAL FILENAME"};
+    }
+    auto& index = get_index();
+    if (!backend.has_atomic_rename() && exists(to)) {
+        // File with the old content is missing for a moment
+        if (!backend.get_fs().remove(to)) {
+            return {false, "DELETE FAILED"};
+        }
+        index.remove(to);
+    }
+
+    size_t size{backend.get_fs().open(from, "r").size()};
+    if (!backend.get_fs().rename(from, to)) {
+        on_index_updated();
+        return {false, "RENAME FAILED"};
+    }
+    index.remove(from);
+    index.add_file(to, size);
+    on_index_updated();
+    return {true, parent_of(to)};
+}
+
+String
+FS::last_existing_parent(String path)
+{
+    while (!path.isEmpty() && !exists(path)) {
+        if (path.lastIndexOf('/') > 0) {
+            path = path.substring(0, path.lastIndexOf('/'));
+        }
+        else {
+            path.clear();  // No slash => the top folder does not exist
+        }
+    }
+    DEBUG_PRINTLN(String{"Last existing parent: '"} + path + "'");
+    return path;
+}
+
 File
 FS::open(String const& path, OpenMode mode)
 {
-    return SPIFFS.open(path, (mode == OpenMode::kWrite) ? "w" : "r");
+    if (mode == OpenMode::kRead) {
+        return backend.get_fs().open(path, "r");
+    }
+
+    auto& index = get_index();
+    File  file  = backend.get_fs().open(path, "w");
+    if (file) {
+        index.add_file(path, 0);  // File is created or truncated
+        is_write_pending = true;
+    }
+    return file;
 }
 
 size_t
 FS::write(File& file, uint8_t const* data, size_t size)
 {
-    return file.write(data, size);
+    size_t written{file.write(data, size)};
+    get_index().add_to_size(file.name(), written);
+    is_write_pending = true;
+    return written;
+}
+
+bool
+FS::seek(File& file, size_t position)
+{
+    return file.seek(position, fs::SeekSet);
 }
 
 size_t
 FS::total_bytes()
 {
-    return SPIFFS.totalBytes();
+    return backend.total_bytes();
 }
 
 size_t
 FS::used_bytes()
 {
-    return SPIFFS.usedBytes();
+    return backend.used_bytes();
+}
+
+uint32_t
+FS::get_external_change_count()
+{
+    return num_of_external_changes;
 }
 
 bool
@@ -306,35 +402,395 @@ FS::is_file(String const& path)
     return (get_entry_type(path) == FS::EntryType::kFile);
 }
 
+size_t
+FS::get_file_size(String const& path)
+{
+    EntryType type;
+    size_t    size;
+    auto      result = get_index().find(path, type, size);
+    if (result == PathIndex::Result::kFound) {
+        return (type == EntryType::kFile) ? size : 0;
+    }
+    if (result == PathIndex::Result::kNotFound) {
+        return 0;
+    }
+
+    struct stat _stat;
+    String      fullPath{String{backend.get_mount_point()} + path};
+    if (stat(fullPath.c_str(), &_stat) || !S_ISREG(_stat.st_mode)) {
+        return 0;
+    }
+    return _stat.st_size;
+}
+
 FS::EntryType
 FS::get_entry_type(String const& path)
 {
-    struct stat _stat;
-    String      fullPath{kSpiffsMountingPoint + path};
-    if (!stat(fullPath.c_str(), &_stat)) {
-        // File found
-        if (S_ISREG(_stat.st_mode)) {
-            // Looks like regular file. But try to open it
-            FILE* file = fopen(fullPath.c_str(), "r");
-            if (!file) {
-                return FS::EntryType::kUnknown;
-            }
-            fclose(file);
-            return FS::EntryType::kFile;
+    EntryType type;
+    size_t    size;
+    switch (get_index().find(path, type, size)) {
+    case PathIndex::Result::kFound:
+        return type;
+    case PathIndex::Result::kNotFound:
+        return EntryType::kUnknown;
+    case PathIndex::Result::kAmbiguous:
+    default:
+        return read_entry_type(path);
+    }
+}
+
+constexpr size_t FS::FileList::kMaxNameLength;
+
+FS::FileList::FileList(String const& path)
+{
+    File root = open(path, OpenMode::kRead);
+    while (File file = root.openNextFile()) {
+        String error{check_for_unsupported_path(file.name())};
+        if (!error.isEmpty()) {
+            DEBUG_PRINTLN(String{"Ignoring "} + file.name() + ": " + error);
+            continue;
         }
-        else if (S_ISDIR(_stat.st_mode)) {
-            // Directory or non-existing item (on SPIFFS)
-            return is_real_SPIFFS_dir(fullPath) ? FS::EntryType::kDirectory : FS::EntryType::kUnknown;
+
+        // Always return names without leading "/"
+        char const* name{file.name()};
+        if (name[0] == '/') {
+            ++name;
         }
-        else {
-            // Unknown type
-            return FS::EntryType::kUnknown;
+        size_t name_length{strlen(name)};
+        if (name_length > kMaxNameLength) {
+            DEBUG_PRINTLN(String{"Ignoring "} + file.name() + ": !TOO_LONG_NAME!");
+            continue;
+        }
+
+        // There are no directories on SPIFFS, but there are on other backends
+        entries_.push_back(Entry{static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(file.size()),
+                                 FS::is_directory(file.name())});
+        names_.insert(names_.end(), name, name + name_length + 1);
+    }
+
+    char const* names{names_.data()};
+    std::sort(entries_.begin(), entries_.end(), [names](Entry const& l, Entry const& r) {
+        if (l.is_directory != r.is_directory) {
+            return l.is_directory;
         }
+        return strcasecmp(names + l.name_offset, names + r.name_offset) < 0;
+    });
+}
+
+size_t
+FS::FileList::read(char* buffer, size_t size)
+{
+    size_t result{0};
+    while (result < size) {
+        if ((part_offset_ == part_size_) && !format_next_part()) {
+            break;
+        }
+        size_t part_size{std::min(part_size_ - part_offset_, size - result)};
+        memcpy(buffer + result, part_ + part_offset_, part_size);
+        part_offset_ += part_size;
+        result += part_size;
+    }
+    return result;
+}
+
+bool
+FS::FileList::format_next_part()
+{
+    int size;
+    if (!is_started_) {
+        is_started_ = true;
+        size        = snprintf(part_, sizeof(part_), "[");
+    }
+    else if (next_entry_ < entries_.size()) {
+        auto const& entry = entries_[next_entry_];
+        char const* separator{(next_entry_ == 0) ? "" : ","};
+        char const* name{names_.data() + entry.name_offset};
+        size = entry.is_directory
+                   ? snprintf(part_, sizeof(part_), "%s{\"type\":\"dir\",\"name\":\"%s\"}", separator, name)
+                   : snprintf(part_, sizeof(part_), "%s{\"type\":\"file\",\"size\":\"%lu\",\"name\":\"%s\"}",
+                              separator, (unsigned long)entry.size, name);
+        ++next_entry_;
+    }
+    else if (!is_finished_) {
+        is_finished_ = true;
+        size         = snprintf(part_, sizeof(part_), "]");
     }
     else {
-        // File not found. Try to open as directory
-        return is_real_SPIFFS_dir(fullPath) ? FS::EntryType::kDirectory : FS::EntryType::kUnknown;
+        return false;
     }
+    part_size_   = size;
+    part_offset_ = 0;
+    return true;
+}
+
+constexpr size_t FS::TreeOperation::kMaxDepth;
+
+FS::TreeOperation::TreeOperation(Type type, String from, String to)
+  : type_{type}
+  , from_{std::move(from)}
+  , to_{std::move(to)}
+{
+}
+
+FS::TreeOperation::~TreeOperation()
+{
+    if (state_ == State::kInProgress) {
+        finish(State::kFailed, "CANCELLED");
+    }
+}
+
+FS::TreeOperation::State
+FS::TreeOperation::step()
+{
+    if (state_ != State::kInProgress) {
+        return state_;
+    }
+    if (!is_started_) {
+        start();
+        return state_;
+    }
+    if (copy_source_) {
+        copy_next_block();
+        return state_;
+    }
+    if (depth_ == 0) {
+        finish(State::kDone);
+        return state_;
+    }
+
+    auto& frame = stack_[depth_ - 1];
+    File  entry = frame.dir.openNextFile();
+    if (!entry) {
+        if (frame.num_of_changes > 0) {
+            // Some entries may be skipped, if directory is changed while it is being read. Read it again
+            frame.num_of_changes = 0;
+            frame.dir.rewindDirectory();
+            return state_;
+        }
+        leave_directory();
+        return state_;
+    }
+
+    // Names of nested entries are full paths
+    String path{entry.name()};
+    if (entry.isDirectory()) {
+        entry.close();
+        enter_directory(path);
+    }
+    else {
+        process_file(entry, path);
+    }
+    return state_;
+}
+
+FS::TreeOperation::State
+FS::TreeOperation::run_for(unsigned long budget_ms)
+{
+    unsigned long start_ms{millis()};
+    while ((step() == State::kInProgress) && (millis() - start_ms < budget_ms)) {
+    }
+    return state_;
+}
+
+FS::TreeOperation::State
+FS::TreeOperation::get_state() const
+{
+    return state_;
+}
+
+String const&
+FS::TreeOperation::get_error() const
+{
+    return error_;
+}
+
+String
+FS::TreeOperation::get_progress_json() const
+{
+    static char const* const kTypes[]{"delete", "move", "copy"};
+    static char const* const kStates[]{"in_progress", "done", "failed"};
+    return String{"{\"type\":\""} + kTypes[static_cast<size_t>(type_)] + "\",\"state\":\"" +
+           kStates[static_cast<size_t>(state_)] + "\",\"entries\":\"" + String{processed_entries_} +
+           "\",\"bytes\":\"" + String{processed_bytes_} + "\",\"error\":\"" + error_ + "\"}";
+}
+
+void
+FS::TreeOperation::start()
+{
+    is_started_ = true;
+    ++num_of_running_tree_operations;
+    get_index();  // Make sure index is up to date before it is changed
+
+    remove_trailing_slash(from_);
+    remove_trailing_slash(to_);
+    if ((from_ == "/") || !check_for_unsupported_path(from_).isEmpty()) {
+        return finish(State::kFailed, "INVALID SOURCE FILENAME");
+    }
+    auto type = get_entry_type(from_);
+    if (type == EntryType::kUnknown) {
+        return finish(State::kFailed, "SOURCE NOT FOUND");
+    }
+    if (type_ != Type::kDelete) {
+        if ((to_ == "/") || !check_for_unsupported_path(to_).isEmpty()) {
+            return finish(State::kFailed, "INVALID FINAL FILENAME");
+        }
+        if (exists(to_)) {
+            return finish(State::kFailed, "DESTINATION EXISTS");
+        }
+        if (to_.startsWith(from_ + "/")) {
+            return finish(State::kFailed, "DESTINATION IS INSIDE SOURCE");
+        }
+    }
+
+    if (type == EntryType::kFile) {
+        File file{backend.get_fs().open(from_, "r")};
+        process_file(file, from_);
+    }
+    else if ((type_ == Type::kMove) && backend.has_real_directories()) {
+        if (!backend.get_fs().rename(from_, to_)) {
+            return finish(State::kFailed, "RENAME FAILED");
+        }
+        is_reindexing_ = true;
+        enter_directory(to_);
+    }
+    else {
+        enter_directory(from_);
+    }
+}
+
+void
+FS::TreeOperation::enter_directory(String const& path)
+{
+    if (depth_ == kMaxDepth) {
+        return finish(State::kFailed, "TOO DEEP FOLDER");
+    }
+    if (is_reindexing_) {
+        path_index.add_directory(path);
+    }
+    else if ((type_ == Type::kCopy) && backend.has_real_directories()) {
+        String destination{get_destination(path)};
+        if (!backend.get_fs().mkdir(destination)) {
+            return finish(State::kFailed, "MKDIR FAILED");
+        }
+        path_index.add_directory(destination);
+    }
+
+    stack_[depth_++] = Frame{backend.get_fs().open(path, "r"), 0};
+}
+
+void
+FS::TreeOperation::leave_directory()
+{
+    auto&  frame = stack_[--depth_];
+    String path{frame.dir.name()};
+    frame.dir.close();
+    ++processed_entries_;
+
+    if (is_reindexing_) {
+        path_index.remove(get_source(path));
+    }
+    else if ((type_ == Type::kDelete) && backend.has_real_directories()) {
+        if (!backend.get_fs().rmdir(path)) {
+            return finish(State::kFailed, "DELETE FAILED");
+        }
+        path_index.remove(path);
+        if (depth_ > 0) {
+            ++stack_[depth_ - 1].num_of_changes;
+        }
+    }
+    // Directories of SPIFFS disappear from index together with their last file
+}
+
+void
+FS::TreeOperation::process_file(File& file, String const& path)
+{
+    size_t size{file.size()};
+    if (is_reindexing_) {
+        path_index.remove(get_source(path));
+        path_index.add_file(path, size);
+    }
+    else if (type_ == Type::kCopy) {
+        copy_destination_path_ = get_destination(path);
+        copy_destination_      = backend.get_fs().open(copy_destination_path_, "w");
+        if (!copy_destination_) {
+            return finish(State::kFailed, "CREATE FILE FAILED");
+        }
+        path_index.add_file(copy_destination_path_, 0);
+        copy_source_ = file;
+        return;  // Counted, when the last block is copied
+    }
+    else {
+        file.close();  // Opened file may be not removable
+        if (type_ == Type::kDelete) {
+            if (!backend.get_fs().remove(path)) {
+                return finish(State::kFailed, "DELETE FAILED");
+            }
+            path_index.remove(path);
+        }
+        else {
+            String destination{get_destination(path)};
+            if (!backend.get_fs().rename(path, destination)) {
+                return finish(State::kFailed, "RENAME FAILED");
+            }
+            path_index.remove(path);
+            path_index.add_file(destination, size);
+        }
+        if (depth_ > 0) {
+            ++stack_[depth_ - 1].num_of_changes;
+        }
+    }
+    ++processed_entries_;
+    processed_bytes_ += size;
+}
+
+void
+FS::TreeOperation::copy_next_block()
+{
+    uint8_t buffer[512];
+    size_t  size{copy_source_.read(buffer, sizeof(buffer))};
+    if (size > 0) {
+        if (copy_destination_.write(buffer, size) != size) {
+            return finish(State::kFailed, "WRITE FAILED");
+        }
+        path_index.add_to_size(copy_destination_path_, size);
+        processed_bytes_ += size;
+        return;
+    }
+
+    copy_source_.close();
+    copy_destination_.close();
+    ++processed_entries_;
+}
+
+void
+FS::TreeOperation::finish(State state, String const& error)
+{
+    copy_source_.close();
+    copy_destination_.close();
+    while (depth_ > 0) {
+        stack_[--depth_].dir.close();
+    }
+    if (is_started_) {
+        --num_of_running_tree_operations;
+        on_index_updated();
+    }
+    state_ = state;
+    error_ = error;
+    if (state == State::kFailed) {
+        DEBUG_PRINTLN(String{"ERROR: operation on "} + from_ + " failed: " + error);
+    }
+}
+
+String
+FS::TreeOperation::get_source(String const& path) const
+{
+    return from_ + path.substring(to_.length());
+}
+
+String
+FS::TreeOperation::get_destination(String const& path) const
+{
+    return to_ + path.substring(from_.length());
 }
 
 }  // namespace Utils
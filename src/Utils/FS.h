@@ -1,7 +1,9 @@
 #ifndef SRC_UTILS_FS_H_
 #define SRC_UTILS_FS_H_
 
+#include <array>
 #include <utility>
+#include <vector>
 
 #include <FS.h>
 #include <WString.h>
@@ -23,23 +25,146 @@ public:
         kUnknown
     };
     using File = fs::File;
+    class FileList;
+    class TreeOperation;
 
+    // Mount FS and build index of its entries (see PathIndex.h)
+    static bool                    begin();
     static bool                    exists(String const& path);
-    static String                  get_file_list_json(String const& path);
+    // Path starts with "/", has no empty names of folders and does not end with "/"
+    static bool                    is_valid_path(String const& path);
     static std::pair<File, String> create_file(String path);
     static std::pair<bool, String> create_folder(String path);
     static void                    close(File& file);
+    // Rename, remove and copy work with entire directories. They block till the end of operation, use TreeOperation to
+    // do it by steps
     static std::pair<bool, String> rename(String from, String to);
     static std::pair<bool, String> remove(String const& path);
+    static std::pair<bool, String> copy(String from, String to);
+    // Rename file "from" to "to", replacing existing file. Replacement is atomic, if backend supports it
+    static std::pair<bool, String> replace(String const& from, String const& to);
+    // Return path itself or its closest existing parent (empty string for root). Some FS (e.g. LittleFS, SPIFFS) delete
+    // folder, when its last child is removed
+    static String                  last_existing_parent(String path);
     static File                    open(String const& path, OpenMode mode = OpenMode::kRead);
     static size_t                  write(File& file, uint8_t const* data, size_t size);
+    static bool                    seek(File& file, size_t position);
     static size_t                  total_bytes();
     static size_t                  used_bytes();
+    // Number of detected changes of FS, made bypassing Utils::FS (ex. by FTP server). Any file could be changed then.
+    // FS is checked for such changes, when index of entries is used (ex. by exists() or get_file_size())
+    static uint32_t                get_external_change_count();
     static bool                    is_directory(String const& path);
     static bool                    is_file(String const& path);
+    // Does not open file. Return 0 if file does not exist
+    static size_t                  get_file_size(String const& path);
     static EntryType               get_entry_type(String const& path);
 };
 
+// Directory listing in JSON: [{"type":"file","size":"123","name":"dir/file.txt"},...]. Directories go first, names are
+// sorted case-insensitively. Names are read and sorted at construction, all of them are kept in single buffer. JSON is
+// produced by parts, while it is being sent, so it never exists in RAM entirely
+class FS::FileList
+{
+public:
+    explicit FileList(String const& path);
+
+    // Write the next part of JSON to buffer. Return number of written bytes, 0 at the end
+    size_t read(char* buffer, size_t size);
+
+private:
+    struct Entry
+    {
+        uint32_t name_offset;  // Offset of null-terminated name in names_
+        uint32_t size;
+        bool     is_directory;
+    };
+
+    bool format_next_part();
+
+    static constexpr size_t kMaxNameLength{255};
+
+    std::vector<char>  names_;
+    std::vector<Entry> entries_;
+    size_t             next_entry_{0};
+    bool               is_started_{false};
+    bool               is_finished_{false};
+    char               part_[kMaxNameLength + 64];  // JSON of single entry
+    size_t             part_size_{0};
+    size_t             part_offset_{0};
+};
+
+// Delete, move or copy of file or directory with all its content. Directories are walked without recursion: opened
+// directories are kept in stack of fixed depth, so deep tree can not overflow stack of task. Work is done by small
+// steps (one entry or one block of copied file), so long operation can be spread over several calls of loop().
+// On backends with real directories directory is moved by single rename, then only index of entries is updated by
+// steps. On SPIFFS every file of directory is renamed.
+class FS::TreeOperation
+{
+public:
+    enum class Type : uint8_t
+    {
+        kDelete = 0,
+        kMove,
+        kCopy
+    };
+    enum class State : uint8_t
+    {
+        kInProgress = 0,
+        kDone,
+        kFailed
+    };
+
+    static constexpr size_t kMaxDepth{16};
+
+    // "to" is not used by delete
+    TreeOperation(Type type, String from, String to = String{});
+    TreeOperation(TreeOperation const&) = delete;
+    TreeOperation& operator=(TreeOperation const&) = delete;
+    ~TreeOperation();
+
+    // Process the next entry or the next block of copied file
+    State step();
+    // Do steps till the end of operation or till time budget is over
+    State run_for(unsigned long budget_ms);
+
+    State         get_state() const;
+    String const& get_error() const;
+    // {"type":"delete","state":"in_progress","entries":"12","bytes":"3456","error":""}
+    String        get_progress_json() const;
+
+private:
+    struct Frame
+    {
+        File     dir;
+        uint32_t num_of_changes;  // Entries, removed from directory while it is being read
+    };
+
+    void   start();
+    void   enter_directory(String const& path);
+    void   leave_directory();
+    void   process_file(File& file, String const& path);
+    void   copy_next_block();
+    void   finish(State state, String const& error = String{});
+    String get_source(String const& path) const;
+    String get_destination(String const& path) const;
+
+    Type                         type_;
+    String                       from_;
+    String                       to_;
+    State                        state_{State::kInProgress};
+    String                       error_;
+    bool                         is_started_{false};
+    bool                         is_reindexing_{false};  // Directory is already moved, index is updated
+    std::array<Frame, kMaxDepth> stack_;
+    size_t                       depth_{0};
+    File                         copy_source_;
+    File                         copy_destination_;
+    String                       copy_destination_path_;
+    uint32_t                     processed_entries_{0};
+    size_t                       processed_bytes_{0};
+};
+
 }  // namespace Utils
 
 #endif  // SRC_UTILS_FS_H_
@@ -0,0 +1,389 @@
+#include "FirmwareUpdater.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <Update.h>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr uint8_t kRawImageMagic{0xE9};
+constexpr uint8_t kGzipMagic[]{0x1F, 0x8B};
+constexpr uint8_t kGzipDeflate{8};
+constexpr size_t  kGzipHeaderSize{10};
+constexpr size_t  kGzipTrailerSize{8};  // CRC32 and size of raw data
+constexpr uint8_t kGzipFlagHeaderCrc{0x02};
+constexpr uint8_t kGzipFlagExtra{0x04};
+constexpr uint8_t kGzipFlagName{0x08};
+constexpr uint8_t kGzipFlagComment{0x10};
+constexpr size_t  kWindowSize{TINFL_LZ_DICT_SIZE};
+
+int
+hex_to_int(char c)
+{
+    if ((c >= '0') && (c <= '9')) {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f')) {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F')) {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+uint32_t
+read_uint32_le(uint8_t const* data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+           (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+}  // namespace
+
+namespace Utils
+{
+constexpr size_t FirmwareUpdater::kSha256Size;
+
+FirmwareUpdater::~FirmwareUpdater()
+{
+    abort();
+}
+
+String
+FirmwareUpdater::begin(size_t size, String const& expected_sha256)
+{
+    abort();
+
+    is_sha256_checked_ = !expected_sha256.isEmpty();
+    if (is_sha256_checked_) {
+        if (expected_sha256.length() != kSha256Size * 2) {
+            return "ERROR: SHA-256 should be 64 hex digits";
+        }
+        for (size_t i = 0; i < kSha256Size; ++i) {
+            int high{hex_to_int(expected_sha256[i * 2])};
+            int low{hex_to_int(expected_sha256[i * 2 + 1])};
+            if ((high < 0) || (low < 0)) {
+                return "ERROR: SHA-256 should be 64 hex digits";
+            }
+            expected_sha256_[i] = static_cast<uint8_t>((high << 4) | low);
+        }
+    }
+
+    // Update is started by the first byte of content, when its format is known
+    is_active_   = true;
+    compression_ = Compression::kUnknown;
+    content_     = Content::kUnknown;
+    size_        = size;
+    image_size_  = 0;
+    mbedtls_sha256_init(&sha256_);
+    mbedtls_sha256_starts_ret(&sha256_, 0);
+    return String{};
+}
+
+String
+FirmwareUpdater::write(uint8_t const* data, size_t size)
+{
+    if (!is_active_) {
+        return "ERROR: update is not started";
+    }
+    if (size == 0) {
+        return String{};
+    }
+
+    if (compression_ == Compression::kUnknown) {
+        String error{start_decompression(data[0])};
+        if (!error.isEmpty()) {
+            abort();
+            return error;
+        }
+    }
+
+    String error{(compression_ == Compression::kNone) ? write_content(data, size) : write_gzip(data, size)};
+    if (!error.isEmpty()) {
+        abort();
+    }
+    return error;
+}
+
+String
+FirmwareUpdater::end()
+{
+    if (!is_active_) {
+        return "ERROR: update is not started";
+    }
+    if ((content_ == Content::kUnknown) ||
+        ((compression_ == Compression::kGzip) && (gzip_state_ != GzipState::kDone)) ||
+        ((content_ == Content::kDelta) && !delta_patcher_.is_finished())) {
+        abort();
+        return "ERROR: image is not complete";
+    }
+
+    std::array<uint8_t, kSha256Size> sha256;
+    mbedtls_sha256_finish_ret(&sha256_, sha256.data());
+    if ((is_sha256_checked_ && (sha256 != expected_sha256_)) ||
+        ((content_ == Content::kDelta) && (sha256 != delta_patcher_.get_target_sha256()))) {
+        abort();
+        return "ERROR: SHA-256 of image does not match";
+    }
+
+    // Update checks image itself and switches boot partition
+    bool is_finished{Update.end(true)};  // true to set the size to the current progress
+    release();
+    if (!is_finished) {
+        Update.printError(DGB_STREAM);
+        return String{"ERROR: can not finalize file! Update error "} + String(Update.getError());
+    }
+    DEBUG_PRINTLN(String{"Update completed. Image size: "} + String(image_size_));
+    return String{};
+}
+
+void
+FirmwareUpdater::abort()
+{
+    if (!is_active_) {
+        return;
+    }
+    if (content_ != Content::kUnknown) {
+        Update.abort();
+    }
+    release();
+}
+
+bool
+FirmwareUpdater::is_active() const
+{
+    return is_active_;
+}
+
+size_t
+FirmwareUpdater::get_image_size() const
+{
+    return image_size_;
+}
+
+String
+FirmwareUpdater::start_decompression(uint8_t first_byte)
+{
+    if (first_byte != kGzipMagic[0]) {
+        compression_ = Compression::kNone;
+        return String{};
+    }
+
+    compression_ = Compression::kGzip;
+    inflater_    = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+    window_      = static_cast<uint8_t*>(malloc(kWindowSize));
+    if ((inflater_ == nullptr) || (window_ == nullptr)) {
+        return "ERROR: not enough memory to decompress image";
+    }
+    gzip_state_               = GzipState::kHeader;
+    num_of_gzip_fields_bytes_ = 0;
+    window_offset_            = 0;
+    decompressed_size_        = 0;
+    return String{};
+}
+
+String
+FirmwareUpdater::start_update(uint8_t first_byte)
+{
+    size_t image_size{UPDATE_SIZE_UNKNOWN};
+    if (first_byte == kRawImageMagic) {
+        if ((compression_ == Compression::kNone) && (size_ != 0)) {
+            image_size = size_;
+        }
+        content_ = Content::kImage;
+    }
+    else if (first_byte == DeltaPatcher::kMagic[0]) {
+        delta_patcher_.begin([this](uint8_t const* data, size_t size) { return write_image(data, size); });
+        content_ = Content::kDelta;
+    }
+    else {
+        return "ERROR: unknown format of image";
+    }
+
+    if (!Update.begin(image_size)) {
+        Update.printError(DGB_STREAM);
+        content_ = Content::kUnknown;  // Nothing to abort
+        return "ERROR: not enough space! Available: " + String(ESP.getFreeSketchSpace());
+    }
+    return String{};
+}
+
+String
+FirmwareUpdater::write_content(uint8_t const* data, size_t size)
+{
+    if (content_ == Content::kUnknown) {
+        String error{start_update(data[0])};
+        if (!error.isEmpty()) {
+            return error;
+        }
+    }
+    return (content_ == Content::kImage) ? write_image(data, size) : delta_patcher_.write(data, size);
+}
+
+String
+FirmwareUpdater::write_image(uint8_t const* data, size_t size)
+{
+    if (Update.write(const_cast<uint8_t*>(data), size) != size) {
+        Update.printError(DGB_STREAM);
+        return String{"ERROR: can not write file! Update error "} + String(Update.getError());
+    }
+    mbedtls_sha256_update_ret(&sha256_, data, size);
+    image_size_ += size;
+    return String{};
+}
+
+String
+FirmwareUpdater::write_gzip(uint8_t const* data, size_t size)
+{
+    while (size > 0) {
+        if (gzip_state_ == GzipState::kData) {
+            String error{inflate(data, size)};
+            if (!error.isEmpty()) {
+                return error;
+            }
+            continue;
+        }
+        String error{parse_gzip_byte(*data)};
+        if (!error.isEmpty()) {
+            return error;
+        }
+        ++data;
+        --size;
+    }
+    return String{};
+}
+
+// Header and trailer are parsed byte by byte, because they can be split between parts of image
+String
+FirmwareUpdater::parse_gzip_byte(uint8_t byte)
+{
+    switch (gzip_state_) {
+    case GzipState::kHeader:
+        gzip_fields_[num_of_gzip_fields_bytes_++] = byte;
+        if (num_of_gzip_fields_bytes_ == kGzipHeaderSize) {
+            if ((gzip_fields_[0] != kGzipMagic[0]) || (gzip_fields_[1] != kGzipMagic[1]) ||
+                (gzip_fields_[2] != kGzipDeflate)) {
+                return "ERROR: unsupported compression of image";
+            }
+            gzip_flags_ = gzip_fields_[3];
+            next_gzip_state();
+        }
+        break;
+    case GzipState::kExtraLength:
+        gzip_fields_[num_of_gzip_fields_bytes_++] = byte;
+        if (num_of_gzip_fields_bytes_ == 2) {
+            skip_size_  = gzip_fields_[0] | (gzip_fields_[1] << 8);
+            gzip_state_ = GzipState::kSkip;
+            if (skip_size_ == 0) {
+                next_gzip_state();
+            }
+        }
+        break;
+    case GzipState::kSkip:
+        if (--skip_size_ == 0) {
+            next_gzip_state();
+        }
+        break;
+    case GzipState::kString:
+        if (byte == '\0') {
+            next_gzip_state();
+        }
+        break;
+    case GzipState::kTrailer:
+        gzip_fields_[num_of_gzip_fields_bytes_++] = byte;
+        if (num_of_gzip_fields_bytes_ == kGzipTrailerSize) {
+            // Data is checked by SHA-256 and by Update, so only size is checked here
+            if (read_uint32_le(&gzip_fields_[4]) != static_cast<uint32_t>(decompressed_size_)) {
+                return "ERROR: size of decompressed image is wrong";
+            }
+            gzip_state_ = GzipState::kDone;
+        }
+        break;
+    case GzipState::kDone:
+        return "ERROR: unexpected data after compressed image";
+    default:
+        break;
+    }
+    return String{};
+}
+
+// Decompress as much data as possible. Output goes to circular window, which is flushed after every call of inflater
+String
+FirmwareUpdater::inflate(uint8_t const*& data, size_t& size)
+{
+    for (;;) {
+        size_t in_size{size};
+        size_t out_size{kWindowSize - window_offset_};
+        auto   status = tinfl_decompress(
+            inflater_, data, &in_size, window_, window_ + window_offset_, &out_size, TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_size;
+        size -= in_size;
+
+        if (out_size > 0) {
+            decompressed_size_ += out_size;
+            String error{write_content(window_ + window_offset_, out_size)};
+            if (!error.isEmpty()) {
+                return error;
+            }
+            window_offset_ = (window_offset_ + out_size) & (kWindowSize - 1);
+        }
+
+        if (status == TINFL_STATUS_DONE) {
+            gzip_state_               = GzipState::kTrailer;
+            num_of_gzip_fields_bytes_ = 0;
+            return String{};
+        }
+        if (status < 0) {
+            return "ERROR: compressed image is corrupted";
+        }
+        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            return String{};  // All input is consumed
+        }
+        // TINFL_STATUS_HAS_MORE_OUTPUT: window is full, continue from its beginning
+    }
+}
+
+// Optional fields of header go in order of their flags
+void
+FirmwareUpdater::next_gzip_state()
+{
+    num_of_gzip_fields_bytes_ = 0;
+    if ((gzip_flags_ & kGzipFlagExtra) != 0) {
+        gzip_flags_ &= ~kGzipFlagExtra;
+        gzip_state_ = GzipState::kExtraLength;
+    }
+    else if ((gzip_flags_ & kGzipFlagName) != 0) {
+        gzip_flags_ &= ~kGzipFlagName;
+        gzip_state_ = GzipState::kString;
+    }
+    else if ((gzip_flags_ & kGzipFlagComment) != 0) {
+        gzip_flags_ &= ~kGzipFlagComment;
+        gzip_state_ = GzipState::kString;
+    }
+    else if ((gzip_flags_ & kGzipFlagHeaderCrc) != 0) {
+        gzip_flags_ &= ~kGzipFlagHeaderCrc;
+        skip_size_  = 2;
+        gzip_state_ = GzipState::kSkip;
+    }
+    else {
+        tinfl_init(inflater_);
+        gzip_state_ = GzipState::kData;
+    }
+}
+
+void
+FirmwareUpdater::release()
+{
+    free(inflater_);
+    free(window_);
+    inflater_ = nullptr;
+    window_   = nullptr;
+    mbedtls_sha256_free(&sha256_);
+    is_active_ = false;
+}
+
+}  // namespace Utils
@@ -0,0 +1,103 @@
+#ifndef SRC_UTILS_FIRMWAREUPDATER_H_
+#define SRC_UTILS_FIRMWAREUPDATER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include <WString.h>
+#include <mbedtls/sha256.h>
+#include <rom/miniz.h>
+
+#include "DeltaPatcher.h"
+
+namespace Utils
+{
+// Writes firmware image, which comes by parts, to inactive OTA partition through Update.
+// Uploaded file can be compressed by gzip. Format is detected by the first byte: gzip file starts with 0x1F.
+// Compressed file is decompressed on the fly by inflater from ROM, only its window (32 kB) and state are kept in RAM.
+// Content of file is detected by the first byte as well: firmware image starts with 0xE9, delta patch to running
+// firmware starts with "S" (see DeltaPatcher.h).
+// SHA-256 of new firmware is calculated while it is written. If expected SHA-256 is provided, update is not finished
+// when they differ. SHA-256 of new firmware from delta patch is always checked.
+// Methods return error or empty string.
+class FirmwareUpdater
+{
+public:
+    static constexpr size_t kSha256Size{32};
+
+    FirmwareUpdater() = default;
+    FirmwareUpdater(FirmwareUpdater const&) = delete;
+    FirmwareUpdater& operator=(FirmwareUpdater const&) = delete;
+    ~FirmwareUpdater();
+
+    // size - size of image, if it is known, otherwise 0. It is not used for compressed file and delta.
+    // expected_sha256 - SHA-256 of new firmware in hex, or empty string if it is not checked
+    String begin(size_t size, String const& expected_sha256);
+    String write(uint8_t const* data, size_t size);
+    // Verify image and make it bootable
+    String end();
+    void   abort();
+    bool   is_active() const;
+    // Size of new firmware, written so far
+    size_t get_image_size() const;
+
+private:
+    enum class Compression : uint8_t
+    {
+        kUnknown = 0,  // The first byte is not received yet
+        kNone,
+        kGzip
+    };
+    enum class Content : uint8_t
+    {
+        kUnknown = 0,  // The first byte is not received yet
+        kImage,
+        kDelta
+    };
+    // Parts of gzip file (RFC 1952)
+    enum class GzipState : uint8_t
+    {
+        kHeader = 0,
+        kExtraLength,
+        kSkip,    // Skip skip_size_ bytes
+        kString,  // Skip null-terminated string
+        kData,
+        kTrailer,
+        kDone
+    };
+
+    String start_decompression(uint8_t first_byte);
+    String start_update(uint8_t first_byte);
+    String write_content(uint8_t const* data, size_t size);
+    String write_image(uint8_t const* data, size_t size);
+    String write_gzip(uint8_t const* data, size_t size);
+    String parse_gzip_byte(uint8_t byte);
+    String inflate(uint8_t const*& data, size_t& size);
+    void   next_gzip_state();
+    void   release();
+
+    bool                             is_active_{false};
+    Compression                      compression_{Compression::kUnknown};
+    Content                          content_{Content::kUnknown};
+    size_t                           size_{0};
+    size_t                           image_size_{0};
+    bool                             is_sha256_checked_{false};
+    std::array<uint8_t, kSha256Size> expected_sha256_{};
+    mbedtls_sha256_context           sha256_;
+    GzipState                        gzip_state_{GzipState::kHeader};
+    uint8_t                          gzip_flags_{0};
+    std::array<uint8_t, 10>          gzip_fields_{};  // Header or trailer, which is being received
+    size_t                           num_of_gzip_fields_bytes_{0};
+    size_t                           skip_size_{0};
+    tinfl_decompressor*              inflater_{nullptr};
+    uint8_t*                         window_{nullptr};
+    size_t                           window_offset_{0};
+    size_t                           decompressed_size_{0};
+    DeltaPatcher                     delta_patcher_;
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_FIRMWAREUPDATER_H_
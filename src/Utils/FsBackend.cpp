@@ -0,0 +1,249 @@
+#include "FsBackend.h"
+
+#if defined(FS_BACKEND_SPIFFS)
+#include <SPIFFS.h>
+#elif defined(FS_BACKEND_LITTLEFS)
+#include <LITTLEFS.h>
+#include "src/Utils/FsMigration.h"
+#elif defined(FS_BACKEND_POSIX)
+#include <sys/stat.h>
+
+#include <memory>
+
+#include "src/Utils/PosixFs.h"
+#endif
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+#if defined(FS_BACKEND_SPIFFS)
+class SpiffsBackend : public Utils::FsBackend
+{
+public:
+    char const* get_name() const override;
+    bool        begin() override;
+    fs::FS&     get_fs() override;
+    char const* get_mount_point() const override;
+    bool        has_real_directories() const override;
+    bool        has_atomic_rename() const override;
+    size_t      total_bytes() override;
+    size_t      used_bytes() override;
+};
+
+char const*
+SpiffsBackend::get_name() const
+{
+    return "SPIFFS";
+}
+
+bool
+SpiffsBackend::begin()
+{
+    return SPIFFS.begin();
+}
+
+fs::FS&
+SpiffsBackend::get_fs()
+{
+    return SPIFFS;
+}
+
+char const*
+SpiffsBackend::get_mount_point() const
+{
+    return "/spiffs";  // Check it in SPIFFS.h
+}
+
+bool
+SpiffsBackend::has_real_directories() const
+{
+    return false;
+}
+
+bool
+SpiffsBackend::has_atomic_rename() const
+{
+    return false;
+}
+
+size_t
+SpiffsBackend::total_bytes()
+{
+    return SPIFFS.totalBytes();
+}
+
+size_t
+SpiffsBackend::used_bytes()
+{
+    return SPIFFS.usedBytes();
+}
+
+using SelectedBackend = SpiffsBackend;
+
+#elif defined(FS_BACKEND_LITTLEFS)
+class LittleFsBackend : public Utils::FsBackend
+{
+public:
+    char const* get_name() const override;
+    bool        begin() override;
+    fs::FS&     get_fs() override;
+    char const* get_mount_point() const override;
+    bool        has_real_directories() const override;
+    bool        has_atomic_rename() const override;
+    size_t      total_bytes() override;
+    size_t      used_bytes() override;
+};
+
+char const*
+LittleFsBackend::get_name() const
+{
+    return "LittleFS";
+}
+
+bool
+LittleFsBackend::begin()
+{
+    // LittleFS can not be mounted at the first start after switching from SPIFFS, because partition is still formatted
+    // as SPIFFS. Migration formats it and moves files to LittleFS. Migration also finishes copying, which was
+    // interrupted by reset
+    if (Utils::FsMigration::is_needed() && !Utils::FsMigration::run()) {
+        // Do not format partition, files are still there
+        DEBUG_PRINTLN("ERROR: migration from SPIFFS to LittleFS failed");
+        return false;
+    }
+    return LITTLEFS.begin(true);
+}
+
+fs::FS&
+LittleFsBackend::get_fs()
+{
+    return LITTLEFS;
+}
+
+char const*
+LittleFsBackend::get_mount_point() const
+{
+    return "/littlefs";  // Check it in LITTLEFS.h
+}
+
+bool
+LittleFsBackend::has_real_directories() const
+{
+    return true;
+}
+
+bool
+LittleFsBackend::has_atomic_rename() const
+{
+    return true;
+}
+
+size_t
+LittleFsBackend::total_bytes()
+{
+    return LITTLEFS.totalBytes();
+}
+
+size_t
+LittleFsBackend::used_bytes()
+{
+    return LITTLEFS.usedBytes();
+}
+
+using SelectedBackend = LittleFsBackend;
+
+#elif defined(FS_BACKEND_POSIX)
+class PosixBackend : public Utils::FsBackend
+{
+public:
+    PosixBackend();
+
+    char const* get_name() const override;
+    bool        begin() override;
+    fs::FS&     get_fs() override;
+    char const* get_mount_point() const override;
+    bool        has_real_directories() const override;
+    bool        has_atomic_rename() const override;
+    size_t      total_bytes() override;
+    size_t      used_bytes() override;
+
+private:
+    std::shared_ptr<Utils::PosixFs> impl_;
+    fs::FS                          fs_;
+};
+
+PosixBackend::PosixBackend()
+  : impl_{std::make_shared<Utils::PosixFs>(FS_POSIX_ROOT)}
+  , fs_{impl_}
+{
+}
+
+char const*
+PosixBackend::get_name() const
+{
+    return "POSIX";
+}
+
+// Root directory is created, if it does not exist
+bool
+PosixBackend::begin()
+{
+    struct stat root_stat;
+    if (stat(FS_POSIX_ROOT, &root_stat) == 0) {
+        return S_ISDIR(root_stat.st_mode);
+    }
+    return mkdir(FS_POSIX_ROOT, 0755) == 0;
+}
+
+fs::FS&
+PosixBackend::get_fs()
+{
+    return fs_;
+}
+
+char const*
+PosixBackend::get_mount_point() const
+{
+    return FS_POSIX_ROOT;
+}
+
+bool
+PosixBackend::has_real_directories() const
+{
+    return true;
+}
+
+bool
+PosixBackend::has_atomic_rename() const
+{
+    return true;
+}
+
+size_t
+PosixBackend::total_bytes()
+{
+    return impl_->get_total_bytes();
+}
+
+size_t
+PosixBackend::used_bytes()
+{
+    return impl_->get_used_bytes();
+}
+
+using SelectedBackend = PosixBackend;
+#endif
+
+}  // namespace
+
+namespace Utils
+{
+FsBackend&
+FsBackend::instance()
+{
+    static SelectedBackend backend;
+    return backend;
+}
+
+}  // namespace Utils
@@ -0,0 +1,49 @@
+#ifndef SRC_UTILS_FSBACKEND_H_
+#define SRC_UTILS_FSBACKEND_H_
+
+#include <stddef.h>
+
+#include <FS.h>
+
+// Filesystem, on which Utils::FS works, is selected at build time
+#if !defined(FS_BACKEND_SPIFFS) && !defined(FS_BACKEND_LITTLEFS) && !defined(FS_BACKEND_POSIX)
+#define FS_BACKEND_SPIFFS
+// #define FS_BACKEND_LITTLEFS  // Needs LITTLEFS library (https://github.com/lorol/LITTLEFS)
+// #define FS_BACKEND_POSIX     // Directory of host, for host tests (see test/run_host_tests.sh)
+#endif
+
+#if defined(FS_BACKEND_POSIX) && !defined(FS_POSIX_ROOT)
+#define FS_POSIX_ROOT "fs_root"
+#endif
+
+namespace Utils
+{
+// Backend of Utils::FS. Files are accessed through fs::FS of backend, other features of filesystem, which Utils::FS
+// depends on, are described here.
+// - SPIFFS: flat namespace, directory is just prefix of paths of files, mkdir() does nothing.
+// - LittleFS: real directories. Uses the same "spiffs" partition. At first start content of SPIFFS is migrated to
+//   LittleFS (see FsMigration.h).
+// - POSIX: directory FS_POSIX_ROOT of host (see PosixFs.h). Real directories, atomic rename().
+class FsBackend
+{
+public:
+    virtual ~FsBackend() = default;
+
+    virtual char const* get_name() const = 0;
+    virtual bool        begin()          = 0;
+    virtual fs::FS&     get_fs()         = 0;
+    // VFS path, where filesystem is mounted, for POSIX calls (stat(), opendir(), etc.)
+    virtual char const* get_mount_point() const      = 0;
+    virtual bool        has_real_directories() const = 0;
+    // rename() replaces existing file atomically
+    virtual bool        has_atomic_rename() const = 0;
+    virtual size_t      total_bytes()             = 0;
+    virtual size_t      used_bytes()              = 0;
+
+    // Backend, selected at build time
+    static FsBackend& instance();
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_FSBACKEND_H_
@@ -0,0 +1,162 @@
+#include "FsBenchmark.h"
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <Arduino.h>
+
+#include "src/Utils/FsBackend.h"
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr char const* kTestPath{"/.fs_benchmark"};
+constexpr size_t      kFileSize{32 * 1024};
+constexpr size_t      kChunkSize{512};
+constexpr uint32_t    kNumOfRepeats{20};  // For open() and stat()
+constexpr uint8_t     kFillByte{0x5A};
+
+uint32_t
+to_kbytes_per_second(size_t size, unsigned long duration_us)
+{
+    return static_cast<uint64_t>(size) * 1000000 / 1024 / ((duration_us == 0) ? 1 : duration_us);
+}
+
+}  // namespace
+
+namespace Utils
+{
+FsBenchmark::FsBenchmark()
+{
+    unsigned long start{micros()};
+    file_ = FsBackend::instance().get_fs().open(kTestPath, "w");
+    write_us_ += micros() - start;
+    if (!file_) {
+        finish(State::kFailed, "CAN NOT CREATE FILE");
+    }
+}
+
+FsBenchmark::~FsBenchmark()
+{
+    if (stage_ != Stage::kFinished) {
+        finish(State::kFailed, "ABORTED");
+    }
+}
+
+FsBenchmark::State
+FsBenchmark::step()
+{
+    auto&   backend = FsBackend::instance();
+    uint8_t buffer[kChunkSize];
+
+    switch (stage_) {
+    case Stage::kWrite: {
+        memset(buffer, kFillByte, sizeof(buffer));
+        unsigned long start{micros()};
+        size_t        written{file_.write(buffer, kChunkSize)};
+        processed_bytes_ += written;
+        if (processed_bytes_ == kFileSize) {
+            file_.close();
+        }
+        write_us_ += micros() - start;
+        if (written != kChunkSize) {
+            finish(State::kFailed, "WRITE FAILED");
+        }
+        else if (processed_bytes_ == kFileSize) {
+            stage_ = Stage::kOpen;
+        }
+        break;
+    }
+    case Stage::kOpen: {
+        unsigned long start{micros()};
+        auto          file = backend.get_fs().open(kTestPath, "r");
+        file.close();
+        open_us_ += micros() - start;
+        if (++num_of_repeats_ == kNumOfRepeats) {
+            num_of_repeats_ = 0;
+            stage_          = Stage::kStat;
+        }
+        break;
+    }
+    case Stage::kStat: {
+        String        full_path{String{backend.get_mount_point()} + kTestPath};
+        struct stat   file_stat;
+        unsigned long start{micros()};
+        stat(full_path.c_str(), &file_stat);
+        stat_us_ += micros() - start;
+        if (++num_of_repeats_ == kNumOfRepeats) {
+            processed_bytes_ = 0;
+            stage_           = Stage::kRead;
+        }
+        break;
+    }
+    case Stage::kRead: {
+        unsigned long start{micros()};
+        if (processed_bytes_ == 0) {
+            file_ = backend.get_fs().open(kTestPath, "r");
+        }
+        size_t size{file_ ? file_.read(buffer, kChunkSize) : 0};
+        processed_bytes_ += size;
+        if ((size == 0) || (processed_bytes_ >= kFileSize)) {
+            file_.close();
+        }
+        read_us_ += micros() - start;
+        if (size == 0) {
+            finish(State::kFailed, "READ FAILED");
+        }
+        else if (processed_bytes_ >= kFileSize) {
+            finish(State::kDone, nullptr);
+        }
+        break;
+    }
+    case Stage::kFinished:
+        break;
+    }
+    return state_;
+}
+
+FsBenchmark::State
+FsBenchmark::get_state() const
+{
+    return state_;
+}
+
+String
+FsBenchmark::get_result_json() const
+{
+    if (state_ == State::kFailed) {
+        return String{"{\"state\":\"failed\",\"error\":\""} + error_ + "\"}";
+    }
+    if (state_ == State::kInProgress) {
+        // Write and read take the most of time, so progress is counted by them
+        size_t done_bytes{kFileSize / 2};
+        if (stage_ == Stage::kWrite) {
+            done_bytes = processed_bytes_ / 2;
+        }
+        else if (stage_ == Stage::kRead) {
+            done_bytes += processed_bytes_ / 2;
+        }
+        return String{"{\"state\":\"in_progress\",\"progress\":\""} + String{done_bytes * 100 / kFileSize} + "\"}";
+    }
+    return String{"{\"state\":\"done\",\"backend\":\""} + FsBackend::instance().get_name() + "\",\"open_us\":\"" +
+           String{open_us_ / kNumOfRepeats} + "\",\"stat_us\":\"" + String{stat_us_ / kNumOfRepeats} +
+           "\",\"write_kBps\":\"" + String{to_kbytes_per_second(kFileSize, write_us_)} + "\",\"read_kBps\":\"" +
+           String{to_kbytes_per_second(kFileSize, read_us_)} + "\"}";
+}
+
+void
+FsBenchmark::finish(State state, char const* error)
+{
+    if (file_) {
+        file_.close();
+    }
+    FsBackend::instance().get_fs().remove(kTestPath);
+    state_ = state;
+    stage_ = Stage::kFinished;
+    if (error != nullptr) {
+        error_ = error;
+    }
+    DEBUG_PRINTLN(String{"FS benchmark: "} + get_result_json());
+}
+
+}  // namespace Utils
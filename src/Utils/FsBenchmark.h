@@ -0,0 +1,65 @@
+#ifndef SRC_UTILS_FSBENCHMARK_H_
+#define SRC_UTILS_FSBENCHMARK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <FS.h>
+#include <WString.h>
+
+namespace Utils
+{
+// Speed of FS backend (see FsBackend.h): average time of open() and stat() of file, throughput of sequential write and
+// read of file. Temporary file is written right through backend, bypassing Utils::FS. To compare backends, build
+// firmware with each of them.
+//
+// Benchmark is done by steps: every step is single operation with FS (ex. write of one chunk), so it can be run from
+// loop() without blocking other work. Only time of operations themselves is measured, not time between steps.
+class FsBenchmark
+{
+public:
+    enum class State : uint8_t
+    {
+        kInProgress = 0,
+        kDone,
+        kFailed
+    };
+
+    FsBenchmark();
+    FsBenchmark(FsBenchmark const&) = delete;
+    FsBenchmark& operator=(FsBenchmark const&) = delete;
+    ~FsBenchmark();
+
+    State step();
+    State get_state() const;
+    // {"state":"in_progress","progress":"40"} while benchmark is running. When it is done:
+    // {"state":"done","backend":"SPIFFS","open_us":"1234","stat_us":"567","write_kBps":"89","read_kBps":"321"}
+    String get_result_json() const;
+
+private:
+    enum class Stage : uint8_t
+    {
+        kWrite = 0,
+        kOpen,
+        kStat,
+        kRead,
+        kFinished
+    };
+
+    void finish(State state, char const* error);
+
+    State         state_{State::kInProgress};
+    Stage         stage_{Stage::kWrite};
+    String        error_;
+    fs::File      file_;
+    size_t        processed_bytes_{0};
+    uint32_t      num_of_repeats_{0};
+    unsigned long write_us_{0};
+    unsigned long open_us_{0};
+    unsigned long stat_us_{0};
+    unsigned long read_us_{0};
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_FSBENCHMARK_H_
@@ -0,0 +1,294 @@
+#include "FsMigration.h"
+
+#include "FsBackend.h"
+
+#ifdef FS_BACKEND_LITTLEFS
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <LITTLEFS.h>
+#include <SPIFFS.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <rom/crc.h>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr uint32_t kMagic{0x474D4C53};  // "SLMG"
+constexpr size_t   kSectorSize{4096};
+constexpr size_t   kDataOffset{kSectorSize};
+constexpr size_t   kRecordHeaderSize{sizeof(uint16_t) + sizeof(uint32_t)};
+constexpr size_t   kMaxPathLength{255};
+constexpr size_t   kBufferSize{512};
+constexpr uint8_t  kNumOfVerifyAttempts{3};
+
+struct Header
+{
+    uint32_t magic;
+    uint32_t num_of_files;
+    uint32_t data_size;
+    uint32_t crc;
+};
+
+// Sequential access to data in staging partition
+struct StagingCursor
+{
+    esp_partition_t const* partition;
+    size_t                 offset;
+    uint32_t               crc;
+};
+
+bool
+write_staging(StagingCursor& cursor, void const* data, size_t size)
+{
+    if (esp_partition_write(cursor.partition, cursor.offset, data, size) != ESP_OK) {
+        return false;
+    }
+    cursor.offset += size;
+    cursor.crc = crc32_le(cursor.crc, static_cast<uint8_t const*>(data), size);
+    return true;
+}
+
+bool
+read_staging(StagingCursor& cursor, void* data, size_t size)
+{
+    if (esp_partition_read(cursor.partition, cursor.offset, data, size) != ESP_OK) {
+        return false;
+    }
+    cursor.offset += size;
+    cursor.crc = crc32_le(cursor.crc, static_cast<uint8_t const*>(data), size);
+    return true;
+}
+
+bool
+read_header(esp_partition_t const* partition, Header& header)
+{
+    if ((partition == nullptr) || (esp_partition_read(partition, 0, &header, sizeof(header)) != ESP_OK)) {
+        return false;
+    }
+    return (header.magic == kMagic) && (header.data_size <= partition->size - kDataOffset);
+}
+
+bool
+is_staging_valid(esp_partition_t const* partition, Header const& header)
+{
+    uint8_t       buffer[kBufferSize];
+    StagingCursor cursor{partition, kDataOffset, 0};
+    while (cursor.offset < kDataOffset + header.data_size) {
+        if (!read_staging(cursor, buffer, std::min(kBufferSize, kDataOffset + header.data_size - cursor.offset))) {
+            return false;
+        }
+    }
+    return cursor.crc == header.crc;
+}
+
+bool
+verify_staging(esp_partition_t const* partition, Header const& header)
+{
+    // Reading of flash can fail occasionally, so corruption is not concluded from single attempt
+    for (uint8_t attempt = 0; attempt < kNumOfVerifyAttempts; ++attempt) {
+        if (is_staging_valid(partition, header)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+is_spiffs_mountable()
+{
+    bool is_mounted{SPIFFS.begin(false)};
+    if (is_mounted) {
+        SPIFFS.end();
+    }
+    return is_mounted;
+}
+
+bool
+stage_file(StagingCursor& cursor, File& file)
+{
+    String   path{file.name()};
+    uint16_t path_length{static_cast<uint16_t>(path.length())};
+    uint32_t size{static_cast<uint32_t>(file.size())};
+    if (!write_staging(cursor, &path_length, sizeof(path_length)) || !write_staging(cursor, &size, sizeof(size)) ||
+        !write_staging(cursor, path.c_str(), path_length)) {
+        return false;
+    }
+
+    uint8_t buffer[kBufferSize];
+    while (size > 0) {
+        size_t chunk_size{file.read(buffer, std::min(kBufferSize, static_cast<size_t>(size)))};
+        if ((chunk_size == 0) || !write_staging(cursor, buffer, chunk_size)) {
+            return false;
+        }
+        size -= chunk_size;
+    }
+    return true;
+}
+
+bool
+stage_spiffs_files(esp_partition_t const* partition)
+{
+    if (!SPIFFS.begin(false)) {
+        return false;
+    }
+
+    // SPIFFS lists all files from root
+    size_t data_size{0};
+    File   root = SPIFFS.open("/", "r");
+    while (File file = root.openNextFile()) {
+        data_size += kRecordHeaderSize + strlen(file.name()) + file.size();
+    }
+    if (data_size > partition->size - kDataOffset) {
+        DEBUG_PRINTLN("ERROR: files of SPIFFS do not fit staging partition");
+        SPIFFS.end();
+        return false;
+    }
+    size_t erase_size{(kDataOffset + data_size + kSectorSize - 1) / kSectorSize * kSectorSize};
+    if (esp_partition_erase_range(partition, 0, erase_size) != ESP_OK) {
+        SPIFFS.end();
+        return false;
+    }
+
+    Header        header{kMagic, 0, 0, 0};
+    StagingCursor cursor{partition, kDataOffset, 0};
+    root = SPIFFS.open("/", "r");
+    while (File file = root.openNextFile()) {
+        if ((strlen(file.name()) > kMaxPathLength) || !stage_file(cursor, file)) {
+            DEBUG_PRINTLN(String{"ERROR: can not stage "} + file.name());
+            SPIFFS.end();
+            return false;
+        }
+        ++header.num_of_files;
+    }
+    SPIFFS.end();
+
+    // Header makes staged files valid, so it is written the last
+    header.data_size = cursor.offset - kDataOffset;
+    header.crc       = cursor.crc;
+    return esp_partition_write(partition, 0, &header, sizeof(header)) == ESP_OK;
+}
+
+// LittleFS has real directories, parents of file should be created before it
+void
+create_parent_dirs(String const& path)
+{
+    for (int slash = path.indexOf('/', 1); slash != -1; slash = path.indexOf('/', slash + 1)) {
+        LITTLEFS.mkdir(path.substring(0, slash));
+    }
+}
+
+bool
+restore_file(StagingCursor& cursor)
+{
+    uint16_t path_length;
+    uint32_t size;
+    char     path[kMaxPathLength + 1];
+    if (!read_staging(cursor, &path_length, sizeof(path_length)) || !read_staging(cursor, &size, sizeof(size)) ||
+        (path_length > kMaxPathLength) || !read_staging(cursor, path, path_length)) {
+        return false;
+    }
+    path[path_length] = '\0';
+
+    create_parent_dirs(path);
+    File file = LITTLEFS.open(path, "w");
+    if (!file) {
+        return false;
+    }
+    uint8_t buffer[kBufferSize];
+    while (size > 0) {
+        size_t chunk_size{std::min(kBufferSize, static_cast<size_t>(size))};
+        if (!read_staging(cursor, buffer, chunk_size) || (file.write(buffer, chunk_size) != chunk_size)) {
+            file.close();
+            return false;
+        }
+        size -= chunk_size;
+    }
+    file.close();
+    return true;
+}
+
+bool
+restore_files(esp_partition_t const* partition, Header const& header)
+{
+    // Partition is still formatted as SPIFFS, so mounting fails and partition is formatted
+    if (!LITTLEFS.begin(true)) {
+        return false;
+    }
+    StagingCursor cursor{partition, kDataOffset, 0};
+    for (uint32_t i = 0; i < header.num_of_files; ++i) {
+        if (!restore_file(cursor)) {
+            LITTLEFS.end();
+            return false;
+        }
+    }
+    LITTLEFS.end();
+    return true;
+}
+
+}  // namespace
+
+namespace Utils
+{
+bool
+FsMigration::is_needed()
+{
+    Header header;
+    if (read_header(esp_ota_get_next_update_partition(nullptr), header)) {
+        return true;  // Copying from staging partition was interrupted
+    }
+    if (LITTLEFS.begin(false)) {
+        LITTLEFS.end();
+        return false;
+    }
+    return is_spiffs_mountable();
+}
+
+bool
+FsMigration::run()
+{
+    auto const* partition = esp_ota_get_next_update_partition(nullptr);
+    if (partition == nullptr) {
+        DEBUG_PRINTLN("ERROR: there is no partition to stage files of SPIFFS");
+        return false;
+    }
+
+    Header header;
+    if (!read_header(partition, header)) {
+        DEBUG_PRINTLN("Migration from SPIFFS to LittleFS. Staging files");
+        if (!stage_spiffs_files(partition) || !read_header(partition, header)) {
+            return false;
+        }
+    }
+    if (!verify_staging(partition, header)) {
+        // Header is written after data, so it can happen only because of failure of flash
+        if (!is_spiffs_mountable()) {
+            // Partition is formatted already and staging partition keeps the only copy of files. Leave it as it is:
+            // migration is retried at the next start, files can still be read out of it even if some of them are broken
+            DEBUG_PRINTLN("ERROR: staged files are corrupted. They are kept for the next attempt of migration");
+            return false;
+        }
+        // SPIFFS is intact, so files are staged again
+        DEBUG_PRINTLN("ERROR: staged files are corrupted. Staging them again");
+        if (!stage_spiffs_files(partition) || !read_header(partition, header) || !verify_staging(partition, header)) {
+            return false;
+        }
+    }
+
+    DEBUG_PRINTLN("Migration from SPIFFS to LittleFS. Copying files");
+    if (!restore_files(partition, header)) {
+        return false;
+    }
+    esp_partition_erase_range(partition, 0, kSectorSize);
+    DEBUG_PRINTLN(String{"Migration from SPIFFS to LittleFS is finished. Files: "} + String{header.num_of_files});
+    return true;
+}
+
+}  // namespace Utils
+
+#endif  // FS_BACKEND_LITTLEFS
@@ -0,0 +1,31 @@
+#ifndef SRC_UTILS_FSMIGRATION_H_
+#define SRC_UTILS_FSMIGRATION_H_
+
+namespace Utils
+{
+// One-time migration of files in "spiffs" partition from SPIFFS to LittleFS (is used only by LittleFS backend).
+// Both filesystems live in the same partition, so files are staged in inactive OTA partition, which is overwritten by
+// the next OTA update anyway (firmware, which was running before the last update, is lost):
+// 1. all files of SPIFFS are written to staging partition, header of staging is written the last
+// 2. partition is formatted as LittleFS and files are copied from staging partition
+// 3. header of staging is erased
+// If reset happens at step 1, SPIFFS is still intact and migration is started from the beginning at the next start. If
+// it happens at step 2, files are copied from staging partition again. Staged files, which fail check of CRC, are
+// staged again while SPIFFS is intact. After formatting staging partition keeps the only copy of files, so it is never
+// erased till all files are copied.
+//
+// Staging partition (all numbers are little-endian):
+// - header (the first sector): magic "SLMG", number of files, size of data, CRC32 of data (4 bytes each)
+// - data (from the second sector): for every file length of path (2 bytes), size of content (4 bytes), path (without
+//   null-terminator) and content
+class FsMigration
+{
+public:
+    // Partition is formatted as SPIFFS or copying from staging partition was not finished
+    static bool is_needed();
+    static bool run();
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_FSMIGRATION_H_
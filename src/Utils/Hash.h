@@ -0,0 +1,22 @@
+#ifndef SRC_UTILS_HASH_H_
+#define SRC_UTILS_HASH_H_
+
+#include <stdint.h>
+
+namespace Utils
+{
+// 32-bit FNV-1a hash of null-terminated string. Asset pack keeps hashes of paths, calculated by
+// tools/pack_asset_image.py, so both implementations must give the same result
+inline uint32_t
+fnv1a_hash(char const* str)
+{
+    uint32_t hash{2166136261u};
+    while (*str != '\0') {
+        hash = (hash ^ static_cast<uint8_t>(*str++)) * 16777619u;
+    }
+    return hash;
+}
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_HASH_H_
@@ -0,0 +1,264 @@
+#include "OtaTask.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+
+#include "src/Utils/Logger.h"
+
+namespace
+{
+constexpr char        kHttpPrefix[]{"http://"};
+constexpr size_t      kHttpPrefixSize{sizeof(kHttpPrefix) - 1};
+constexpr size_t      kBufferSize{1460};  // TCP MSS. Head of HTTP response should fit it
+constexpr long        kSocketTimeoutS{10};
+constexpr uint32_t    kTaskStackSize{8192};
+constexpr UBaseType_t kTaskPriority{1};
+constexpr BaseType_t  kTaskCore{0};  // loop() runs on core 1, so light is controlled as usual during update
+
+char const*
+to_string(Utils::OtaTask::State state)
+{
+    switch (state) {
+    case Utils::OtaTask::State::kIdle:
+        return "idle";
+    case Utils::OtaTask::State::kInProgress:
+        return "in_progress";
+    case Utils::OtaTask::State::kDone:
+        return "done";
+    default:
+        return "failed";
+    }
+}
+
+// Error may contain path, URL or reply of mirror, so quotes, backslashes and control characters are escaped
+String
+escape_json(String const& text)
+{
+    String escaped;
+    escaped.reserve(text.length());
+    for (size_t i = 0; i < text.length(); ++i) {
+        char c{text[i]};
+        if ((c == '"') || (c == '\\')) {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<uint8_t>(c) < 0x20) {
+            char code[7];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+}  // namespace
+
+namespace Utils
+{
+String
+OtaTask::start(String const& source, String const& expected_sha256)
+{
+    if (state_ == State::kInProgress) {
+        return "ERROR: another update is in progress";
+    }
+    if (source.startsWith("/")) {
+        if (!FS::is_file(source)) {
+            return "ERROR: file is not found: " + source;
+        }
+        // FS is accessed only from main task, so file is opened here. Reading of opened file from another task is safe
+        file_ = FS::open(source);
+        if (!file_) {
+            return "ERROR: can not open " + source;
+        }
+    }
+    else if (!source.startsWith(kHttpPrefix)) {
+        return "ERROR: source should be path of file or http:// URL";
+    }
+
+    source_          = source;
+    expected_sha256_ = expected_sha256;
+    processed_bytes_ = 0;
+    total_bytes_     = file_ ? file_.size() : 0;
+    error_           = String{};
+    state_           = State::kInProgress;
+    DEBUG_PRINTLN(String{"Firmware update from "} + source_);
+    if (xTaskCreatePinnedToCore(task_main, "ota", kTaskStackSize, this, kTaskPriority, nullptr, kTaskCore) != pdPASS) {
+        file_.close();
+        state_ = State::kIdle;
+        return "ERROR: can not create update task";
+    }
+    return String{};
+}
+
+OtaTask::State
+OtaTask::get_state() const
+{
+    return state_;
+}
+
+String
+OtaTask::get_progress_json() const
+{
+    State state{state_};
+    return String{"{\"state\":\""} + to_string(state) + "\",\"bytes\":\"" + String(processed_bytes_) +
+           "\",\"total\":\"" + String(total_bytes_) + "\",\"error\":\"" +
+           ((state == State::kFailed) ? escape_json(error_) : String{}) + "\"}";
+}
+
+void
+OtaTask::run()
+{
+    String error{file_ ? read_file() : download()};
+    if (error.isEmpty()) {
+        error = updater_.end();
+    }
+    else {
+        updater_.abort();
+    }
+
+    if (error.isEmpty()) {
+        DEBUG_PRINTLN("Firmware update is finished");
+        state_ = State::kDone;
+    }
+    else {
+        DEBUG_PRINTLN(error);
+        error_ = error;
+        state_ = State::kFailed;
+    }
+}
+
+String
+OtaTask::read_file()
+{
+    String error{updater_.begin(file_.size(), expected_sha256_)};
+    uint8_t buffer[kBufferSize];
+    while (error.isEmpty() && (processed_bytes_ < total_bytes_)) {
+        size_t size{file_.read(buffer, sizeof(buffer))};
+        error = (size == 0) ? String{"ERROR: can not read "} + source_ : write(buffer, size);
+    }
+    file_.close();
+    return error;
+}
+
+// Mirror is plain HTTP server (ex. "python3 -m http.server"). HTTP/1.0 is used, so response is never chunked and its
+// end is closing of connection
+String
+OtaTask::download()
+{
+    String host_and_path{source_.substring(kHttpPrefixSize)};
+    int    slash{host_and_path.indexOf('/')};
+    String host{(slash < 0) ? host_and_path : host_and_path.substring(0, slash)};
+    String path{(slash < 0) ? String{"/"} : host_and_path.substring(slash)};
+    String port{"80"};
+    int    colon{host.indexOf(':')};
+    String request{String{"GET "} + path + " HTTP/1.0\r\nHost: " + host + "\r\nConnection: close\r\n\r\n"};
+    if (colon >= 0) {
+        port = host.substring(colon + 1);
+        host.remove(colon);
+    }
+
+    addrinfo  hints{};
+    addrinfo* address{nullptr};
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((getaddrinfo(host.c_str(), port.c_str(), &hints, &address) != 0) || (address == nullptr)) {
+        return "ERROR: can not resolve " + host;
+    }
+    int mirror_socket{socket(address->ai_family, address->ai_socktype, address->ai_protocol)};
+    if (mirror_socket < 0) {
+        freeaddrinfo(address);
+        return "ERROR: can not create socket";
+    }
+    // Task is blocked while socket waits, but not forever
+    timeval timeout{kSocketTimeoutS, 0};
+    setsockopt(mirror_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(mirror_socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    bool is_connected{connect(mirror_socket, address->ai_addr, address->ai_addrlen) == 0};
+    freeaddrinfo(address);
+
+    String error;
+    if (!is_connected) {
+        error = "ERROR: can not connect to " + host + ":" + port;
+    }
+    else if (send(mirror_socket, request.c_str(), request.length(), 0) != static_cast<ssize_t>(request.length())) {
+        error = "ERROR: can not send request to " + host;
+    }
+    else {
+        error = receive_response(mirror_socket);
+    }
+    close(mirror_socket);
+    return error;
+}
+
+String
+OtaTask::receive_response(int mirror_socket)
+{
+    uint8_t buffer[kBufferSize];
+    size_t  size{0};
+    char*   head_end{nullptr};
+    while (head_end == nullptr) {
+        auto received = recv(mirror_socket, buffer + size, sizeof(buffer) - 1 - size, 0);
+        if (received <= 0) {
+            return "ERROR: no response from mirror";
+        }
+        size += received;
+        buffer[size] = '\0';
+        head_end     = strstr(reinterpret_cast<char*>(buffer), "\r\n\r\n");
+        if ((head_end == nullptr) && (size == sizeof(buffer) - 1)) {
+            return "ERROR: head of response is too long";
+        }
+    }
+
+    *head_end = '\0';
+    String head{reinterpret_cast<char*>(buffer)};
+    if (!head.startsWith("HTTP/1.") || (head.substring(9, 12) != "200")) {
+        return "ERROR: mirror replied " + head.substring(9, head.indexOf('\r'));
+    }
+    head.toLowerCase();
+    int content_length{head.indexOf("\r\ncontent-length:")};
+    if (content_length >= 0) {
+        total_bytes_ = head.substring(content_length + 17).toInt();
+    }
+
+    String error{updater_.begin(0, expected_sha256_)};
+    size_t head_size{static_cast<size_t>(head_end - reinterpret_cast<char*>(buffer)) + 4};
+    if (error.isEmpty() && (size > head_size)) {
+        error = write(buffer + head_size, size - head_size);
+    }
+    while (error.isEmpty()) {
+        auto received = recv(mirror_socket, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            break;  // The end of response
+        }
+        error = (received < 0) ? String{"ERROR: connection to mirror is lost"} : write(buffer, received);
+    }
+    if (error.isEmpty() && (total_bytes_ != 0) && (processed_bytes_ != total_bytes_)) {
+        error = "ERROR: image is received partially";
+    }
+    return error;
+}
+
+String
+OtaTask::write(uint8_t const* data, size_t size)
+{
+    processed_bytes_ += size;
+    return updater_.write(data, size);
+}
+
+void
+OtaTask::task_main(void* ota_task)
+{
+    static_cast<OtaTask*>(ota_task)->run();
+    vTaskDelete(nullptr);
+}
+
+}  // namespace Utils
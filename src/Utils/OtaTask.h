@@ -0,0 +1,63 @@
+#ifndef SRC_UTILS_OTATASK_H_
+#define SRC_UTILS_OTATASK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+#include <WString.h>
+
+#include "FS.h"
+#include "FirmwareUpdater.h"
+
+namespace Utils
+{
+// Firmware update from file, which is already on FS, or from HTTP mirror in local network. Update runs in separate
+// FreeRTOS task, so lamp keeps working while image is read and written to flash. Task is created for every update and
+// deletes itself at the end.
+// State and progress can be read from any task. Only one update can run at a time.
+class OtaTask
+{
+public:
+    enum class State : uint8_t
+    {
+        kIdle = 0,
+        kInProgress,
+        kDone,  // New firmware is ready to boot
+        kFailed
+    };
+
+    OtaTask() = default;
+    OtaTask(OtaTask const&) = delete;
+    OtaTask& operator=(OtaTask const&) = delete;
+
+    // source - path of file ("/firmware.bin.gz") or URL of mirror ("http://192.168.1.2:8000/firmware.bin.gz").
+    // Format of image is the same as for FirmwareUpdater. Return error or empty string
+    String start(String const& source, String const& expected_sha256);
+    State  get_state() const;
+    // {"state":"in_progress","bytes":"123","total":"456","error":""}. Total is 0, if mirror does not report it
+    String get_progress_json() const;
+
+private:
+    void   run();
+    String read_file();
+    String download();
+    String receive_response(int mirror_socket);
+    String write(uint8_t const* data, size_t size);
+
+    static void task_main(void* ota_task);
+
+    String              source_;
+    String              expected_sha256_;
+    FS::File            file_;
+    FirmwareUpdater     updater_;
+    std::atomic<State>  state_{State::kIdle};
+    std::atomic<size_t> processed_bytes_{0};
+    std::atomic<size_t> total_bytes_{0};
+    String              error_;  // Is set by task before state becomes kFailed
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_OTATASK_H_
@@ -0,0 +1,156 @@
+#include "PathIndex.h"
+
+#include "Hash.h"
+
+namespace
+{
+uint32_t
+djb2_hash(char const* str)
+{
+    uint32_t hash{5381};
+    while (*str != '\0') {
+        hash = hash * 33 + static_cast<uint8_t>(*str++);
+    }
+    return hash;
+}
+
+}  // namespace
+
+namespace Utils
+{
+PathIndex::PathIndex(bool has_real_directories)
+  : has_real_directories_{has_real_directories}
+{
+}
+
+void
+PathIndex::clear()
+{
+    nodes_.clear();
+}
+
+void
+PathIndex::add_file(String const& path, size_t size)
+{
+    auto* node = add(path, FS::EntryType::kFile);
+    if (node != nullptr) {
+        node->size = size;
+    }
+}
+
+void
+PathIndex::add_directory(String const& path)
+{
+    add(path, FS::EntryType::kDirectory);
+}
+
+void
+PathIndex::add_to_size(String const& path, size_t size)
+{
+    auto* node = find_node(path);
+    if ((node != nullptr) && (node->type == FS::EntryType::kFile)) {
+        node->size += size;
+    }
+}
+
+void
+PathIndex::remove(String const& path)
+{
+    if (find_node(path) == nullptr) {
+        return;
+    }
+    nodes_.erase(Utils::fnv1a_hash(path.c_str()));
+    on_child_removed(parent_of(path));
+}
+
+PathIndex::Result
+PathIndex::find(String const& path, FS::EntryType& type, size_t& size) const
+{
+    if (path == "/") {
+        type = FS::EntryType::kDirectory;
+        size = 0;
+        return Result::kFound;
+    }
+
+    auto it = nodes_.find(Utils::fnv1a_hash(path.c_str()));
+    if (it == nodes_.end()) {
+        return Result::kNotFound;
+    }
+    if (it->second.is_ambiguous) {
+        return Result::kAmbiguous;
+    }
+    // If path with the same FNV-1a hash existed, node would be ambiguous
+    if (it->second.check_hash != djb2_hash(path.c_str())) {
+        return Result::kNotFound;
+    }
+    type = it->second.type;
+    size = it->second.size;
+    return Result::kFound;
+}
+
+size_t
+PathIndex::size() const
+{
+    return nodes_.size();
+}
+
+PathIndex::Node*
+PathIndex::add(String const& path, FS::EntryType type)
+{
+    if (path == "/") {
+        return nullptr;  // Root is not stored, it always exists
+    }
+
+    uint32_t hash{Utils::fnv1a_hash(path.c_str())};
+    uint32_t check_hash{djb2_hash(path.c_str())};
+    auto     it = nodes_.find(hash);
+    if (it != nodes_.end()) {
+        if (it->second.check_hash != check_hash) {
+            it->second.is_ambiguous = true;
+            return nullptr;
+        }
+        it->second.type = type;
+        return it->second.is_ambiguous ? nullptr : &it->second;
+    }
+
+    auto* parent = add(parent_of(path), FS::EntryType::kDirectory);
+    if (parent != nullptr) {
+        ++parent->num_of_children;
+    }
+    // Pointers to elements of unordered_map stay valid after rehashing
+    return &nodes_.emplace(hash, Node{check_hash, 0, 0, type, false}).first->second;
+}
+
+PathIndex::Node*
+PathIndex::find_node(String const& path)
+{
+    auto it = nodes_.find(Utils::fnv1a_hash(path.c_str()));
+    if ((it == nodes_.end()) || it->second.is_ambiguous || (it->second.check_hash != djb2_hash(path.c_str()))) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void
+PathIndex::on_child_removed(String const& path)
+{
+    auto* node = find_node(path);
+    if (node == nullptr) {
+        return;
+    }
+    if (node->num_of_children > 0) {
+        --node->num_of_children;
+    }
+    if ((node->num_of_children == 0) && !has_real_directories_) {
+        remove(path);
+    }
+}
+
+String
+PathIndex::parent_of(String const& path)
+{
+    int slash{path.lastIndexOf('/')};
+    return (slash <= 0) ? String{"/"} : path.substring(0, slash);
+}
+
+}  // namespace Utils
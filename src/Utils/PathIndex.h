@@ -0,0 +1,66 @@
+#ifndef SRC_UTILS_PATHINDEX_H_
+#define SRC_UTILS_PATHINDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include <WString.h>
+
+#include "FS.h"
+
+namespace Utils
+{
+// In-RAM index of entries of filesystem: hash of path -> type and size of entry. It is built by Utils::FS at mount and
+// is updated by every change, made through Utils::FS, so checks of existence, type and size of file do not touch
+// flash.
+// Paths are not stored. Entry is found by FNV-1a hash of path and is verified by second (djb2) hash of path. If two
+// different paths have the same FNV-1a hash, entry becomes ambiguous and Utils::FS checks such paths on flash.
+// Content hashes of files are not here, they are kept by Servers::ETagIndex.
+class PathIndex
+{
+public:
+    enum class Result : uint8_t
+    {
+        kFound = 0,
+        kNotFound,
+        kAmbiguous
+    };
+
+    // On filesystems without real directories (SPIFFS) directory exists only while there are files in it
+    explicit PathIndex(bool has_real_directories);
+
+    void clear();
+    // Parent directories are added if they are not in index yet
+    void add_file(String const& path, size_t size);
+    void add_directory(String const& path);
+    void add_to_size(String const& path, size_t size);
+    // Remove file or directory. Nested entries of directory should be removed before it
+    void remove(String const& path);
+
+    Result find(String const& path, FS::EntryType& type, size_t& size) const;
+    size_t size() const;
+
+private:
+    struct Node
+    {
+        uint32_t      check_hash;
+        uint32_t      size;
+        uint16_t      num_of_children;
+        FS::EntryType type;
+        bool          is_ambiguous;
+    };
+
+    Node*         add(String const& path, FS::EntryType type);
+    Node*         find_node(String const& path);
+    void          on_child_removed(String const& path);
+    static String parent_of(String const& path);
+
+    bool                               has_real_directories_;
+    std::unordered_map<uint32_t, Node> nodes_;
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_PATHINDEX_H_
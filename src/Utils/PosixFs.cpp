@@ -0,0 +1,284 @@
+#include "PosixFs.h"
+
+#include "FsBackend.h"
+
+#ifdef FS_BACKEND_POSIX
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <memory>
+#include <vector>
+
+namespace
+{
+class PosixFile : public fs::FileImpl
+{
+public:
+    PosixFile(String const& name, String const& full_path, FILE* file);
+    PosixFile(String const& name, String const& full_path, DIR* dir);
+    ~PosixFile() override;
+
+    size_t          write(uint8_t const* buf, size_t size) override;
+    size_t          read(uint8_t* buf, size_t size) override;
+    void            flush() override;
+    bool            seek(uint32_t pos, fs::SeekMode mode) override;
+    size_t          position() const override;
+    size_t          size() const override;
+    void            close() override;
+    time_t          getLastWrite() override;
+    char const*     name() const override;
+    bool            isDirectory() override;
+    fs::FileImplPtr openNextFile(char const* mode) override;
+    void            rewindDirectory() override;
+                    operator bool() override;
+
+private:
+    String name_;
+    String full_path_;
+    FILE*  file_{nullptr};
+    DIR*   dir_{nullptr};
+};
+
+PosixFile::PosixFile(String const& name, String const& full_path, FILE* file)
+  : name_{name}
+  , full_path_{full_path}
+  , file_{file}
+{
+}
+
+PosixFile::PosixFile(String const& name, String const& full_path, DIR* dir)
+  : name_{name}
+  , full_path_{full_path}
+  , dir_{dir}
+{
+}
+
+PosixFile::~PosixFile()
+{
+    close();
+}
+
+size_t
+PosixFile::write(uint8_t const* buf, size_t size)
+{
+    return ((file_ != nullptr) && (size > 0)) ? fwrite(buf, 1, size, file_) : 0;
+}
+
+size_t
+PosixFile::read(uint8_t* buf, size_t size)
+{
+    return (file_ != nullptr) ? fread(buf, 1, size, file_) : 0;
+}
+
+void
+PosixFile::flush()
+{
+    if (file_ != nullptr) {
+        fflush(file_);
+    }
+}
+
+bool
+PosixFile::seek(uint32_t pos, fs::SeekMode mode)
+{
+    static int const kOrigins[]{SEEK_SET, SEEK_CUR, SEEK_END};
+    return (file_ != nullptr) && (fseek(file_, pos, kOrigins[mode]) == 0);
+}
+
+size_t
+PosixFile::position() const
+{
+    return (file_ != nullptr) ? ftell(file_) : 0;
+}
+
+// Size of file, which is being written, includes buffered data, as on ESP32
+size_t
+PosixFile::size() const
+{
+    if (file_ == nullptr) {
+        return 0;
+    }
+    fflush(file_);
+    struct stat file_stat;
+    return (fstat(fileno(file_), &file_stat) == 0) ? file_stat.st_size : 0;
+}
+
+void
+PosixFile::close()
+{
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+    if (dir_ != nullptr) {
+        closedir(dir_);
+        dir_ = nullptr;
+    }
+}
+
+time_t
+PosixFile::getLastWrite()
+{
+    struct stat file_stat;
+    return (stat(full_path_.c_str(), &file_stat) == 0) ? file_stat.st_mtime : 0;
+}
+
+char const*
+PosixFile::name() const
+{
+    return name_.c_str();
+}
+
+bool
+PosixFile::isDirectory()
+{
+    return dir_ != nullptr;
+}
+
+fs::FileImplPtr
+PosixFile::openNextFile(char const* mode)
+{
+    if (dir_ == nullptr) {
+        return fs::FileImplPtr{};
+    }
+    while (dirent* entry = readdir(dir_)) {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+            continue;
+        }
+        String name{((name_ == "/") ? String{} : name_) + "/" + entry->d_name};
+        String full_path{full_path_ + "/" + entry->d_name};
+        struct stat entry_stat;
+        if (stat(full_path.c_str(), &entry_stat) != 0) {
+            continue;
+        }
+        if (S_ISDIR(entry_stat.st_mode)) {
+            DIR* dir{opendir(full_path.c_str())};
+            return (dir != nullptr) ? std::make_shared<PosixFile>(name, full_path, dir) : fs::FileImplPtr{};
+        }
+        FILE* file{fopen(full_path.c_str(), mode)};
+        return (file != nullptr) ? std::make_shared<PosixFile>(name, full_path, file) : fs::FileImplPtr{};
+    }
+    return fs::FileImplPtr{};
+}
+
+void
+PosixFile::rewindDirectory()
+{
+    if (dir_ != nullptr) {
+        rewinddir(dir_);
+    }
+}
+
+PosixFile::operator bool()
+{
+    return (file_ != nullptr) || (dir_ != nullptr);
+}
+
+}  // namespace
+
+namespace Utils
+{
+PosixFs::PosixFs(String const& root)
+  : root_{root}
+{
+}
+
+fs::FileImplPtr
+PosixFs::open(char const* path, char const* mode)
+{
+    String      full_path{get_full_path(path)};
+    struct stat entry_stat;
+    if ((mode[0] == 'r') && (stat(full_path.c_str(), &entry_stat) == 0) && S_ISDIR(entry_stat.st_mode)) {
+        DIR* dir{opendir(full_path.c_str())};
+        return (dir != nullptr) ? std::make_shared<PosixFile>(String{path}, full_path, dir) : fs::FileImplPtr{};
+    }
+    FILE* file{fopen(full_path.c_str(), mode)};
+    return (file != nullptr) ? std::make_shared<PosixFile>(String{path}, full_path, file) : fs::FileImplPtr{};
+}
+
+bool
+PosixFs::exists(char const* path)
+{
+    struct stat entry_stat;
+    return stat(get_full_path(path).c_str(), &entry_stat) == 0;
+}
+
+bool
+PosixFs::rename(char const* path_from, char const* path_to)
+{
+    return ::rename(get_full_path(path_from).c_str(), get_full_path(path_to).c_str()) == 0;
+}
+
+bool
+PosixFs::remove(char const* path)
+{
+    return unlink(get_full_path(path).c_str()) == 0;
+}
+
+bool
+PosixFs::mkdir(char const* path)
+{
+    return ::mkdir(get_full_path(path).c_str(), 0755) == 0;
+}
+
+bool
+PosixFs::rmdir(char const* path)
+{
+    return ::rmdir(get_full_path(path).c_str()) == 0;
+}
+
+// Directories are walked without recursion, as in Utils::FS
+size_t
+PosixFs::get_used_bytes() const
+{
+    size_t              used_bytes{0};
+    std::vector<String> dirs{root_};
+    while (!dirs.empty()) {
+        String dir_path{dirs.back()};
+        dirs.pop_back();
+        DIR* dir{opendir(dir_path.c_str())};
+        if (dir == nullptr) {
+            continue;
+        }
+        while (dirent* entry = readdir(dir)) {
+            if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0)) {
+                continue;
+            }
+            String      path{dir_path + "/" + entry->d_name};
+            struct stat entry_stat;
+            if (stat(path.c_str(), &entry_stat) != 0) {
+                continue;
+            }
+            if (S_ISDIR(entry_stat.st_mode)) {
+                dirs.push_back(path);
+            }
+            else {
+                used_bytes += entry_stat.st_size;
+            }
+        }
+        closedir(dir);
+    }
+    return used_bytes;
+}
+
+size_t
+PosixFs::get_total_bytes() const
+{
+    struct statvfs fs_stat;
+    return (statvfs(root_.c_str(), &fs_stat) == 0) ? fs_stat.f_blocks * fs_stat.f_frsize : 0;
+}
+
+String
+PosixFs::get_full_path(char const* path) const
+{
+    return root_ + ((path[0] == '/') ? "" : "/") + path;
+}
+
+}  // namespace Utils
+
+#endif  // FS_BACKEND_POSIX
@@ -0,0 +1,39 @@
+#ifndef SRC_UTILS_POSIXFS_H_
+#define SRC_UTILS_POSIXFS_H_
+
+#include <stddef.h>
+
+#include <FS.h>
+#include <FSImpl.h>
+#include <WString.h>
+
+namespace Utils
+{
+// Implementation of fs::FS by POSIX calls (fopen(), opendir(), etc.) in directory of host, which is root of FS. It is
+// used by POSIX backend of Utils::FS (see FsBackend.h) to run modules, which work with files, in host tests.
+// As on ESP32, name of file is its full path from root of FS ("/dir/file.txt").
+class PosixFs : public fs::FSImpl
+{
+public:
+    explicit PosixFs(String const& root);
+
+    fs::FileImplPtr open(char const* path, char const* mode) override;
+    bool            exists(char const* path) override;
+    bool            rename(char const* path_from, char const* path_to) override;
+    bool            remove(char const* path) override;
+    bool            mkdir(char const* path) override;
+    bool            rmdir(char const* path) override;
+
+    // Sum of sizes of all files
+    size_t get_used_bytes() const;
+    size_t get_total_bytes() const;
+
+private:
+    String get_full_path(char const* path) const;
+
+    String root_;
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_POSIXFS_H_
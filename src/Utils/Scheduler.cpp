@@ -0,0 +1,90 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+
+#include <Arduino.h>
+
+namespace Utils
+{
+Scheduler&
+Scheduler::instance()
+{
+    static Scheduler instance;
+    return instance;
+}
+
+Scheduler::Id
+Scheduler::schedule_once(uint32_t delay_ms, Action action)
+{
+    return schedule(delay_ms, 0, std::move(action));
+}
+
+Scheduler::Id
+Scheduler::schedule_periodic(uint32_t period_ms, Action action)
+{
+    // Zero period would make loop() endless
+    return schedule(period_ms, std::max(period_ms, uint32_t{1}), std::move(action));
+}
+
+void
+Scheduler::cancel(Id id)
+{
+    auto it = std::find_if(heap_.begin(), heap_.end(), [id](Entry const& entry) { return entry.id == id; });
+    if (it != heap_.end()) {
+        heap_.erase(it);
+        std::make_heap(heap_.begin(), heap_.end(), is_later);
+    }
+}
+
+bool
+Scheduler::is_scheduled(Id id) const
+{
+    return std::any_of(heap_.begin(), heap_.end(), [id](Entry const& entry) { return entry.id == id; });
+}
+
+void
+Scheduler::loop()
+{
+    unsigned long now{millis()};
+    while (!heap_.empty() && (static_cast<long>(now - heap_.front().deadline_ms) >= 0)) {
+        std::pop_heap(heap_.begin(), heap_.end(), is_later);
+        Entry entry{std::move(heap_.back())};
+        heap_.pop_back();
+
+        // Periodic action is scheduled again before it is called, so it can cancel itself
+        if (entry.period_ms != 0) {
+            Entry next{entry};
+            next.deadline_ms += entry.period_ms;
+            if (static_cast<long>(now - next.deadline_ms) >= 0) {
+                next.deadline_ms = now + entry.period_ms;  // Missed periods are skipped, not called in burst
+            }
+            push(std::move(next));
+        }
+        entry.action();
+    }
+}
+
+Scheduler::Id
+Scheduler::schedule(uint32_t delay_ms, uint32_t period_ms, Action action)
+{
+    if (++last_id_ == 0) {
+        ++last_id_;
+    }
+    push(Entry{millis() + delay_ms, period_ms, last_id_, std::move(action)});
+    return last_id_;
+}
+
+void
+Scheduler::push(Entry entry)
+{
+    heap_.push_back(std::move(entry));
+    std::push_heap(heap_.begin(), heap_.end(), is_later);
+}
+
+bool
+Scheduler::is_later(Entry const& left, Entry const& right)
+{
+    return static_cast<long>(left.deadline_ms - right.deadline_ms) > 0;
+}
+
+}  // namespace Utils
@@ -0,0 +1,55 @@
+#ifndef SRC_UTILS_SCHEDULER_H_
+#define SRC_UTILS_SCHEDULER_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+namespace Utils
+{
+// Deferred actions of main loop: one-shot (ex. reboot some time after response is sent) and periodic. Deadlines are
+// kept in min-heap, so loop() checks only the nearest one. Actions are called from loop(), never from schedule_*(), so
+// request handler can schedule action instead of sleeping and return at once.
+// Is used only from main loop (loop() of sketch), it is not thread-safe.
+class Scheduler
+{
+public:
+    using Action = std::function<void()>;
+    using Id     = uint32_t;  // 0 is never returned
+
+    Scheduler()                 = default;
+    Scheduler(Scheduler const&) = delete;
+    Scheduler& operator=(Scheduler const&) = delete;
+
+    static Scheduler& instance();
+
+    Id   schedule_once(uint32_t delay_ms, Action action);
+    Id   schedule_periodic(uint32_t period_ms, Action action);
+    // Action, which is not called yet, is just removed. Periodic action can cancel itself
+    void cancel(Id id);
+    bool is_scheduled(Id id) const;
+    // Call all actions, which deadlines have come
+    void loop();
+
+private:
+    struct Entry
+    {
+        unsigned long deadline_ms;
+        uint32_t      period_ms;  // 0 for one-shot action
+        Id            id;
+        Action        action;
+    };
+
+    Id   schedule(uint32_t delay_ms, uint32_t period_ms, Action action);
+    void push(Entry entry);
+    // Comparator of std::*_heap(). millis() overflows every 49 days, so deadlines are compared by their difference
+    static bool is_later(Entry const& left, Entry const& right);
+
+    std::vector<Entry> heap_;
+    Id                 last_id_{0};
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_SCHEDULER_H_
@@ -0,0 +1,246 @@
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+#include <Arduino.h>
+
+namespace
+{
+// Deadlines are in ticks of 1ms. millis() overflows every 49 days, so they are compared by their difference
+uint32_t
+get_current_tick()
+{
+    return static_cast<uint32_t>(millis());
+}
+
+}  // namespace
+
+namespace Utils
+{
+constexpr TimerWheel::Id TimerWheel::kInvalidId;
+constexpr size_t         TimerWheel::kNumOfLevels;
+constexpr size_t         TimerWheel::kSlotBits;
+constexpr size_t         TimerWheel::kNumOfSlots;
+constexpr uint32_t       TimerWheel::kSlotMask;
+
+TimerWheel::TimerWheel()
+  : next_tick_{get_current_tick()}
+{
+    for (auto& level : slots_) {
+        level.fill(kInvalidId);
+    }
+}
+
+TimerWheel&
+TimerWheel::instance()
+{
+    static TimerWheel instance;
+    return instance;
+}
+
+TimerWheel::Id
+TimerWheel::add(char const* name, uint32_t period_ms, uint32_t phase_ms, Priority priority, Callback callback)
+{
+    auto it = std::find_if(timers_.begin(), timers_.end(), [](Timer const& timer) { return !timer.is_used; });
+    if ((it == timers_.end()) && (timers_.size() == kInvalidId)) {
+        return kInvalidId;
+    }
+    Id id = (it != timers_.end()) ? static_cast<Id>(it - timers_.begin()) : static_cast<Id>(timers_.size());
+    if (it == timers_.end()) {
+        timers_.emplace_back();
+    }
+
+    auto& timer     = timers_[id];
+    timer           = Timer{};
+    timer.name      = name;
+    timer.callback  = std::move(callback);
+    timer.period_ms = std::max(period_ms, uint32_t{1});  // Zero period would make timer due at every tick
+    timer.deadline  = get_current_tick() + phase_ms;
+    timer.priority  = priority;
+    timer.is_used   = true;
+    link(id);
+    return id;
+}
+
+void
+TimerWheel::remove(Id id)
+{
+    if ((id >= timers_.size()) || !timers_[id].is_used) {
+        return;
+    }
+    if (timers_[id].is_linked) {
+        unlink(id);
+    }
+    timers_[id].is_used  = false;
+    timers_[id].callback = nullptr;
+}
+
+void
+TimerWheel::set_period(Id id, uint32_t period_ms)
+{
+    if ((id >= timers_.size()) || !timers_[id].is_used) {
+        return;
+    }
+    if (timers_[id].is_linked) {
+        unlink(id);
+    }
+    timers_[id].period_ms = std::max(period_ms, uint32_t{1});
+    timers_[id].deadline  = get_current_tick() + timers_[id].period_ms;
+    link(id);
+}
+
+void
+TimerWheel::loop()
+{
+    uint32_t current_tick{get_current_tick()};
+    while (static_cast<int32_t>(current_tick - next_tick_) >= 0) {
+        run_tick(next_tick_);
+    }
+}
+
+String
+TimerWheel::get_stats_json() const
+{
+    String result{"["};
+    for (auto const& timer : timers_) {
+        if (!timer.is_used) {
+            continue;
+        }
+        if (result.length() > 1) {
+            result += ",";
+        }
+        result += String{"{\"name\":\""} + timer.name + "\",\"period_ms\":" + String{timer.period_ms} +
+                  ",\"calls\":" + String{timer.calls} + ",\"overruns\":" + String{timer.overruns} +
+                  ",\"max_late_ms\":" + String{timer.max_late_ms} +
+                  ",\"max_duration_ms\":" + String{timer.max_duration_ms} + "}";
+    }
+    return result + "]";
+}
+
+// Timer goes to the lowest level, which covers distance to its deadline. Level N is cascaded to lower levels every
+// 64^N ticks, so timer reaches level 0 before its deadline
+void
+TimerWheel::link(Id id)
+{
+    auto& timer = timers_[id];
+    if (static_cast<int32_t>(timer.deadline - next_tick_) < 0) {
+        timer.deadline = next_tick_;
+    }
+    uint32_t distance{timer.deadline - next_tick_};
+    uint32_t slot_tick{timer.deadline};
+    size_t   level{0};
+    while ((level + 1 < kNumOfLevels) && (distance >= (uint32_t{1} << (kSlotBits * (level + 1))))) {
+        ++level;
+    }
+    if ((level + 1 == kNumOfLevels) && (distance >= (uint32_t{1} << (kSlotBits * kNumOfLevels)))) {
+        // Too far for the wheel. Timer is cascaded at the end of revolution of the top level and is linked again
+        slot_tick = next_tick_ + (uint32_t{1} << (kSlotBits * kNumOfLevels)) - 1;
+    }
+
+    timer.level     = static_cast<uint8_t>(level);
+    timer.slot      = static_cast<uint8_t>((slot_tick >> (kSlotBits * level)) & kSlotMask);
+    timer.is_linked = true;
+    timer.prev      = kInvalidId;
+    timer.next      = slots_[timer.level][timer.slot];
+    if (timer.next != kInvalidId) {
+        timers_[timer.next].prev = id;
+    }
+    slots_[timer.level][timer.slot] = id;
+}
+
+void
+TimerWheel::unlink(Id id)
+{
+    auto& timer = timers_[id];
+    if (timer.prev != kInvalidId) {
+        timers_[timer.prev].next = timer.next;
+    }
+    else {
+        slots_[timer.level][timer.slot] = timer.next;
+    }
+    if (timer.next != kInvalidId) {
+        timers_[timer.next].prev = timer.prev;
+    }
+    timer.is_linked = false;
+}
+
+void
+TimerWheel::cascade(size_t level, uint32_t tick)
+{
+    Id id{slots_[level][(tick >> (kSlotBits * level)) & kSlotMask]};
+    slots_[level][(tick >> (kSlotBits * level)) & kSlotMask] = kInvalidId;
+    while (id != kInvalidId) {
+        Id next{timers_[id].next};
+        link(id);
+        id = next;
+    }
+}
+
+void
+TimerWheel::run_tick(uint32_t tick)
+{
+    // Higher levels first: timers, cascaded from level 2, can get to slot of level 1, which is cascaded at this tick
+    for (size_t level = kNumOfLevels - 1; level > 0; --level) {
+        if ((tick & ((uint32_t{1} << (kSlotBits * level)) - 1)) == 0) {
+            cascade(level, tick);
+        }
+    }
+
+    Id id{slots_[0][tick & kSlotMask]};
+    slots_[0][tick & kSlotMask] = kInvalidId;
+    if (id == kInvalidId) {
+        ++next_tick_;
+        return;
+    }
+    due_timers_.clear();
+    for (; id != kInvalidId; id = timers_[id].next) {
+        timers_[id].is_linked = false;
+        due_timers_.push_back(id);
+    }
+    std::stable_sort(due_timers_.begin(), due_timers_.end(),
+                     [this](Id left, Id right) { return timers_[left].priority > timers_[right].priority; });
+
+    // Timers, which are added by callbacks, can not get to this tick any more
+    ++next_tick_;
+    for (auto due_id : due_timers_) {
+        run_timer(due_id, tick);
+    }
+}
+
+void
+TimerWheel::run_timer(Id id, uint32_t tick)
+{
+    // Previous callback could remove this timer or change its period
+    if (!timers_[id].is_used || timers_[id].is_linked) {
+        return;
+    }
+
+    Callback callback{timers_[id].callback};  // Timer can be removed by its callback
+    uint32_t start_tick{get_current_tick()};
+    callback();
+    uint32_t end_tick{get_current_tick()};
+
+    // timers_ could be reallocated by callback
+    auto& timer = timers_[id];
+    if (!timer.is_used) {
+        return;
+    }
+    ++timer.calls;
+    timer.max_late_ms     = std::max(timer.max_late_ms, start_tick - tick);
+    timer.max_duration_ms = std::max(timer.max_duration_ms, end_tick - start_tick);
+    if (timer.is_linked) {
+        return;  // Period is changed by callback
+    }
+
+    // Keep phase. If the next call is late already, skip missed periods
+    uint32_t next_deadline{timer.deadline + timer.period_ms};
+    if (static_cast<int32_t>(end_tick - next_deadline) >= 0) {
+        uint32_t num_of_missed_periods{(end_tick - next_deadline) / timer.period_ms + 1};
+        timer.overruns += num_of_missed_periods;
+        next_deadline += num_of_missed_periods * timer.period_ms;
+    }
+    timer.deadline = next_deadline;
+    link(id);
+}
+
+}  // namespace Utils
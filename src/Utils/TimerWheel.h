@@ -0,0 +1,98 @@
+#ifndef SRC_UTILS_TIMERWHEEL_H_
+#define SRC_UTILS_TIMERWHEEL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+#include <functional>
+#include <vector>
+
+#include <WString.h>
+
+namespace Utils
+{
+// Periodic work of modules (sampling of sensors, steps of sunrise, etc.). Module registers callback with period, phase
+// (delay of the first call, so that modules with the same period do not run in the same iteration of loop()) and
+// priority (callbacks, which are due at the same tick, are called from higher priority to lower).
+//
+// Hierarchical timer wheel with tick of 1ms: 4 levels of 64 slots, level N covers 64^(N+1) ticks (~4.6 hours in
+// total). Timer is put to slot of the lowest level, which covers its deadline, and moves to lower levels when time
+// comes closer. So loop() handles only slots of elapsed ticks and timers, which are due, regardless of number of
+// registered timers.
+//
+// Timer, which is called later than its deadline, keeps its phase: missed periods are skipped and counted as overruns.
+// Statistics of every timer (how late and how long it was) is available as JSON.
+// Is used only from main loop (loop() of sketch), it is not thread-safe. Callbacks may add, remove and change timers.
+class TimerWheel
+{
+public:
+    using Callback = std::function<void()>;
+    using Id       = uint16_t;
+
+    enum class Priority : uint8_t
+    {
+        kLow = 0,
+        kNormal,
+        kHigh
+    };
+
+    static constexpr Id kInvalidId{0xFFFF};
+
+    TimerWheel();
+    TimerWheel(TimerWheel const&) = delete;
+    TimerWheel& operator=(TimerWheel const&) = delete;
+
+    static TimerWheel& instance();
+
+    // name is used in statistics. It should be string literal
+    Id   add(char const* name, uint32_t period_ms, uint32_t phase_ms, Priority priority, Callback callback);
+    void remove(Id id);
+    // The next call happens in period_ms. Does nothing for kInvalidId
+    void set_period(Id id, uint32_t period_ms);
+    void loop();
+
+    // [{"name":"led_driver","period_ms":1000,"calls":10,"overruns":0,"max_late_ms":3,"max_duration_ms":1},...]
+    String get_stats_json() const;
+
+private:
+    static constexpr size_t   kNumOfLevels{4};
+    static constexpr size_t   kSlotBits{6};
+    static constexpr size_t   kNumOfSlots{1 << kSlotBits};
+    static constexpr uint32_t kSlotMask{kNumOfSlots - 1};
+
+    struct Timer
+    {
+        char const* name;
+        Callback    callback;
+        uint32_t    period_ms;
+        uint32_t    deadline;  // Tick
+        Priority    priority;
+        bool        is_used;
+        bool        is_linked;
+        uint8_t     level;  // Slot, where timer is linked
+        uint8_t     slot;
+        Id          prev;
+        Id          next;
+        // Statistics
+        uint32_t calls;
+        uint32_t overruns;  // Number of skipped periods
+        uint32_t max_late_ms;
+        uint32_t max_duration_ms;
+    };
+
+    void link(Id id);
+    void unlink(Id id);
+    void cascade(size_t level, uint32_t tick);
+    void run_tick(uint32_t tick);
+    void run_timer(Id id, uint32_t tick);
+
+    std::vector<Timer>                                    timers_;
+    std::array<std::array<Id, kNumOfSlots>, kNumOfLevels> slots_;  // Heads of lists of timers
+    std::vector<Id>                                       due_timers_;
+    uint32_t                                              next_tick_;  // Ticks before it are handled
+};
+
+}  // namespace Utils
+
+#endif  // SRC_UTILS_TIMERWHEEL_H_
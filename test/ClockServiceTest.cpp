@@ -0,0 +1,332 @@
+// ClockService against stand-in of NTP server, simulated RTC and simulated system clock, which drifts.
+// Time is simulated, so hours of work of lamp take about a second. See run_host_tests.sh
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <DS1307RTC.h>
+#include <WiFiUdp.h>
+
+#include "Check.h"
+#include "src/Control/ClockService.h"
+
+namespace
+{
+constexpr int64_t       kMicrosPerSecond{1000000};
+constexpr uint32_t      kNtpToUnixEpochOffsetS{2208988800UL};
+constexpr size_t        kNtpPacketSize{48};
+constexpr int64_t       kSlewRatePpm{1000};  // How fast adjtime() corrects system clock
+constexpr unsigned long kLoopPeriodMs{10};
+constexpr int64_t       kStartTimeUs{1700000000 * kMicrosPerSecond};  // 2023-11-14
+
+// World. Reference time is time of NTP server
+struct Simulation
+{
+    unsigned long millis{0};
+    int64_t       reference_us{kStartTimeUs};
+    int64_t       system_clock_us{0};  // Not set at boot
+    double        system_drift_ppm{0};  // Positive value means that system clock is slow
+    int64_t       pending_slew_us{0};
+    int           num_of_steps{0};
+
+    bool   is_rtc_ok{true};
+    time_t rtc_error_s{0};
+    int    num_of_rtc_writes{0};
+
+    // NTP server
+    bool          is_ntp_reachable{true};
+    uint8_t       ntp_stratum{2};
+    bool          is_originate_spoofed{false};
+    unsigned long ntp_one_way_delay_ms{20};
+    int           num_of_ntp_requests{0};
+    uint8_t       request[kNtpPacketSize];
+    bool          is_response_pending{false};
+    unsigned long response_time_ms{0};
+    uint8_t       response[kNtpPacketSize];
+};
+
+Simulation simulation;
+
+void
+write_ntp_timestamp(uint8_t* buffer, int64_t time_us)
+{
+    uint64_t seconds{(uint64_t)(time_us / kMicrosPerSecond) + kNtpToUnixEpochOffsetS};
+    uint64_t fraction{(((uint64_t)(time_us % kMicrosPerSecond)) << 32) / kMicrosPerSecond};
+    uint64_t timestamp{(seconds << 32) | fraction};
+    for (int8_t i = 7; i >= 0; --i) {
+        buffer[i] = timestamp & 0xFF;
+        timestamp >>= 8;
+    }
+}
+
+// Time goes on for all clocks, ClockService works as in loop() of sketch
+void
+run(ClockService& clock_service, unsigned long duration_ms)
+{
+    for (unsigned long elapsed_ms = 0; elapsed_ms < duration_ms; elapsed_ms += kLoopPeriodMs) {
+        int64_t step_us{(int64_t)kLoopPeriodMs * 1000};
+        int64_t max_slew_us{step_us * kSlewRatePpm / kMicrosPerSecond};
+        int64_t slew_us{constrain(simulation.pending_slew_us, -max_slew_us, max_slew_us)};
+        simulation.pending_slew_us -= slew_us;
+        simulation.millis += kLoopPeriodMs;
+        simulation.reference_us += step_us;
+        simulation.system_clock_us += step_us - (int64_t)(step_us * simulation.system_drift_ppm / 1e6) + slew_us;
+        clock_service.loop();
+    }
+}
+
+int64_t
+get_clock_error_us()
+{
+    return simulation.system_clock_us - simulation.reference_us;
+}
+
+void
+test_first_sync_by_ntp_when_rtc_fails()
+{
+    simulation           = Simulation{};
+    simulation.is_rtc_ok = false;
+    int          num_of_time_step_calls{0};
+    ClockService clock_service;
+    clock_service.set_time_step_handler([&num_of_time_step_calls]() { ++num_of_time_step_calls; });
+    clock_service.setup();
+    CHECK(simulation.system_clock_us == 0);  // RTC could not set clock
+
+    clock_service.set_ntp_server("ntp.test");
+    run(clock_service, 2000);
+    CHECK(simulation.num_of_steps == 1);
+    CHECK(num_of_time_step_calls == 1);
+    CHECK(std::abs(get_clock_error_us()) < 20000);  // Resolution of simulation is one loop period
+}
+
+void
+test_first_sync_by_rtc()
+{
+    simulation                  = Simulation{};
+    simulation.is_ntp_reachable = false;
+    ClockService clock_service;
+    clock_service.setup();
+    CHECK(simulation.num_of_steps == 1);
+    CHECK(std::abs(get_clock_error_us()) <= kMicrosPerSecond / 2);  // RTC has resolution of 1 second
+}
+
+void
+test_drift_is_compensated()
+{
+    simulation                  = Simulation{};
+    simulation.system_drift_ppm = 100;
+    ClockService clock_service;
+    clock_service.setup();
+    clock_service.set_ntp_server("ntp.test");
+
+    // NTP is requested every hour. Drift of 100 ppm makes 360 ms per hour without compensation
+    run(clock_service, 6 * 60 * 60 * 1000UL);
+    int64_t max_error_us{0};
+    for (int i = 0; i < 60 * 60; ++i) {
+        run(clock_service, 1000);
+        max_error_us = std::max(max_error_us, std::abs(get_clock_error_us()));
+    }
+    printf("Estimated drift: %.1f ppm (real 100 ppm), max error during the last hour: %lld ms\n",
+           clock_service.get_system_drift_ppm(), (long long)(max_error_us / 1000));
+    CHECK(simulation.num_of_steps == 1);  // Only the first synchronization
+    CHECK(fabs(clock_service.get_system_drift_ppm() - 100) < 10);
+    CHECK(max_error_us < 50000);
+}
+
+void
+test_unsynchronized_server_is_ignored()
+{
+    simulation             = Simulation{};
+    simulation.is_rtc_ok   = false;
+    simulation.ntp_stratum = 0;
+    ClockService clock_service;
+    clock_service.setup();
+    clock_service.set_ntp_server("ntp.test");
+
+    // Request is repeated after timeout
+    run(clock_service, 2 * 60 * 1000UL + 500);
+    CHECK(simulation.num_of_steps == 0);
+    CHECK(simulation.num_of_ntp_requests == 3);
+}
+
+void
+test_spoofed_response_is_ignored()
+{
+    simulation                      = Simulation{};
+    simulation.is_rtc_ok            = false;
+    simulation.is_originate_spoofed = true;
+    ClockService clock_service;
+    clock_service.setup();
+    clock_service.set_ntp_server("ntp.test");
+    run(clock_service, 10 * 1000UL);
+    CHECK(simulation.num_of_steps == 0);
+}
+
+void
+test_rtc_is_corrected_by_ntp()
+{
+    simulation             = Simulation{};
+    simulation.rtc_error_s = 5;
+    ClockService clock_service;
+    clock_service.setup();
+    clock_service.set_ntp_server("ntp.test");
+    run(clock_service, 2000);
+    CHECK(simulation.num_of_rtc_writes == 1);
+    CHECK(std::abs(simulation.rtc_error_s) <= 1);
+    CHECK(std::abs(get_clock_error_us() + simulation.pending_slew_us) < 20000);  // Error is being slewed
+}
+
+void
+test_rtc_is_used_when_ntp_is_unreachable()
+{
+    simulation                  = Simulation{};
+    simulation.system_drift_ppm = 200;
+    ClockService clock_service;
+    clock_service.setup();
+    clock_service.set_ntp_server("ntp.test");
+    run(clock_service, 2000);
+    simulation.is_ntp_reachable = false;
+
+    // 200 ppm is 720 ms per hour. RTC corrects errors bigger than 2 s
+    run(clock_service, 24 * 60 * 60 * 1000UL);
+    CHECK(std::abs(get_clock_error_us()) < 3 * kMicrosPerSecond);
+    CHECK(simulation.num_of_rtc_writes == 0);
+}
+
+}  // namespace
+
+unsigned long
+millis()
+{
+    return simulation.millis;
+}
+
+int
+host_gettimeofday(timeval* time_value, void*)
+{
+    time_value->tv_sec  = simulation.system_clock_us / kMicrosPerSecond;
+    time_value->tv_usec = simulation.system_clock_us % kMicrosPerSecond;
+    return 0;
+}
+
+int
+host_settimeofday(timeval const* time_value, void const*)
+{
+    simulation.system_clock_us = (int64_t)time_value->tv_sec * kMicrosPerSecond + time_value->tv_usec;
+    simulation.pending_slew_us = 0;
+    ++simulation.num_of_steps;
+    return 0;
+}
+
+int
+host_adjtime(timeval const* delta, timeval* old_delta)
+{
+    if (old_delta != nullptr) {
+        old_delta->tv_sec  = simulation.pending_slew_us / kMicrosPerSecond;
+        old_delta->tv_usec = simulation.pending_slew_us % kMicrosPerSecond;
+    }
+    if (delta != nullptr) {
+        simulation.pending_slew_us = (int64_t)delta->tv_sec * kMicrosPerSecond + delta->tv_usec;
+    }
+    return 0;
+}
+
+DS1307RTC RTC;
+
+time_t
+DS1307RTC::get()
+{
+    return simulation.is_rtc_ok ? (time_t)(simulation.reference_us / kMicrosPerSecond) + simulation.rtc_error_s : 0;
+}
+
+bool
+DS1307RTC::set(time_t time)
+{
+    simulation.rtc_error_s = time - (time_t)(simulation.reference_us / kMicrosPerSecond);
+    ++simulation.num_of_rtc_writes;
+    return true;
+}
+
+// Stand-in of NTP server. Server receives request and sends response after one way delay
+uint8_t
+WiFiUDP::begin(uint16_t)
+{
+    return 1;
+}
+
+void
+WiFiUDP::stop()
+{
+}
+
+int
+WiFiUDP::beginPacket(char const*, uint16_t)
+{
+    return simulation.is_ntp_reachable ? 1 : 0;
+}
+
+size_t
+WiFiUDP::write(uint8_t const* buffer, size_t size)
+{
+    memcpy(simulation.request, buffer, std::min(size, kNtpPacketSize));
+    return size;
+}
+
+int
+WiFiUDP::endPacket()
+{
+    ++simulation.num_of_ntp_requests;
+    int64_t server_time_us{simulation.reference_us + (int64_t)simulation.ntp_one_way_delay_ms * 1000};
+    memset(simulation.response, 0, kNtpPacketSize);
+    simulation.response[0] = 0b00100100;  // LI = 0, VN = 4, Mode = 4 (server)
+    simulation.response[1] = simulation.ntp_stratum;
+    memcpy(simulation.response + 24, simulation.request + 40, 8);  // Originate timestamp
+    if (simulation.is_originate_spoofed) {
+        simulation.response[31] ^= 0xFF;
+    }
+    write_ntp_timestamp(simulation.response + 32, server_time_us);
+    write_ntp_timestamp(simulation.response + 40, server_time_us);
+    simulation.is_response_pending = true;
+    simulation.response_time_ms    = simulation.millis + 2 * simulation.ntp_one_way_delay_ms;
+    return 1;
+}
+
+int
+WiFiUDP::parsePacket()
+{
+    return (simulation.is_response_pending && (simulation.millis >= simulation.response_time_ms)) ? kNtpPacketSize
+                                                                                                   : 0;
+}
+
+int
+WiFiUDP::read(uint8_t* buffer, size_t size)
+{
+    size = std::min(size, kNtpPacketSize);
+    memcpy(buffer, simulation.response, size);
+    simulation.is_response_pending = false;
+    return size;
+}
+
+void
+WiFiUDP::flush()
+{
+}
+
+int
+main()
+{
+    test_first_sync_by_ntp_when_rtc_fails();
+    test_first_sync_by_rtc();
+    test_drift_is_compensated();
+    test_unsynchronized_server_is_ignored();
+    test_spoofed_response_is_ignored();
+    test_rtc_is_corrected_by_ntp();
+    test_rtc_is_used_when_ntp_is_unreachable();
+    return Test::report("ClockServiceTest");
+}
@@ -0,0 +1,294 @@
+// Parsing of date, time and alarms, which come from clients. Malformed input is checked by fuzzing, strings are put to
+// buffers of exact size, so that sanitizer catches reading out of them. See run_host_tests.sh
+// With --benchmark argument prints time of parsing instead of testing.
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "src/Utils/DateTime.h"
+
+using Utils::DateTime::Error;
+
+namespace
+{
+constexpr int    kNumOfFuzzIterations{200000};
+constexpr int    kNumOfBenchmarkIterations{2000000};
+constexpr size_t kMaxFuzzStrLength{24};
+
+// Input is copied to heap buffer of exact size without null character
+Error
+parse_datetime(std::string const& str, tmElements_t& datetime)
+{
+    std::vector<char> buffer(str.begin(), str.end());
+    return Utils::DateTime::parse_datetime(buffer.data(), buffer.size(), datetime);
+}
+
+Error
+parse_alarm(std::string const& str, Utils::DateTime::Alarm& alarm)
+{
+    std::vector<char> buffer(str.begin(), str.end());
+    return Utils::DateTime::parse_alarm(buffer.data(), buffer.size(), alarm);
+}
+
+Error
+parse_datetime(std::string const& str)
+{
+    tmElements_t datetime;
+    return parse_datetime(str, datetime);
+}
+
+Error
+parse_alarm(std::string const& str)
+{
+    Utils::DateTime::Alarm alarm;
+    return parse_alarm(str, alarm);
+}
+
+std::string
+format_alarm(Utils::DateTime::Alarm const& alarm)
+{
+    char buffer[] = "HH:MM WW DDDD";
+    Utils::DateTime::format_fixed_uint(buffer, 2, alarm.hour);
+    Utils::DateTime::format_fixed_uint(buffer + 3, 2, alarm.minute);
+    Utils::DateTime::format_fixed_hex(buffer + 6, 2, alarm.days_of_week);
+    Utils::DateTime::format_fixed_uint(buffer + 9, 4, alarm.sunrise_duration_m);
+    return buffer;
+}
+
+void
+test_parse_datetime()
+{
+    tmElements_t datetime;
+    CHECK(parse_datetime("12:34:56 29/02/2024", datetime) == Error::kOk);
+    CHECK((datetime.Hour == 12) && (datetime.Minute == 34) && (datetime.Second == 56));
+    CHECK((datetime.Day == 29) && (datetime.Month == 2) && (tmYearToCalendar(datetime.Year) == 2024));
+    CHECK(datetime.Wday == 5);  // Thursday
+    CHECK(parse_datetime("00:00:00 01/01/2000") == Error::kOk);
+    CHECK(parse_datetime("23:59:59 31/12/2099") == Error::kOk);
+
+    char buffer[Utils::DateTime::kDateTimeStrLength + 1];
+    CHECK(Utils::DateTime::format_datetime(datetime, buffer, sizeof(buffer)) == Utils::DateTime::kDateTimeStrLength);
+    CHECK(strcmp(buffer, "12:34:56 29/02/2024") == 0);
+    CHECK(Utils::DateTime::format_datetime(datetime, buffer, sizeof(buffer) - 1) == 0);
+
+    CHECK(parse_datetime("") == Error::kInvalidLength);
+    CHECK(parse_datetime("12:34:56 29/02/202") == Error::kInvalidLength);
+    CHECK(parse_datetime("12:34:56 29/02/20245") == Error::kInvalidLength);
+    CHECK(parse_datetime("12-34:56 29/02/2024") == Error::kInvalidSeparator);
+    CHECK(parse_datetime("12:34:56T29/02/2024") == Error::kInvalidSeparator);
+    CHECK(parse_datetime("12:34:56 29.02.2024") == Error::kInvalidSeparator);
+    CHECK(parse_datetime("1a:34:56 29/02/2024") == Error::kInvalidDigit);
+    CHECK(parse_datetime("12:34:56 29/02/-024") == Error::kInvalidDigit);
+    CHECK(parse_datetime(" 2:34:56 29/02/2024") == Error::kInvalidDigit);
+    CHECK(parse_datetime("24:00:00 01/01/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:60:00 01/01/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:60 01/01/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 00/01/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 32/01/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 31/04/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 29/02/2023") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 01/00/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 01/13/2024") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 01/01/1999") == Error::kOutOfRange);
+    CHECK(parse_datetime("12:00:00 01/01/2100") == Error::kOutOfRange);
+}
+
+void
+test_day_of_week()
+{
+    // Compare with libc for every day, supported by RTC
+    struct tm date{};
+    date.tm_year = 2000 - 1900;
+    date.tm_mon  = 0;
+    date.tm_mday = 1;
+    date.tm_hour = 12;
+    time_t time{timegm(&date)};
+    for (; gmtime_r(&time, &date)->tm_year < 2100 - 1900; time += 24 * 60 * 60) {
+        uint16_t year  = date.tm_year + 1900;
+        uint8_t  month = date.tm_mon + 1;
+        if (!CHECK(Utils::DateTime::day_of_week(year, month, date.tm_mday) == date.tm_wday + 1)) {
+            printf("Wrong day of week of %d/%d/%d\n", date.tm_mday, month, year);
+            break;
+        }
+        CHECK(date.tm_mday <= Utils::DateTime::days_in_month(year, month));
+    }
+    CHECK(Utils::DateTime::days_in_month(2000, 2) == 29);
+    CHECK(Utils::DateTime::days_in_month(2100, 2) == 28);
+    CHECK(Utils::DateTime::days_in_month(2024, 0) == 0);
+    CHECK(Utils::DateTime::days_in_month(2024, 13) == 0);
+}
+
+void
+test_parse_alarm()
+{
+    Utils::DateTime::Alarm alarm;
+    CHECK(parse_alarm("07:30", alarm) == Error::kOk);
+    CHECK((alarm.hour == 7) && (alarm.minute == 30));
+    CHECK((alarm.days_of_week == Utils::DateTime::kEveryDayMask) && (alarm.sunrise_duration_m == 0));
+    CHECK(parse_alarm("07:30 1f", alarm) == Error::kOk);
+    CHECK(alarm.days_of_week == 0x1F);
+    CHECK(parse_alarm("07:30 F", alarm) == Error::kOk);  // WebUI sends mask without leading zero
+    CHECK(alarm.days_of_week == 0x0F);
+    CHECK(parse_alarm("07:30 0", alarm) == Error::kOk);  // 0 is every day for compatibility
+    CHECK(alarm.days_of_week == Utils::DateTime::kEveryDayMask);
+    CHECK(parse_alarm("07:30 1f 0045", alarm) == Error::kOk);
+    CHECK((alarm.days_of_week == 0x1F) && (alarm.sunrise_duration_m == 45));
+    CHECK(parse_alarm("07:30 6 1440", alarm) == Error::kOk);
+    CHECK((alarm.days_of_week == 0x06) && (alarm.sunrise_duration_m == 1440));
+
+    CHECK(parse_alarm("") == Error::kInvalidLength);
+    CHECK(parse_alarm("07:3") == Error::kInvalidLength);
+    CHECK(parse_alarm("07:30 ") == Error::kInvalidLength);
+    CHECK(parse_alarm("07:30 1f ") == Error::kInvalidLength);
+    CHECK(parse_alarm("07:30 1f 045") == Error::kInvalidLength);
+    CHECK(parse_alarm("07:30 1f 00450") == Error::kInvalidLength);
+    CHECK(parse_alarm("07-30") == Error::kInvalidSeparator);
+    CHECK(parse_alarm("07:30x1f") == Error::kInvalidSeparator);
+    CHECK(parse_alarm("07:30 1f2") == Error::kInvalidSeparator);
+    CHECK(parse_alarm("07:30 1fx0045") == Error::kInvalidSeparator);
+    CHECK(parse_alarm("0x:30") == Error::kInvalidDigit);
+    CHECK(parse_alarm("07:30 g") == Error::kInvalidDigit);
+    CHECK(parse_alarm("07:30 1f 00x5") == Error::kInvalidDigit);
+    CHECK(parse_alarm("24:00") == Error::kOutOfRange);
+    CHECK(parse_alarm("07:60") == Error::kOutOfRange);
+    CHECK(parse_alarm("07:30 80") == Error::kOutOfRange);
+    CHECK(parse_alarm("07:30 1f 1441") == Error::kOutOfRange);
+}
+
+// Random strings are mostly rejected by length, so valid strings are mutated as well
+std::string
+make_fuzz_str(std::mt19937& random, char const* valid_str)
+{
+    static constexpr char kAlphabet[] = "0123456789:/ aAfFgx\xff";
+    std::string           str;
+    if (random() % 2 == 0) {
+        str.resize(random() % (kMaxFuzzStrLength + 1));
+        for (auto& c : str) {
+            c = kAlphabet[random() % (sizeof(kAlphabet) - 1)];
+        }
+        return str;
+    }
+
+    str = valid_str;
+    for (int i = random() % 4; i >= 0; --i) {
+        size_t position = random() % (str.size() + 1);
+        switch (random() % 3) {
+        case 0:
+            str.insert(position, 1, kAlphabet[random() % (sizeof(kAlphabet) - 1)]);
+            break;
+        case 1:
+            if (position < str.size()) {
+                str.erase(position, 1);
+            }
+            break;
+        default:
+            if (position < str.size()) {
+                str[position] = kAlphabet[random() % (sizeof(kAlphabet) - 1)];
+            }
+            break;
+        }
+    }
+    return str;
+}
+
+void
+test_fuzz()
+{
+    std::mt19937 random{12345};
+    int          num_of_valid_datetimes{0};
+    int          num_of_valid_alarms{0};
+    for (int i = 0; i < kNumOfFuzzIterations; ++i) {
+        // Parsed date and time should be formatted back to the same string
+        std::string  str = make_fuzz_str(random, "12:34:56 29/02/2024");
+        tmElements_t datetime;
+        if (parse_datetime(str, datetime) == Error::kOk) {
+            ++num_of_valid_datetimes;
+            char buffer[Utils::DateTime::kDateTimeStrLength + 1];
+            Utils::DateTime::format_datetime(datetime, buffer, sizeof(buffer));
+            if (!CHECK(str == buffer)) {
+                printf("Date and time '%s' is formatted as '%s'\n", str.c_str(), buffer);
+                break;
+            }
+        }
+
+        // Parsed alarm should be in range and should be parsed again from its full form
+        str = make_fuzz_str(random, "07:30 1f 0045");
+        Utils::DateTime::Alarm alarm;
+        if (parse_alarm(str, alarm) == Error::kOk) {
+            ++num_of_valid_alarms;
+            Utils::DateTime::Alarm parsed_alarm;
+            bool is_ok = (alarm.hour < 24) && (alarm.minute < 60) && (alarm.days_of_week != 0) &&
+                         (alarm.days_of_week <= Utils::DateTime::kEveryDayMask) &&
+                         (alarm.sunrise_duration_m <= Utils::DateTime::kMaxSunriseDurationMinutes) &&
+                         (parse_alarm(format_alarm(alarm), parsed_alarm) == Error::kOk) &&
+                         (parsed_alarm.hour == alarm.hour) && (parsed_alarm.minute == alarm.minute) &&
+                         (parsed_alarm.days_of_week == alarm.days_of_week) &&
+                         (parsed_alarm.sunrise_duration_m == alarm.sunrise_duration_m);
+            if (!CHECK(is_ok)) {
+                printf("Alarm '%s' is parsed incorrectly\n", str.c_str());
+                break;
+            }
+        }
+    }
+    printf("Fuzzing: %d valid dates and %d valid alarms of %d strings\n", num_of_valid_datetimes,
+           num_of_valid_alarms, kNumOfFuzzIterations);
+    CHECK((num_of_valid_datetimes > 0) && (num_of_valid_alarms > 0));
+}
+
+template <typename Function>
+void
+benchmark(char const* name, Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kNumOfBenchmarkIterations; ++i) {
+        function();
+    }
+    auto duration = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    printf("%s: %.1f ns per call\n", name, duration / kNumOfBenchmarkIterations);
+}
+
+void
+run_benchmark()
+{
+    // volatile does not let compiler to drop parsing, which result is not used
+    static char const    kDateTimeStr[] = "12:34:56 29/02/2024";
+    static char const    kAlarmStr[]    = "07:30 1f 0045";
+    volatile Error       error;
+    volatile uint8_t     day_of_week;
+    char const* volatile datetime_str = kDateTimeStr;
+    char const* volatile alarm_str    = kAlarmStr;
+
+    tmElements_t datetime;
+    benchmark("parse_datetime", [&]() {
+        error = Utils::DateTime::parse_datetime(datetime_str, Utils::DateTime::kDateTimeStrLength, datetime);
+    });
+    Utils::DateTime::Alarm alarm;
+    benchmark("parse_alarm", [&]() { error = Utils::DateTime::parse_alarm(alarm_str, sizeof(kAlarmStr) - 1, alarm); });
+    benchmark("day_of_week", [&]() { day_of_week = Utils::DateTime::day_of_week(2024, datetime_str[1] - '0', 29); });
+    (void)error;
+    (void)day_of_week;
+}
+
+}  // namespace
+
+int
+main(int argc, char* argv[])
+{
+    if ((argc > 1) && (strcmp(argv[1], "--benchmark") == 0)) {
+        run_benchmark();
+        return 0;
+    }
+
+    test_parse_datetime();
+    test_day_of_week();
+    test_parse_alarm();
+    test_fuzz();
+    return Test::report("DateTimeTest");
+}
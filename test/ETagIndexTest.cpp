@@ -0,0 +1,165 @@
+// Servers::ETagIndex on POSIX backend of Utils::FS (see PosixFs.h). ETags of small and big files, index file and
+// files, changed bypassing web server (as FTP server does), are checked. See run_host_tests.sh
+
+#include <ftw.h>
+#include <stdio.h>
+
+#include <rom/crc.h>
+
+#include <string>
+
+#include "Check.h"
+#include "src/Servers/ETagIndex.h"
+#include "src/Utils/FS.h"
+
+using Servers::ETagIndex;
+
+namespace
+{
+constexpr size_t kBigFileSize{10000};  // ETag is calculated in loop()
+
+unsigned long now_ms{0};
+
+int
+remove_entry(char const* path, struct stat const*, int, FTW*)
+{
+    return ::remove(path);
+}
+
+void
+clear_root()
+{
+    nftw(FS_POSIX_ROOT, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void
+write_file(String const& path, std::string const& content)
+{
+    auto file = Utils::FS::open(path, Utils::FS::OpenMode::kWrite);
+    Utils::FS::write(file, reinterpret_cast<uint8_t const*>(content.data()), content.size());
+    Utils::FS::close(file);
+}
+
+// File is written bypassing Utils::FS
+void
+write_file_externally(char const* path, std::string const& content)
+{
+    FILE* file{fopen((std::string{FS_POSIX_ROOT} + path).c_str(), "w")};
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+}
+
+// Utils::FS checks FS for external changes not often
+void
+wait_for_external_change_check()
+{
+    now_ms += 1000;
+}
+
+void
+test_small_file()
+{
+    ETagIndex etag_index;
+    etag_index.load();
+    write_file("/check.txt", "123456789");
+    CHECK(etag_index.get("/check.txt") == "\"cbf43926-9\"");  // Standard check value of CRC-32
+    CHECK(etag_index.get("/missing.txt") == "");
+    CHECK(etag_index.get(ETagIndex::kIndexPath) == "");
+
+    // Uploaded file is replaced by another one of different size
+    etag_index.set("/check.txt", 0x12345678, 9);
+    CHECK(etag_index.get("/check.txt") == "\"12345678-9\"");
+    write_file("/check.txt", "1234567890");
+    CHECK(etag_index.get("/check.txt") == ETagIndex::make_etag(0x261daee5, 10));
+}
+
+// FTP server truncates file and writes it. Size of file is the same, but used bytes of FS are changed in between
+void
+test_same_size_external_replacement()
+{
+    ETagIndex etag_index;
+    etag_index.load();
+    write_file("/a.txt", "aaaa");
+    etag_index.set("/a.txt", 0x11111111, 4);
+
+    write_file_externally("/a.txt", "");
+    wait_for_external_change_check();
+    CHECK(etag_index.get("/a.txt") != "\"11111111-4\"");
+    write_file_externally("/a.txt", "bbbb");
+    wait_for_external_change_check();
+
+    String etag{etag_index.get("/a.txt")};
+    CHECK(etag != "\"11111111-4\"");
+    CHECK(etag != "");
+    write_file("/b.txt", "bbbb");
+    CHECK(etag == etag_index.get("/b.txt"));
+
+    // Dropped ETags are removed from index file too
+    ETagIndex loaded;
+    loaded.load();
+    CHECK(loaded.get("/a.txt") == etag);
+}
+
+void
+test_big_file()
+{
+    std::string content(kBigFileSize, 'x');
+    write_file("/big.txt", content);
+    ETagIndex etag_index;
+    etag_index.load();
+    CHECK(etag_index.get("/big.txt") == "");  // Calculation is queued
+    CHECK(etag_index.get("/big.txt") == "");  // Not twice
+
+    for (int i = 0; (i < 10) && (etag_index.get("/big.txt") == ""); ++i) {
+        etag_index.loop();
+    }
+    String etag{etag_index.get("/big.txt")};
+    CHECK(etag == ETagIndex::make_etag(crc32_le(0, reinterpret_cast<uint8_t const*>(content.data()), content.size()),
+                                       kBigFileSize));
+
+    // ETag of big file is written to index
+    ETagIndex loaded;
+    loaded.load();
+    CHECK(loaded.get("/big.txt") == etag);
+}
+
+// File, which is changed while its ETag is being calculated, gets ETag of its new content
+void
+test_big_file_changed_externally_during_calculation()
+{
+    write_file("/big2.txt", std::string(kBigFileSize, 'y'));
+    ETagIndex etag_index;
+    etag_index.load();
+    CHECK(etag_index.get("/big2.txt") == "");
+
+    std::string content(kBigFileSize + 1, 'z');
+    write_file_externally("/big2.txt", content);
+    wait_for_external_change_check();
+    for (int i = 0; i < 10; ++i) {
+        etag_index.loop();
+        etag_index.get("/big2.txt");
+    }
+    CHECK(etag_index.get("/big2.txt") ==
+          ETagIndex::make_etag(crc32_le(0, reinterpret_cast<uint8_t const*>(content.data()), content.size()),
+                               content.size()));
+}
+
+}  // namespace
+
+unsigned long
+millis()
+{
+    return now_ms;
+}
+
+int
+main()
+{
+    clear_root();
+    CHECK(Utils::FS::begin());
+    test_small_file();
+    test_same_size_external_replacement();
+    test_big_file();
+    test_big_file_changed_externally_during_calculation();
+    return Test::report("ETagIndexTest");
+}
@@ -0,0 +1,242 @@
+// Utils::FS on POSIX backend (see PosixFs.h): files and directories are created, listed, moved, copied and removed in
+// directory of host, index of entries is checked against it. See run_host_tests.sh
+// With --benchmark argument prints result of FS benchmark instead of testing.
+
+#include <ftw.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+
+#include "Check.h"
+#include "src/Utils/FS.h"
+#include "src/Utils/FsBackend.h"
+#include "src/Utils/FsBenchmark.h"
+
+namespace
+{
+constexpr size_t kBigFileSize{10000};  // Several blocks of copying
+
+unsigned long now_ms{0};
+
+int
+remove_entry(char const* path, struct stat const*, int, FTW*)
+{
+    return ::remove(path);
+}
+
+// Root directory of backend is removed, so every run starts with empty FS
+void
+clear_root()
+{
+    nftw(FS_POSIX_ROOT, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+void
+write_file(String const& path, std::string const& content)
+{
+    auto file = Utils::FS::open(path, Utils::FS::OpenMode::kWrite);
+    CHECK(file);
+    CHECK(Utils::FS::write(file, reinterpret_cast<uint8_t const*>(content.data()), content.size()) == content.size());
+    Utils::FS::close(file);
+}
+
+std::string
+read_file(String const& path)
+{
+    std::string content;
+    auto        file = Utils::FS::open(path);
+    uint8_t     buffer[256];
+    while (size_t size = file.read(buffer, sizeof(buffer))) {
+        content.append(reinterpret_cast<char const*>(buffer), size);
+    }
+    file.close();
+    return content;
+}
+
+std::string
+list(String const& path)
+{
+    Utils::FS::FileList list{path};
+    std::string         json;
+    char                buffer[7];  // Parts of JSON are split between reads
+    while (size_t size = list.read(buffer, sizeof(buffer))) {
+        json.append(buffer, size);
+    }
+    return json;
+}
+
+std::string
+make_content(size_t size)
+{
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        content[i] = 'a' + i % 26;
+    }
+    return content;
+}
+
+void
+test_files()
+{
+    CHECK(!Utils::FS::exists("/index.htm"));
+    write_file("/index.htm", "<html></html>");
+    CHECK(Utils::FS::is_file("/index.htm"));
+    CHECK(!Utils::FS::is_directory("/index.htm"));
+    CHECK(Utils::FS::get_file_size("/index.htm") == 13);
+    CHECK(read_file("/index.htm") == "<html></html>");
+
+    auto created = Utils::FS::create_file("/empty.txt");
+    CHECK(created.first);
+    CHECK(created.second == "");
+    Utils::FS::close(created.first);
+    CHECK(Utils::FS::is_file("/empty.txt"));
+    CHECK(Utils::FS::get_file_size("/empty.txt") == 0);
+    CHECK(Utils::FS::create_file("/bad//name").second == "INVALID FILENAME");
+
+    auto file = Utils::FS::open("/index.htm");
+    CHECK(Utils::FS::seek(file, 6));
+    uint8_t buffer[7]{};
+    CHECK(file.read(buffer, 6) == 6);
+    CHECK(memcmp(buffer, "</html", 6) == 0);
+    file.close();
+
+    CHECK(Utils::FS::remove("/empty.txt").first);
+    CHECK(!Utils::FS::exists("/empty.txt"));
+    CHECK(!Utils::FS::remove("/empty.txt").first);
+}
+
+void
+test_directories()
+{
+    CHECK(Utils::FS::create_folder("/www/").first);
+    CHECK(Utils::FS::create_folder("/www/css/").first);
+    CHECK(Utils::FS::create_folder("/bad").second == "INVALID FOLDER NAME");
+    CHECK(Utils::FS::is_directory("/www/css"));
+    write_file("/www/b.js", "var b;");
+    write_file("/www/A.js", "var a;");
+    write_file("/www/css/style.css", make_content(kBigFileSize));
+
+    // Directories first, then files in case-insensitive order
+    CHECK(list("/www") == "[{\"type\":\"dir\",\"name\":\"www/css\"},"
+                          "{\"type\":\"file\",\"size\":\"6\",\"name\":\"www/A.js\"},"
+                          "{\"type\":\"file\",\"size\":\"6\",\"name\":\"www/b.js\"}]");
+
+    CHECK(Utils::FS::copy("/www", "/copy").first);
+    CHECK(read_file("/copy/css/style.css") == make_content(kBigFileSize));
+    CHECK(Utils::FS::get_file_size("/copy/css/style.css") == kBigFileSize);
+    CHECK(Utils::FS::copy("/www", "/copy").second == "DESTINATION EXISTS");
+    CHECK(Utils::FS::copy("/www", "/www/css/www").second == "DESTINATION IS INSIDE SOURCE");
+
+    // Directory is moved by single rename, then index is updated
+    CHECK(Utils::FS::rename("/copy", "/moved").first);
+    CHECK(!Utils::FS::exists("/copy/css/style.css"));
+    CHECK(Utils::FS::is_directory("/moved/css"));
+    CHECK(Utils::FS::get_file_size("/moved/css/style.css") == kBigFileSize);
+
+    auto removed = Utils::FS::remove("/moved/css");
+    CHECK(removed.first);
+    CHECK(removed.second == "/moved");
+    CHECK(!Utils::FS::exists("/moved/css/style.css"));
+    CHECK(Utils::FS::remove("/moved").first);
+    CHECK(!Utils::FS::exists("/moved/A.js"));
+}
+
+void
+test_tree_operation_by_steps()
+{
+    String path;
+    for (int depth = 0; depth < 5; ++depth) {
+        path += "/d" + String{depth};
+        CHECK(Utils::FS::create_folder(path + "/").first);
+        write_file(path + "/file.txt", "content");
+    }
+
+    Utils::FS::TreeOperation operation{Utils::FS::TreeOperation::Type::kDelete, "/d0"};
+    int                      num_of_steps{0};
+    while (operation.step() == Utils::FS::TreeOperation::State::kInProgress) {
+        ++num_of_steps;
+    }
+    CHECK(operation.get_state() == Utils::FS::TreeOperation::State::kDone);
+    CHECK(num_of_steps > 10);
+    CHECK(operation.get_progress_json() ==
+          "{\"type\":\"delete\",\"state\":\"done\",\"entries\":\"10\",\"bytes\":\"35\",\"error\":\"\"}");
+    CHECK(!Utils::FS::exists("/d0"));
+
+    Utils::FS::TreeOperation missing{Utils::FS::TreeOperation::Type::kMove, "/d0", "/d1"};
+    CHECK(missing.run_for(10) == Utils::FS::TreeOperation::State::kFailed);
+    CHECK(missing.get_error() == "SOURCE NOT FOUND");
+}
+
+void
+test_replace()
+{
+    write_file("/www/A.js", "old");
+    write_file("/.upload.tmp", "new content");
+    CHECK(Utils::FS::replace("/.upload.tmp", "/www/A.js").first);
+    CHECK(!Utils::FS::exists("/.upload.tmp"));
+    CHECK(read_file("/www/A.js") == "new content");
+    CHECK(Utils::FS::get_file_size("/www/A.js") == 11);
+}
+
+// File is written directly, bypassing Utils::FS (as FTP server would do). It is found, when index is checked next time
+void
+test_external_change_is_detected()
+{
+    FILE* file{fopen(FS_POSIX_ROOT "/external.txt", "w")};
+    fputs("external", file);
+    fclose(file);
+    CHECK(!Utils::FS::exists("/external.txt"));
+
+    now_ms += 1000;
+    CHECK(Utils::FS::is_file("/external.txt"));
+    CHECK(Utils::FS::get_file_size("/external.txt") == 8);
+}
+
+void
+test_benchmark()
+{
+    Utils::FsBenchmark benchmark;
+    while (benchmark.step() == Utils::FsBenchmark::State::kInProgress) {
+    }
+    CHECK(benchmark.get_state() == Utils::FsBenchmark::State::kDone);
+    CHECK(!Utils::FS::exists("/.fs_benchmark"));
+    printf("%s\n", benchmark.get_result_json().c_str());
+}
+
+}  // namespace
+
+unsigned long
+millis()
+{
+    return now_ms;
+}
+
+// Benchmark measures real time of operations
+unsigned long
+micros()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000UL + time.tv_nsec / 1000;
+}
+
+int
+main(int argc, char* argv[])
+{
+    clear_root();
+    CHECK(Utils::FS::begin());
+    if ((argc > 1) && (strcmp(argv[1], "--benchmark") == 0)) {
+        test_benchmark();
+        return Test::report("FsBenchmark");
+    }
+
+    test_files();
+    test_directories();
+    test_tree_operation_by_steps();
+    test_replace();
+    test_external_change_is_detected();
+    test_benchmark();
+    return Test::report("FsTest");
+}
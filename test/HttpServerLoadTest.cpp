@@ -0,0 +1,531 @@
+// Servers::HttpServer on sockets of host (see host/lwip/sockets.h). Server runs in main thread as in loop() of sketch,
+// clients are threads with blocking sockets. Responses to pipelined, ranged and upload requests and to requests of
+// files, which can not be read, are checked first. Then several keep-alive clients load server, while one more client
+// holds its connection with incomplete request. Total time and latencies of requests under load are printed.
+// See run_host_tests.sh
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <lwip/sockets.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <FSImpl.h>
+
+#include "Check.h"
+#include "src/Servers/HttpServer.h"
+#include "src/Utils/FS.h"
+
+using Servers::HttpServer;
+
+namespace
+{
+constexpr uint16_t      kFirstPort{18080};
+constexpr uint16_t      kNumOfPorts{100};  // Ports, which are tried, if the previous ones are busy
+constexpr int           kNumOfClients{4};
+constexpr int           kNumOfRequestsPerClient{100};
+constexpr size_t        kFileSize{10000};  // Several send chunks
+constexpr unsigned long kConnectionTimeoutUs{5000000};
+
+struct Response
+{
+    int         code{0};
+    std::string head;
+    std::string body;
+    bool        is_closed{false};  // Server closes connection after response
+};
+
+// Blocking client, which reads responses with Content-Length only (server does not use chunked encoding here)
+class Client
+{
+public:
+    ~Client()
+    {
+        disconnect();
+    }
+
+    bool
+    connect(uint16_t port)
+    {
+        socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port        = htons(port);
+        int enable{1};
+        setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        return ::connect(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    void
+    disconnect()
+    {
+        if (socket_ >= 0) {
+            close(socket_);
+            socket_ = -1;
+        }
+        in_.clear();
+    }
+
+    bool
+    write(std::string const& data)
+    {
+        return send(socket_, data.data(), data.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(data.size());
+    }
+
+    // Response to HEAD request has Content-Length, but no body
+    bool
+    read(Response& response, bool is_head = false)
+    {
+        size_t head_end;
+        while ((head_end = in_.find("\r\n\r\n")) == std::string::npos) {
+            if (!receive()) {
+                return false;
+            }
+        }
+        response.head = in_.substr(0, head_end + 4);
+        in_.erase(0, head_end + 4);
+        response.code      = atoi(response.head.c_str() + strlen("HTTP/1.1 "));
+        response.is_closed = response.head.find("Connection: close\r\n") != std::string::npos;
+
+        size_t length{0};
+        auto   position = response.head.find("Content-Length: ");
+        if ((position != std::string::npos) && !is_head) {
+            length = strtoul(response.head.c_str() + position + strlen("Content-Length: "), nullptr, 10);
+        }
+        while (in_.size() < length) {
+            if (!receive()) {
+                return false;
+            }
+        }
+        response.body = in_.substr(0, length);
+        in_.erase(0, length);
+        return true;
+    }
+
+    Response
+    request(std::string const& data, bool is_head = false)
+    {
+        Response response;
+        if (!write(data) || !read(response, is_head)) {
+            response.code = 0;
+        }
+        return response;
+    }
+
+    // Connection is closed by server: there is no more data
+    bool
+    is_closed_by_server()
+    {
+        return in_.empty() && !receive();
+    }
+
+    // Server neither closed connection, nor sent anything
+    bool
+    is_waiting()
+    {
+        char c;
+        return (recv(socket_, &c, 1, MSG_PEEK | MSG_DONTWAIT) < 0) && (errno == EAGAIN);
+    }
+
+private:
+    bool
+    receive()
+    {
+        char buffer[4096];
+        auto size = recv(socket_, buffer, sizeof(buffer), 0);
+        if (size <= 0) {
+            return false;
+        }
+        in_.append(buffer, size);
+        return true;
+    }
+
+    int         socket_{-1};
+    std::string in_;
+};
+
+// File of given size, which fails to seek or has less data than its size (as damaged or truncated file)
+class FaultyFile : public fs::FileImpl
+{
+public:
+    FaultyFile(size_t size, size_t readable_size, bool is_seekable)
+      : size_{size}
+      , readable_size_{readable_size}
+      , is_seekable_{is_seekable}
+    {
+    }
+
+    size_t
+    write(uint8_t const*, size_t) override
+    {
+        return 0;
+    }
+    size_t
+    read(uint8_t* buf, size_t size) override
+    {
+        size = std::min(size, readable_size_ - std::min(position_, readable_size_));
+        memset(buf, 'f', size);
+        position_ += size;
+        return size;
+    }
+    void
+    flush() override
+    {
+    }
+    bool
+    seek(uint32_t pos, fs::SeekMode) override
+    {
+        position_ = pos;
+        return is_seekable_;
+    }
+    size_t
+    position() const override
+    {
+        return position_;
+    }
+    size_t
+    size() const override
+    {
+        return size_;
+    }
+    void
+    close() override
+    {
+    }
+    time_t
+    getLastWrite() override
+    {
+        return 0;
+    }
+    char const*
+    name() const override
+    {
+        return "/faulty.txt";
+    }
+    bool
+    isDirectory() override
+    {
+        return false;
+    }
+    fs::FileImplPtr
+    openNextFile(char const*) override
+    {
+        return fs::FileImplPtr{};
+    }
+    void
+    rewindDirectory() override
+    {
+    }
+    operator bool() override
+    {
+        return true;
+    }
+
+private:
+    size_t size_;
+    size_t readable_size_;
+    bool   is_seekable_;
+    size_t position_{0};
+};
+
+unsigned long
+now_us()
+{
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000000UL + time.tv_nsec / 1000;
+}
+
+std::string
+make_content(size_t size)
+{
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        content[i] = 'a' + i % 26;
+    }
+    return content;
+}
+
+std::string
+get(std::string const& uri, std::string const& headers = "")
+{
+    return "GET " + uri + " HTTP/1.1\r\nHost: lamp\r\n" + headers + "\r\n";
+}
+
+std::string
+multipart_upload(std::string const& filename, std::string const& content)
+{
+    std::string body{"--XYZ\r\nContent-Disposition: form-data; name=\"data\"; filename=\"" + filename +
+                     "\"\r\nContent-Type: text/plain\r\n\r\n" + content + "\r\n--XYZ--\r\n"};
+    return "POST /upload HTTP/1.1\r\nHost: lamp\r\nContent-Type: multipart/form-data; boundary=XYZ\r\n"
+           "Content-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+class Server
+{
+public:
+    Server()
+    {
+        auto file = Utils::FS::open("/file.txt", Utils::FS::OpenMode::kWrite);
+        std::string content{make_content(kFileSize)};
+        Utils::FS::write(file, reinterpret_cast<uint8_t const*>(content.data()), content.size());
+        Utils::FS::close(file);
+
+        for (uint16_t port = kFirstPort; port < kFirstPort + kNumOfPorts; ++port) {
+            server_.reset(new HttpServer{port, kNumOfClients + 1});
+            if (server_->begin()) {
+                port_ = port;
+                break;
+            }
+        }
+        CHECK(port_ != 0);
+
+        server_->on("/hello", HttpServer::Method::kGet,
+                    [this]() { server_->send(200, "text/plain", "Hello, " + server_->arg("name")); });
+        server_->on("/file.txt", HttpServer::Method::kGet, [this]() { stream("/file.txt"); });
+        server_->on("/file.txt", HttpServer::Method::kHead, [this]() { stream("/file.txt"); });
+        server_->on("/form", HttpServer::Method::kPost,
+                    [this]() { server_->send(200, "text/plain", server_->arg("a") + server_->arg("b")); });
+        server_->on(
+            "/upload", HttpServer::Method::kPost,
+            [this]() { server_->send(200, "text/plain", String{upload_filename_.c_str()} + ":" + upload_.c_str()); },
+            [this]() {
+                auto const& upload = server_->upload();
+                if (upload.status == HttpServer::UploadStatus::kStart) {
+                    upload_filename_ = upload.filename.c_str();
+                    upload_.clear();
+                }
+                else if (upload.status == HttpServer::UploadStatus::kWrite) {
+                    upload_.append(reinterpret_cast<char const*>(upload.buf), upload.current_size);
+                }
+            });
+        server_->on("/unseekable.txt", HttpServer::Method::kGet, [this]() {
+            Utils::FS::File file{std::make_shared<FaultyFile>(kFileSize, kFileSize, false)};
+            server_->send_header("ETag", "\"1\"");
+            server_->stream_file(file, "text/plain");
+        });
+        server_->on("/truncated.txt", HttpServer::Method::kGet, [this]() {
+            Utils::FS::File file{std::make_shared<FaultyFile>(kFileSize, kFileSize / 2, true)};
+            server_->stream_file(file, "text/plain");
+        });
+        server_->on_not_found([this]() { server_->send(404, "text/plain", "Not found"); });
+    }
+
+    uint16_t
+    port() const
+    {
+        return port_;
+    }
+
+    // Server works, while clients are running
+    void
+    run(std::vector<std::thread>& clients, std::atomic<int>& num_of_finished_clients)
+    {
+        while (num_of_finished_clients < static_cast<int>(clients.size())) {
+            server_->loop();
+            std::this_thread::yield();
+        }
+        for (auto& client : clients) {
+            client.join();
+        }
+    }
+
+private:
+    void
+    stream(String const& path)
+    {
+        auto file = Utils::FS::open(path);
+        server_->stream_file(file, "text/plain");
+    }
+
+    std::unique_ptr<HttpServer> server_;
+    uint16_t                    port_{0};
+    std::string                 upload_filename_;
+    std::string                 upload_;
+};
+
+// Run function in client thread, while server works
+template <typename Function>
+void
+run_client(Server& server, Function function)
+{
+    std::atomic<int>         num_of_finished_clients{0};
+    std::vector<std::thread> clients;
+    clients.emplace_back([&]() {
+        function();
+        ++num_of_finished_clients;
+    });
+    server.run(clients, num_of_finished_clients);
+}
+
+void
+test_requests(Server& server)
+{
+    std::vector<Response> responses(3);
+    Response              range;
+    Response              head;
+    Response              form;
+    Response              upload;
+    Response              not_found;
+    bool                  is_closed{false};
+    run_client(server, [&]() {
+        Client client;
+        client.connect(server.port());
+        // Pipelined requests are sent at once
+        client.write(get("/hello?name=1") + get("/hello?name=2") + get("/hello?name=3"));
+        for (auto& response : responses) {
+            client.read(response);
+        }
+        range = client.request(get("/file.txt", "Range: bytes=26-51\r\n"));
+        head  = client.request("HEAD /file.txt HTTP/1.1\r\nHost: lamp\r\n\r\n", true);
+        form  = client.request("POST /form HTTP/1.1\r\nHost: lamp\r\n"
+                              "Content-Type: application/x-www-form-urlencoded\r\nContent-Length: 7\r\n\r\na=1&b=2");
+        upload    = client.request(multipart_upload("a.txt", make_content(3000)));
+        not_found = client.request(get("/missing", "Connection: close\r\n"));
+        is_closed = client.is_closed_by_server();
+    });
+
+    for (size_t i = 0; i < responses.size(); ++i) {
+        CHECK(responses[i].code == 200);
+        CHECK(responses[i].body == "Hello, " + std::to_string(i + 1));
+        CHECK(!responses[i].is_closed);
+    }
+    CHECK(range.code == 206);
+    CHECK(range.body == make_content(26));
+    CHECK(range.head.find("Content-Range: bytes 26-51/10000\r\n") != std::string::npos);
+    CHECK(head.code == 200);
+    CHECK(head.head.find("Content-Length: 10000\r\n") != std::string::npos);
+    CHECK(form.body == "12");
+    CHECK(upload.body == "a.txt:" + make_content(3000));
+    CHECK(not_found.code == 404);
+    CHECK(not_found.is_closed);
+    CHECK(is_closed);
+}
+
+// Server replies 500, if requested part of file can not be reached, and closes connection, if file is shorter than
+// its head says
+void
+test_faulty_files(Server& server)
+{
+    Response      unseekable;
+    Response      hello;
+    Response      truncated;
+    bool          is_closed{false};
+    unsigned long close_time_us{0};
+    run_client(server, [&]() {
+        Client client;
+        client.connect(server.port());
+        unseekable = client.request(get("/unseekable.txt", "Range: bytes=100-199\r\n"));
+        hello      = client.request(get("/hello?name=after"));
+        unsigned long start_us{now_us()};
+        client.write(get("/truncated.txt"));
+        is_closed     = !client.read(truncated);  // Body is incomplete
+        close_time_us = now_us() - start_us;
+    });
+
+    CHECK(unseekable.code == 500);
+    CHECK(unseekable.head.find("ETag") == std::string::npos);
+    CHECK(unseekable.head.find("Content-Range") == std::string::npos);
+    CHECK(!unseekable.is_closed);
+    CHECK(hello.body == "Hello, after");
+    CHECK(truncated.code == 200);
+    CHECK(is_closed);
+    CHECK(close_time_us < kConnectionTimeoutUs);  // Connection is not just dropped as idle one
+}
+
+// Clients send requests one by one via persistent connections and reconnect, when server closes them. Slow client
+// occupies one more connection with incomplete request all the time
+void
+test_load(Server& server)
+{
+    std::string const  file_content{make_content(kFileSize)};
+    std::atomic<int>   num_of_failed_requests{0};
+    std::atomic<int>   num_of_finished_clients{0};
+    std::atomic<bool>  is_slow_client_connected{false};
+    std::vector<std::vector<unsigned long>> latencies_us(kNumOfClients);
+
+    Client slow_client;
+    std::vector<std::thread> clients;
+    clients.emplace_back([&]() {
+        slow_client.connect(server.port());
+        slow_client.write("GET /hello HTTP/1.1\r\n");
+        is_slow_client_connected = true;
+        ++num_of_finished_clients;
+    });
+    server.run(clients, num_of_finished_clients);
+    CHECK(is_slow_client_connected);
+
+    clients.clear();
+    num_of_finished_clients = 0;
+    unsigned long start_us{now_us()};
+    for (int i = 0; i < kNumOfClients; ++i) {
+        clients.emplace_back([&, i]() {
+            Client client;
+            bool   is_connected{false};
+            for (int request = 0; request < kNumOfRequestsPerClient; ++request) {
+                if (!is_connected) {
+                    is_connected = client.connect(server.port());
+                }
+                bool          is_file{request % 2 == 1};
+                unsigned long request_start_us{now_us()};
+                auto response = client.request(is_file ? get("/file.txt") : get("/hello?name=" + std::to_string(i)));
+                latencies_us[i].push_back(now_us() - request_start_us);
+                if ((response.code != 200) ||
+                    (response.body != (is_file ? file_content : "Hello, " + std::to_string(i)))) {
+                    ++num_of_failed_requests;
+                }
+                if (response.is_closed || (response.code == 0)) {
+                    client.disconnect();
+                    is_connected = false;
+                }
+            }
+            ++num_of_finished_clients;
+        });
+    }
+    server.run(clients, num_of_finished_clients);
+    unsigned long duration_us{now_us() - start_us};
+
+    CHECK(num_of_failed_requests == 0);
+    // Connection of slow client is not idle, so it is not closed, unless timeout is expired
+    CHECK(slow_client.is_waiting() || (duration_us >= kConnectionTimeoutUs));
+
+    std::vector<unsigned long> all_latencies_us;
+    for (auto const& client_latencies_us : latencies_us) {
+        all_latencies_us.insert(all_latencies_us.end(), client_latencies_us.begin(), client_latencies_us.end());
+    }
+    std::sort(all_latencies_us.begin(), all_latencies_us.end());
+    auto percentile = [&](size_t percent) { return all_latencies_us[(all_latencies_us.size() - 1) * percent / 100]; };
+    printf("%zu requests from %d clients in %.3f s, latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+           all_latencies_us.size(), kNumOfClients, duration_us / 1e6, percentile(50) / 1e3, percentile(99) / 1e3,
+           all_latencies_us.back() / 1e3);
+}
+
+}  // namespace
+
+unsigned long
+millis()
+{
+    return now_us() / 1000;
+}
+
+int
+main()
+{
+    CHECK(Utils::FS::begin());
+    Server server;
+    test_requests(server);
+    test_faulty_files(server);
+    test_load(server);
+    return Test::report("HttpServerLoadTest");
+}
@@ -0,0 +1,255 @@
+// Utils::OtaTask: firmware update from file on POSIX backend of Utils::FS and from HTTP mirror. Mirror is stand-in
+// HTTP/1.0 server in thread of test, which sends prepared reply. Task is thread of host (see host/freertos/task.h).
+// FirmwareUpdater is replaced by fake, which keeps written image. See run_host_tests.sh
+
+#include <ftw.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <lwip/sockets.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "src/Utils/FS.h"
+#include "src/Utils/FirmwareUpdater.h"
+#include "src/Utils/OtaTask.h"
+
+using Utils::OtaTask;
+
+namespace
+{
+constexpr size_t kImageSize{5000};  // Several receive buffers
+
+unsigned long now_ms{0};
+std::string   written_image;
+
+int
+remove_entry(char const* path, struct stat const*, int, FTW*)
+{
+    return ::remove(path);
+}
+
+void
+clear_root()
+{
+    nftw(FS_POSIX_ROOT, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+std::string
+make_image(size_t size)
+{
+    std::string image(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+        image[i] = static_cast<char>(i * 7);
+    }
+    return image;
+}
+
+// Accepts single connection, receives request and sends reply. Without reply port is only reserved: connection to it
+// is refused
+class Mirror
+{
+public:
+    Mirror()
+    {
+        listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family      = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port        = 0;  // Any free port
+        socklen_t address_size{sizeof(address)};
+        CHECK(bind(listen_socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+        CHECK(getsockname(listen_socket_, reinterpret_cast<sockaddr*>(&address), &address_size) == 0);
+        port_ = ntohs(address.sin_port);
+    }
+
+    ~Mirror()
+    {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        close(listen_socket_);
+    }
+
+    void
+    reply(std::string const& response)
+    {
+        CHECK(listen(listen_socket_, 1) == 0);
+        thread_ = std::thread{[this, response]() {
+            int  client{accept(listen_socket_, nullptr, nullptr)};
+            char buffer[1024];
+            while (request_.find("\r\n\r\n") == std::string::npos) {
+                auto size = recv(client, buffer, sizeof(buffer), 0);
+                if (size <= 0) {
+                    break;
+                }
+                request_.append(buffer, size);
+            }
+            send(client, response.data(), response.size(), MSG_NOSIGNAL);
+            close(client);
+        }};
+    }
+
+    std::string
+    get_url(std::string const& path) const
+    {
+        return "http://127.0.0.1:" + std::to_string(port_) + path;
+    }
+
+    // Wait till reply is sent
+    std::string const&
+    get_request()
+    {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        return request_;
+    }
+
+private:
+    int         listen_socket_{-1};
+    uint16_t    port_{0};
+    std::thread thread_;
+    std::string request_;
+};
+
+OtaTask::State
+wait_for_end(OtaTask const& ota_task)
+{
+    for (int i = 0; (i < 1000) && (ota_task.get_state() == OtaTask::State::kInProgress); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    return ota_task.get_state();
+}
+
+void
+test_update_from_file()
+{
+    std::string image{make_image(kImageSize)};
+    auto        file = Utils::FS::open("/firmware.bin", Utils::FS::OpenMode::kWrite);
+    Utils::FS::write(file, reinterpret_cast<uint8_t const*>(image.data()), image.size());
+    Utils::FS::close(file);
+
+    OtaTask ota_task;
+    CHECK(ota_task.start("/missing.bin", "") == "ERROR: file is not found: /missing.bin");
+    CHECK(ota_task.start("ftp://mirror/firmware.bin", "") == "ERROR: source should be path of file or http:// URL");
+    CHECK(ota_task.start("/firmware.bin", "") == "");
+    CHECK(wait_for_end(ota_task) == OtaTask::State::kDone);
+    CHECK(written_image == image);
+    CHECK(ota_task.get_progress_json() == "{\"state\":\"done\",\"bytes\":\"5000\",\"total\":\"5000\",\"error\":\"\"}");
+}
+
+void
+test_update_from_mirror()
+{
+    std::string image{make_image(kImageSize)};
+    Mirror      mirror;
+    mirror.reply("HTTP/1.0 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: 5000\r\n\r\n" + image);
+
+    OtaTask ota_task;
+    CHECK(ota_task.start(mirror.get_url("/build/firmware.bin").c_str(), "") == "");
+    CHECK(wait_for_end(ota_task) == OtaTask::State::kDone);
+    CHECK(written_image == image);
+    CHECK(ota_task.get_progress_json() == "{\"state\":\"done\",\"bytes\":\"5000\",\"total\":\"5000\",\"error\":\"\"}");
+    CHECK(mirror.get_request().find("GET /build/firmware.bin HTTP/1.0\r\n") == 0);
+}
+
+// Reply of mirror gets to progress JSON as text: quotes are escaped. Page shows it as text too (see settings.js)
+void
+test_mirror_error()
+{
+    Mirror mirror;
+    mirror.reply("HTTP/1.0 404 <img src=x onerror=\"alert(1)\">\r\n\r\n");
+
+    OtaTask ota_task;
+    CHECK(ota_task.start(mirror.get_url("/firmware.bin").c_str(), "") == "");
+    CHECK(wait_for_end(ota_task) == OtaTask::State::kFailed);
+    CHECK(ota_task.get_progress_json() == "{\"state\":\"failed\",\"bytes\":\"0\",\"total\":\"0\",\"error\":\"ERROR: "
+                                          "mirror replied 404 <img src=x onerror=\\\"alert(1)\\\">\"}");
+}
+
+void
+test_partial_image()
+{
+    Mirror mirror;
+    mirror.reply("HTTP/1.0 200 OK\r\nContent-Length: 5000\r\n\r\n" + make_image(kImageSize / 2));
+
+    OtaTask ota_task;
+    CHECK(ota_task.start(mirror.get_url("/firmware.bin").c_str(), "") == "");
+    CHECK(wait_for_end(ota_task) == OtaTask::State::kFailed);
+    CHECK(ota_task.get_progress_json() == "{\"state\":\"failed\",\"bytes\":\"2500\",\"total\":\"5000\","
+                                          "\"error\":\"ERROR: image is received partially\"}");
+}
+
+void
+test_mirror_is_not_running()
+{
+    Mirror      mirror;  // Does not listen
+    std::string url{mirror.get_url("/firmware.bin")};
+
+    OtaTask ota_task;
+    CHECK(ota_task.start(url.c_str(), "") == "");
+    CHECK(wait_for_end(ota_task) == OtaTask::State::kFailed);
+    CHECK(ota_task.get_progress_json().indexOf("ERROR: can not connect to 127.0.0.1:") != -1);
+}
+
+}  // namespace
+
+// Fake of FirmwareUpdater keeps image in RAM
+namespace Utils
+{
+FirmwareUpdater::~FirmwareUpdater() = default;
+
+String
+FirmwareUpdater::begin(size_t, String const&)
+{
+    written_image.clear();
+    is_active_ = true;
+    return String{};
+}
+
+String
+FirmwareUpdater::write(uint8_t const* data, size_t size)
+{
+    written_image.append(reinterpret_cast<char const*>(data), size);
+    return String{};
+}
+
+String
+FirmwareUpdater::end()
+{
+    is_active_ = false;
+    return String{};
+}
+
+void
+FirmwareUpdater::abort()
+{
+    is_active_ = false;
+}
+
+}  // namespace Utils
+
+unsigned long
+millis()
+{
+    return now_ms;
+}
+
+int
+main()
+{
+    clear_root();
+    CHECK(Utils::FS::begin());
+    test_update_from_file();
+    test_update_from_mirror();
+    test_mirror_error();
+    test_partial_image();
+    test_mirror_is_not_running();
+    return Test::report("OtaTaskTest");
+}
@@ -0,0 +1,19 @@
+#ifndef TEST_HOST_ARDUINO_H_
+#define TEST_HOST_ARDUINO_H_
+
+// Part of Arduino core, which is used by modules under test. Time is controlled by test
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "HardwareSerial.h"
+#include "WString.h"
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define DEC 10
+#define HEX 16
+
+unsigned long millis();
+unsigned long micros();
+
+#endif  // TEST_HOST_ARDUINO_H_
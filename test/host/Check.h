@@ -0,0 +1,37 @@
+#ifndef TEST_HOST_CHECK_H_
+#define TEST_HOST_CHECK_H_
+
+#include <stdio.h>
+
+// Minimal checks for host tests. Test fails (main() returns non-zero), if any check fails
+#define CHECK(condition) Test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace Test
+{
+inline int&
+num_of_failures()
+{
+    static int num_of_failures{0};
+    return num_of_failures;
+}
+
+inline bool
+check(bool condition, char const* text, char const* file, int line)
+{
+    if (!condition) {
+        printf("FAILED: %s (%s:%d)\n", text, file, line);
+        ++num_of_failures();
+    }
+    return condition;
+}
+
+inline int
+report(char const* test_name)
+{
+    printf("%s: %s\n", test_name, (num_of_failures() == 0) ? "PASSED" : "FAILED");
+    return (num_of_failures() == 0) ? 0 : 1;
+}
+
+}  // namespace Test
+
+#endif  // TEST_HOST_CHECK_H_
@@ -0,0 +1,18 @@
+#ifndef TEST_HOST_DS1307RTC_H_
+#define TEST_HOST_DS1307RTC_H_
+
+#include <time.h>
+
+#include "TimeLib.h"
+
+// Interface of DS1307RTC. Test implements it by simulated RTC
+class DS1307RTC
+{
+public:
+    static time_t get();  // 0 in case of error
+    static bool   set(time_t time);
+};
+
+extern DS1307RTC RTC;
+
+#endif  // TEST_HOST_DS1307RTC_H_
@@ -0,0 +1,179 @@
+#ifndef TEST_HOST_FS_H_
+#define TEST_HOST_FS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "Arduino.h"  // As in Arduino core
+#include "FSImpl.h"
+#include "WString.h"
+
+// fs::FS and fs::File of Arduino core. They only forward calls to implementation (see FSImpl.h), so modules under test
+// work with the same objects, as on ESP32
+namespace fs
+{
+class File
+{
+public:
+    File(FileImplPtr impl = FileImplPtr{})
+      : impl_{impl}
+    {
+    }
+
+    size_t
+    write(uint8_t const* buf, size_t size)
+    {
+        return impl_ ? impl_->write(buf, size) : 0;
+    }
+    size_t
+    write(uint8_t c)
+    {
+        return write(&c, 1);
+    }
+    size_t
+    read(uint8_t* buf, size_t size)
+    {
+        return impl_ ? impl_->read(buf, size) : 0;
+    }
+    int
+    read()
+    {
+        uint8_t c;
+        return (read(&c, 1) == 1) ? c : -1;
+    }
+    size_t
+    readBytes(char* buffer, size_t length)
+    {
+        return read(reinterpret_cast<uint8_t*>(buffer), length);
+    }
+    int
+    available()
+    {
+        return impl_ ? static_cast<int>(impl_->size() - impl_->position()) : 0;
+    }
+    void
+    flush()
+    {
+        if (impl_) {
+            impl_->flush();
+        }
+    }
+    bool
+    seek(uint32_t pos, SeekMode mode)
+    {
+        return impl_ && impl_->seek(pos, mode);
+    }
+    bool
+    seek(uint32_t pos)
+    {
+        return seek(pos, SeekSet);
+    }
+    size_t
+    position() const
+    {
+        return impl_ ? impl_->position() : 0;
+    }
+    size_t
+    size() const
+    {
+        return impl_ ? impl_->size() : 0;
+    }
+    void
+    close()
+    {
+        if (impl_) {
+            impl_->close();
+            impl_ = nullptr;
+        }
+    }
+    operator bool() const
+    {
+        return impl_ && *impl_;
+    }
+    time_t
+    getLastWrite()
+    {
+        return impl_ ? impl_->getLastWrite() : 0;
+    }
+    char const*
+    name() const
+    {
+        return impl_ ? impl_->name() : nullptr;
+    }
+    bool
+    isDirectory()
+    {
+        return impl_ && impl_->isDirectory();
+    }
+    File
+    openNextFile(char const* mode = "r")
+    {
+        return impl_ ? File{impl_->openNextFile(mode)} : File{};
+    }
+    void
+    rewindDirectory()
+    {
+        if (impl_) {
+            impl_->rewindDirectory();
+        }
+    }
+
+private:
+    FileImplPtr impl_;
+};
+
+class FS
+{
+public:
+    FS(FSImplPtr impl)
+      : impl_{impl}
+    {
+    }
+
+    File
+    open(char const* path, char const* mode = "r")
+    {
+        return File{impl_->open(path, mode)};
+    }
+    File
+    open(String const& path, char const* mode = "r")
+    {
+        return open(path.c_str(), mode);
+    }
+    bool
+    exists(String const& path)
+    {
+        return impl_->exists(path.c_str());
+    }
+    bool
+    remove(String const& path)
+    {
+        return impl_->remove(path.c_str());
+    }
+    bool
+    rename(String const& path_from, String const& path_to)
+    {
+        return impl_->rename(path_from.c_str(), path_to.c_str());
+    }
+    bool
+    mkdir(String const& path)
+    {
+        return impl_->mkdir(path.c_str());
+    }
+    bool
+    rmdir(String const& path)
+    {
+        return impl_->rmdir(path.c_str());
+    }
+
+private:
+    FSImplPtr impl_;
+};
+
+}  // namespace fs
+
+using fs::File;
+using fs::FS;
+
+#endif  // TEST_HOST_FS_H_
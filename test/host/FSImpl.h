@@ -0,0 +1,60 @@
+#ifndef TEST_HOST_FSIMPL_H_
+#define TEST_HOST_FSIMPL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <memory>
+
+// Interfaces of implementation of fs::FS and fs::File, as in FSImpl.h of Arduino core
+namespace fs
+{
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+using FileImplPtr = std::shared_ptr<FileImpl>;
+
+class FileImpl
+{
+public:
+    virtual ~FileImpl() = default;
+
+    virtual size_t      write(uint8_t const* buf, size_t size) = 0;
+    virtual size_t      read(uint8_t* buf, size_t size)        = 0;
+    virtual void        flush()                                = 0;
+    virtual bool        seek(uint32_t pos, SeekMode mode)      = 0;
+    virtual size_t      position() const                       = 0;
+    virtual size_t      size() const                           = 0;
+    virtual void        close()                                = 0;
+    virtual time_t      getLastWrite()                         = 0;
+    virtual char const* name() const                           = 0;
+    virtual bool        isDirectory()                          = 0;
+    virtual FileImplPtr openNextFile(char const* mode)         = 0;
+    virtual void        rewindDirectory()                      = 0;
+    virtual             operator bool()                        = 0;
+};
+
+class FSImpl
+{
+public:
+    virtual ~FSImpl() = default;
+
+    virtual FileImplPtr open(char const* path, char const* mode)           = 0;
+    virtual bool        exists(char const* path)                           = 0;
+    virtual bool        rename(char const* path_from, char const* path_to) = 0;
+    virtual bool        remove(char const* path)                           = 0;
+    virtual bool        mkdir(char const* path)                            = 0;
+    virtual bool        rmdir(char const* path)                            = 0;
+};
+
+using FSImplPtr = std::shared_ptr<FSImpl>;
+
+}  // namespace fs
+
+#endif  // TEST_HOST_FSIMPL_H_
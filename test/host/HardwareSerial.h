@@ -0,0 +1,26 @@
+#ifndef TEST_HOST_HARDWARESERIAL_H_
+#define TEST_HOST_HARDWARESERIAL_H_
+
+#include <stdio.h>
+
+#include "WString.h"
+
+// Logs of modules under test go to stdout
+class HardwareSerial
+{
+public:
+    void
+    print(String const& message)
+    {
+        fputs(message.c_str(), stdout);
+    }
+    void
+    println(String const& message)
+    {
+        puts(message.c_str());
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif  // TEST_HOST_HARDWARESERIAL_H_
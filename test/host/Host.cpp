@@ -0,0 +1,3 @@
+#include "HardwareSerial.h"
+
+HardwareSerial Serial;
@@ -0,0 +1,22 @@
+#ifndef TEST_HOST_TIMELIB_H_
+#define TEST_HOST_TIMELIB_H_
+
+#include <stdint.h>
+#include <time.h>
+
+// Part of TimeLib (https://github.com/PaulStoffregen/Time), which is used by modules under test
+struct tmElements_t
+{
+    uint8_t Second;
+    uint8_t Minute;
+    uint8_t Hour;
+    uint8_t Wday;  // Day of week, Sunday is day 1
+    uint8_t Day;
+    uint8_t Month;
+    uint8_t Year;  // Offset from 1970
+};
+
+#define CalendarYrToTm(Y) ((Y)-1970)
+#define tmYearToCalendar(Y) ((Y) + 1970)
+
+#endif  // TEST_HOST_TIMELIB_H_
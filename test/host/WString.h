@@ -0,0 +1,244 @@
+#ifndef TEST_HOST_WSTRING_H_
+#define TEST_HOST_WSTRING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <string>
+
+// Arduino String over std::string. Only functions, which are used by modules under test
+class String
+{
+public:
+    String() = default;
+    String(char const* str)
+      : str_{(str != nullptr) ? str : ""}
+    {
+    }
+    explicit String(char c)
+      : str_(1, c)
+    {
+    }
+    explicit String(int value, unsigned char base = 10)
+      : str_{to_string(value, base)}
+    {
+    }
+    explicit String(unsigned int value, unsigned char base = 10)
+      : str_{to_string(value, base)}
+    {
+    }
+    explicit String(long value, unsigned char base = 10)
+      : str_{to_string(value, base)}
+    {
+    }
+    explicit String(unsigned long value, unsigned char base = 10)
+      : str_{to_string(value, base)}
+    {
+    }
+    explicit String(double value, unsigned char decimal_places = 2)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimal_places, value);
+        str_ = buffer;
+    }
+
+    char const*
+    c_str() const
+    {
+        return str_.c_str();
+    }
+    unsigned int
+    length() const
+    {
+        return str_.length();
+    }
+    bool
+    isEmpty() const
+    {
+        return str_.empty();
+    }
+    bool
+    reserve(unsigned int size)
+    {
+        str_.reserve(size);
+        return true;
+    }
+    void
+    clear()
+    {
+        str_.clear();
+    }
+
+    char
+    operator[](unsigned int index) const
+    {
+        return (index < str_.length()) ? str_[index] : '\0';
+    }
+    char&
+    operator[](unsigned int index)
+    {
+        return str_[index];
+    }
+
+    String&
+    operator+=(String const& other)
+    {
+        str_ += other.str_;
+        return *this;
+    }
+    String&
+    operator+=(char const* other)
+    {
+        str_ += (other != nullptr) ? other : "";
+        return *this;
+    }
+    String&
+    operator+=(char c)
+    {
+        str_ += c;
+        return *this;
+    }
+    friend String
+    operator+(String left, String const& right)
+    {
+        return left += right;
+    }
+    friend String
+    operator+(String left, char const* right)
+    {
+        return left += right;
+    }
+    friend String
+    operator+(char const* left, String const& right)
+    {
+        return String{left} += right;
+    }
+    friend String
+    operator+(String left, char right)
+    {
+        return left += right;
+    }
+    bool
+    operator==(String const& other) const
+    {
+        return str_ == other.str_;
+    }
+    bool
+    operator!=(String const& other) const
+    {
+        return str_ != other.str_;
+    }
+    bool
+    operator<(String const& other) const
+    {
+        return str_ < other.str_;
+    }
+
+    bool
+    equalsIgnoreCase(String const& other) const
+    {
+        return (str_.length() == other.str_.length()) && (strcasecmp(str_.c_str(), other.str_.c_str()) == 0);
+    }
+    bool
+    startsWith(String const& prefix) const
+    {
+        return str_.compare(0, prefix.str_.length(), prefix.str_) == 0;
+    }
+    bool
+    endsWith(String const& suffix) const
+    {
+        return (str_.length() >= suffix.str_.length()) &&
+               (str_.compare(str_.length() - suffix.str_.length(), suffix.str_.length(), suffix.str_) == 0);
+    }
+    int
+    indexOf(char c, unsigned int from = 0) const
+    {
+        return to_index(str_.find(c, from));
+    }
+    int
+    indexOf(String const& str, unsigned int from = 0) const
+    {
+        return to_index(str_.find(str.str_, from));
+    }
+    int
+    lastIndexOf(char c) const
+    {
+        return to_index(str_.rfind(c));
+    }
+    int
+    lastIndexOf(String const& str) const
+    {
+        return to_index(str_.rfind(str.str_));
+    }
+    String
+    substring(unsigned int from) const
+    {
+        return (from < str_.length()) ? String{str_.substr(from).c_str()} : String{};
+    }
+    String
+    substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to) {
+            std::swap(from, to);
+        }
+        return (from < str_.length()) ? String{str_.substr(from, to - from).c_str()} : String{};
+    }
+    void
+    remove(unsigned int index)
+    {
+        if (index < str_.length()) {
+            str_.erase(index);
+        }
+    }
+    void
+    remove(unsigned int index, unsigned int count)
+    {
+        if (index < str_.length()) {
+            str_.erase(index, count);
+        }
+    }
+    void
+    trim()
+    {
+        size_t first{str_.find_first_not_of(" \t\r\n")};
+        if (first == std::string::npos) {
+            str_.clear();
+            return;
+        }
+        str_ = str_.substr(first, str_.find_last_not_of(" \t\r\n") - first + 1);
+    }
+    void
+    toLowerCase()
+    {
+        std::transform(str_.begin(), str_.end(), str_.begin(), ::tolower);
+    }
+    long
+    toInt() const
+    {
+        return strtol(str_.c_str(), nullptr, 10);
+    }
+
+private:
+    template <typename T>
+    static std::string
+    to_string(T value, unsigned char base)
+    {
+        if (base == 10) {
+            return std::to_string(value);
+        }
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), (base == 16) ? "%lx" : "%lo", static_cast<unsigned long>(value));
+        return buffer;
+    }
+    static int
+    to_index(size_t position)
+    {
+        return (position == std::string::npos) ? -1 : static_cast<int>(position);
+    }
+
+    std::string str_;
+};
+
+#endif  // TEST_HOST_WSTRING_H_
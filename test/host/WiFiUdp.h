@@ -0,0 +1,23 @@
+#ifndef TEST_HOST_WIFIUDP_H_
+#define TEST_HOST_WIFIUDP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Arduino.h"
+
+// Interface of WiFiUDP. Test implements it by stand-in of remote server
+class WiFiUDP
+{
+public:
+    uint8_t begin(uint16_t port);
+    void    stop();
+    int     beginPacket(char const* host, uint16_t port);
+    size_t  write(uint8_t const* buffer, size_t size);
+    int     endPacket();
+    int     parsePacket();
+    int     read(uint8_t* buffer, size_t size);
+    void    flush();
+};
+
+#endif  // TEST_HOST_WIFIUDP_H_
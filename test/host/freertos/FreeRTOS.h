@@ -0,0 +1,13 @@
+#ifndef TEST_HOST_FREERTOS_FREERTOS_H_
+#define TEST_HOST_FREERTOS_FREERTOS_H_
+
+#include <stdint.h>
+
+// Types of FreeRTOS, which are used by modules under test
+typedef void*    TaskHandle_t;
+typedef unsigned UBaseType_t;
+typedef int      BaseType_t;
+
+#define pdPASS 1
+
+#endif  // TEST_HOST_FREERTOS_FREERTOS_H_
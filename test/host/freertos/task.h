@@ -0,0 +1,25 @@
+#ifndef TEST_HOST_FREERTOS_TASK_H_
+#define TEST_HOST_FREERTOS_TASK_H_
+
+#include <thread>
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+// Task is detached thread of host. Stack size, priority and core are ignored
+inline BaseType_t
+xTaskCreatePinnedToCore(TaskFunction_t function, char const*, uint32_t, void* parameters, UBaseType_t, TaskHandle_t*,
+                        BaseType_t)
+{
+    std::thread{function, parameters}.detach();
+    return pdPASS;
+}
+
+// Task deletes itself at the end of its function, then thread ends, when function returns
+inline void
+vTaskDelete(TaskHandle_t)
+{
+}
+
+#endif  // TEST_HOST_FREERTOS_TASK_H_
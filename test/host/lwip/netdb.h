@@ -0,0 +1,7 @@
+#ifndef TEST_HOST_LWIP_NETDB_H_
+#define TEST_HOST_LWIP_NETDB_H_
+
+// Resolving of names by lwIP has the same API as on host
+#include <netdb.h>
+
+#endif  // TEST_HOST_LWIP_NETDB_H_
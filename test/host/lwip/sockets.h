@@ -0,0 +1,13 @@
+#ifndef TEST_HOST_LWIP_SOCKETS_H_
+#define TEST_HOST_LWIP_SOCKETS_H_
+
+// BSD sockets API of lwIP is the same as of host, so modules under test work with sockets of host
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif  // TEST_HOST_LWIP_SOCKETS_H_
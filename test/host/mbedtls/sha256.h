@@ -0,0 +1,10 @@
+#ifndef TEST_HOST_MBEDTLS_SHA256_H_
+#define TEST_HOST_MBEDTLS_SHA256_H_
+
+// Only type of context, which is member of modules under test. Their code, which calculates SHA-256, is replaced by
+// fakes in tests
+struct mbedtls_sha256_context
+{
+};
+
+#endif  // TEST_HOST_MBEDTLS_SHA256_H_
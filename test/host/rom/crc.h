@@ -0,0 +1,21 @@
+#ifndef TEST_HOST_ROM_CRC_H_
+#define TEST_HOST_ROM_CRC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// CRC32 of ESP32 ROM: crc32_le(0, data, size) is standard CRC-32 (IEEE 802.3), previous result continues calculation
+inline uint32_t
+crc32_le(uint32_t crc, uint8_t const* buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; ++i) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#endif  // TEST_HOST_ROM_CRC_H_
@@ -0,0 +1,8 @@
+#ifndef TEST_HOST_ROM_MINIZ_H_
+#define TEST_HOST_ROM_MINIZ_H_
+
+// Only type of inflater of ESP32 ROM, which is member of modules under test. Their code, which decompresses data, is
+// replaced by fakes in tests
+typedef struct tinfl_decompressor_tag tinfl_decompressor;
+
+#endif  // TEST_HOST_ROM_MINIZ_H_
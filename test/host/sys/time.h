@@ -0,0 +1,15 @@
+#ifndef TEST_HOST_SYS_TIME_H_
+#define TEST_HOST_SYS_TIME_H_
+
+#include_next <sys/time.h>
+
+// Modules under test work with simulated system clock, implemented by test, instead of clock of host
+int host_gettimeofday(timeval* time_value, void* time_zone);
+int host_settimeofday(timeval const* time_value, void const* time_zone);
+int host_adjtime(timeval const* delta, timeval* old_delta);
+
+#define gettimeofday host_gettimeofday
+#define settimeofday host_settimeofday
+#define adjtime host_adjtime
+
+#endif  // TEST_HOST_SYS_TIME_H_
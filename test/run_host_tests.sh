@@ -0,0 +1,48 @@
+#!/bin/sh
+# Builds and runs tests of hardware independent modules on host (Linux, g++). Arduino and ESP32 APIs, which these
+# modules use, are replaced by shims from test/host or by fakes, defined in test itself.
+# Usage: test/run_host_tests.sh [--benchmark]
+
+set -e
+
+if [ "$1" = "--benchmark" ]; then
+    BENCHMARK=1
+fi
+
+REPO_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-/tmp/sad_lamp_host_tests}
+CXXFLAGS="-std=gnu++11 -g -Wall -Wextra -fsanitize=address,undefined -fno-sanitize-recover=all"
+# Utils::FS works in directory of host (see PosixFs.h)
+FS_FLAGS="-DFS_BACKEND_POSIX -DFS_POSIX_ROOT=\"$BUILD_DIR/fs_root\""
+FS_SOURCES="src/Utils/FS.cpp src/Utils/PathIndex.cpp src/Utils/FsBackend.cpp src/Utils/PosixFs.cpp"
+mkdir -p "$BUILD_DIR"
+
+# run_test <name> <flags and sources...>. Output of test is shown only if it fails
+run_test() {
+    name=$1
+    shift
+    (cd "$REPO_DIR" && g++ $CXXFLAGS -Itest/host -I. -o "$BUILD_DIR/$name" "test/$name.cpp" test/host/Host.cpp "$@")
+    if "$BUILD_DIR/$name" > "$BUILD_DIR/$name.log" 2>&1; then
+        tail -n 1 "$BUILD_DIR/$name.log"
+    else
+        cat "$BUILD_DIR/$name.log"
+        exit 1
+    fi
+}
+
+run_test ClockServiceTest src/Control/ClockService.cpp
+run_test DateTimeTest src/Utils/DateTime.cpp
+run_test FsTest $FS_FLAGS $FS_SOURCES src/Utils/FsBenchmark.cpp
+run_test ETagIndexTest $FS_FLAGS $FS_SOURCES src/Servers/ETagIndex.cpp
+run_test HttpServerLoadTest -pthread $FS_FLAGS $FS_SOURCES src/Servers/HttpServer.cpp
+run_test OtaTaskTest -pthread $FS_FLAGS $FS_SOURCES src/Utils/OtaTask.cpp
+
+# Benchmark is built with optimization and without sanitizers
+if [ -n "$BENCHMARK" ]; then
+    (cd "$REPO_DIR" && g++ -std=gnu++11 -O2 -Itest/host -I. -o "$BUILD_DIR/DateTimeBenchmark" test/DateTimeTest.cpp \
+        test/host/Host.cpp src/Utils/DateTime.cpp)
+    "$BUILD_DIR/DateTimeBenchmark" --benchmark
+    (cd "$REPO_DIR" && g++ -std=gnu++11 -O2 $FS_FLAGS -Itest/host -I. -o "$BUILD_DIR/FsBenchmark" test/FsTest.cpp \
+        test/host/Host.cpp $FS_SOURCES src/Utils/FsBenchmark.cpp)
+    "$BUILD_DIR/FsBenchmark" --benchmark
+fi
@@ -0,0 +1,171 @@
+#!/usr/bin/env python3
+"""Make delta patch between two firmware images of SAD-Lamp for OTA update.
+
+Lamp, which runs <old.bin>, applies patch to its running firmware and gets <new.bin> (see src/Utils/DeltaPatcher.h).
+Patch is bsdiff-like: new firmware is described by parts of old firmware (with byte-wise differences, which are mostly
+zeros) and by bytes, which are absent in old firmware. Patch is compressed by gzip, so usually it takes several kB,
+when only several functions are changed.
+
+Patch is uploaded the same way as firmware (Settings page or POST /update). Lamp checks SHA-256 of its running
+firmware before update and SHA-256 of new firmware after it, so patch can not break lamp with another firmware.
+Patch is verified by applying it to <old.bin> before it is written.
+
+Usage:
+    make_firmware_delta.py <old.bin> <new.bin> <delta.bin.gz>
+"""
+
+import gzip
+import hashlib
+import struct
+import sys
+
+MAGIC = b"SLDP"
+FORMAT_VERSION = 1
+HEADER_FORMAT = "<4sHHI32sI32s"
+CONTROL_FORMAT = "<IIi"
+SEED_SIZE = 8  # Exact match of this size starts search of new part of old firmware
+MIN_MATCH_SIZE = 16  # Shorter matches are not worth new record
+
+
+def build_index(old):
+    """Position of the first occurrence of every seed in old firmware."""
+    index = {}
+    for position in range(len(old) - SEED_SIZE + 1):
+        index.setdefault(old[position:position + SEED_SIZE], position)
+    return index
+
+
+def match_size(old, old_position, new, new_position):
+    size = 0
+    while (old_position + size < len(old) and new_position + size < len(new) and
+           old[old_position + size] == new[new_position + size]):
+        size += 1
+    return size
+
+
+def forward_extension(old, old_position, new, new_position, limit):
+    """Size of approximate match from the given positions: more than a half of bytes are equal."""
+    score = best_score = best_size = 0
+    for i in range(min(limit, len(old) - old_position)):
+        if old[old_position + i] == new[new_position + i]:
+            score += 1
+        if score * 2 - (i + 1) > best_score * 2 - best_size:
+            best_score = score
+            best_size = i + 1
+    return best_size
+
+
+def backward_extension(old, old_position, new, new_position, limit):
+    """Size of approximate match, which ends right before the given positions."""
+    score = best_score = best_size = 0
+    for i in range(1, min(limit, old_position) + 1):
+        if old[old_position - i] == new[new_position - i]:
+            score += 1
+        if score * 2 - i > best_score * 2 - best_size:
+            best_score = score
+            best_size = i
+    return best_size
+
+
+def make_records(old, new):
+    """Return list of (diff, extra, seek) records, as they are described in src/Utils/DeltaPatcher.h."""
+    index = build_index(old)
+    records = []
+    scan = last_scan = last_position = 0
+    while scan < len(new):
+        # Part, which continues the current part of old firmware, is covered by forward extension of the last record
+        continuation = last_position + (scan - last_scan)
+        seed = new[scan:scan + SEED_SIZE]
+        if old[continuation:continuation + SEED_SIZE] == seed and len(seed) == SEED_SIZE:
+            scan += match_size(old, continuation, new, scan)
+            continue
+        position = index.get(seed)
+        size = match_size(old, position, new, scan) if position is not None else 0
+        if size < MIN_MATCH_SIZE:
+            scan += 1
+            continue
+
+        forward_size = forward_extension(old, last_position, new, last_scan, scan - last_scan)
+        backward_size = backward_extension(old, position, new, scan, scan - last_scan)
+        overlap = last_scan + forward_size - (scan - backward_size)
+        if overlap > 0:
+            # Split overlapped bytes between records, so that more bytes match
+            score = best_score = split = 0
+            for i in range(overlap):
+                if new[last_scan + forward_size - overlap + i] == old[last_position + forward_size - overlap + i]:
+                    score += 1
+                if new[scan - backward_size + i] == old[position - backward_size + i]:
+                    score -= 1
+                if score > best_score:
+                    best_score = score
+                    split = i + 1
+            forward_size += split - overlap
+            backward_size -= split
+
+        diff = bytes((new[last_scan + i] - old[last_position + i]) & 0xFF for i in range(forward_size))
+        extra = new[last_scan + forward_size:scan - backward_size]
+        seek = (position - backward_size) - (last_position + forward_size)
+        records.append((diff, extra, seek))
+        last_scan = scan - backward_size
+        last_position = position - backward_size
+        scan += size
+
+    forward_size = forward_extension(old, last_position, new, last_scan, len(new) - last_scan)
+    diff = bytes((new[last_scan + i] - old[last_position + i]) & 0xFF for i in range(forward_size))
+    records.append((diff, new[last_scan + forward_size:], 0))
+    return records
+
+
+def make_patch(old, new):
+    header = struct.pack(HEADER_FORMAT, MAGIC, FORMAT_VERSION, 0, len(old), hashlib.sha256(old).digest(), len(new),
+                         hashlib.sha256(new).digest())
+    body = b"".join(struct.pack(CONTROL_FORMAT, len(diff), len(extra), seek) + diff + extra
+                    for diff, extra, seek in make_records(old, new))
+    return header + body
+
+
+def apply_patch(old, patch):
+    """The same as lamp does. Is used to verify patch."""
+    magic, version, _, old_size, old_sha256, new_size, new_sha256 = struct.unpack_from(HEADER_FORMAT, patch)
+    if magic != MAGIC or version != FORMAT_VERSION:
+        raise ValueError("unsupported format of patch")
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_sha256:
+        raise ValueError("patch is made for another firmware")
+    new = bytearray()
+    offset = struct.calcsize(HEADER_FORMAT)
+    position = 0
+    while len(new) < new_size:
+        diff_size, extra_size, seek = struct.unpack_from(CONTROL_FORMAT, patch, offset)
+        offset += struct.calcsize(CONTROL_FORMAT)
+        if position < 0 or position + diff_size > len(old):
+            raise ValueError("patch is corrupted")
+        new += bytes((old[position + i] + patch[offset + i]) & 0xFF for i in range(diff_size))
+        offset += diff_size
+        new += patch[offset:offset + extra_size]
+        offset += extra_size
+        position += diff_size + seek
+    if len(new) != new_size or hashlib.sha256(new).digest() != new_sha256:
+        raise ValueError("patch is corrupted")
+    return bytes(new)
+
+
+def main(args):
+    if len(args) != 4:
+        sys.exit(__doc__)
+    with open(args[1], "rb") as file:
+        old = file.read()
+    with open(args[2], "rb") as file:
+        new = file.read()
+
+    patch = make_patch(old, new)
+    if apply_patch(old, patch) != new:
+        sys.exit("ERROR: patch does not reproduce new firmware")
+    compressed_patch = gzip.compress(patch, 9)
+    print("Old firmware: {} bytes, new firmware: {} bytes, patch: {} bytes".format(len(old), len(new),
+                                                                                     len(compressed_patch)))
+    with open(args[3], "wb") as file:
+        file.write(compressed_patch)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Pack web UI files of SAD-Lamp into read-only image for "assets" flash partition.
+
+Files from <data_dir> are compressed the same way as by pack_web_assets.py and are written to single indexed image
+(format is described in src/Servers/AssetPack.h). Web server sends files right from memory-mapped partition, without
+access to SPIFFS. File, uploaded to SPIFFS (ex. via editor), overrides file with the same path in image, so image does
+not need to be rewritten to try changes.
+
+Image is written to partition by esptool (offset of partition is in partitions.csv):
+    esptool.py --chip esp32 write_flash 0x290000 assets.bin
+
+Usage:
+    pack_asset_image.py [--keep-original] [--size <partition_size>] <data_dir> <assets.bin>
+"""
+
+import binascii
+import os
+import struct
+import sys
+
+from pack_web_assets import make_variants
+
+MAGIC = b"SLAP"
+FORMAT_VERSION = 1
+HEADER_FORMAT = "<4sHHII"
+FILE_ENTRY_FORMAT = "<IIIII"
+CONTENT_ALIGNMENT = 4
+DEFAULT_PARTITION_SIZE = 0x40000  # Must be in sync with partitions.csv
+
+
+def fnv1a_hash(path):
+    hash_value = 2166136261
+    for byte in path.encode():
+        hash_value = ((hash_value ^ byte) * 16777619) & 0xFFFFFFFF
+    return hash_value
+
+
+def align(offset):
+    return (offset + CONTENT_ALIGNMENT - 1) // CONTENT_ALIGNMENT * CONTENT_ALIGNMENT
+
+
+def build_image(files):
+    """files: list of (path, content). Return image as bytes."""
+    files = sorted(files, key=lambda file: (fnv1a_hash(file[0]), file[0]))
+    if len(files) > 0xFFFF:
+        raise ValueError("too many files")
+
+    paths_offset = struct.calcsize(HEADER_FORMAT) + len(files) * struct.calcsize(FILE_ENTRY_FORMAT)
+    paths = b"".join(path.encode() + b"\0" for path, _ in files)
+    contents = bytearray()
+    contents_offset = align(paths_offset + len(paths))
+    entries = bytearray()
+    path_offset = paths_offset
+    for path, content in files:
+        content_offset = contents_offset + len(contents)
+        entries += struct.pack(FILE_ENTRY_FORMAT, fnv1a_hash(path), path_offset, content_offset, len(content),
+                               binascii.crc32(content))
+        path_offset += len(path.encode()) + 1
+        contents += content
+        contents += b"\0" * (align(len(contents)) - len(contents))
+
+    body = bytes(entries) + paths + b"\0" * (contents_offset - paths_offset - len(paths)) + bytes(contents)
+    image_size = struct.calcsize(HEADER_FORMAT) + len(body)
+    return struct.pack(HEADER_FORMAT, MAGIC, FORMAT_VERSION, len(files), image_size, binascii.crc32(body)) + body
+
+
+def main(args):
+    keep_original = "--keep-original" in args
+    args = [arg for arg in args[1:] if arg != "--keep-original"]
+    partition_size = DEFAULT_PARTITION_SIZE
+    if len(args) == 4 and args[0] == "--size":
+        partition_size = int(args[1], 0)
+        args = args[2:]
+    if len(args) != 2:
+        sys.exit(__doc__)
+    data_dir, image_path = args
+
+    files = []
+    for root, _, names in os.walk(data_dir):
+        for name in sorted(names):
+            source = os.path.join(root, name)
+            with open(source, "rb") as file:
+                data = file.read()
+            path = "/" + os.path.relpath(source, data_dir).replace(os.sep, "/")
+            files += make_variants(path, data, keep_original)
+
+    image = build_image(files)
+    for path, content in sorted(files):
+        print("{:>8} {}".format(len(content), path))
+    print("Image size: {} of {} bytes".format(len(image), partition_size))
+    if len(image) > partition_size:
+        sys.exit("ERROR: image does not fit partition")
+    with open(image_path, "wb") as file:
+        file.write(image)
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Produce precompressed variants of web UI files for SPIFFS image of SAD-Lamp.
+
+Every compressible file from <data_dir> is written to <out_dir> as "<name>.br" (if brotli is available) and
+"<name>.gz". Web server chooses variant, which is accepted by browser (see SadLampWebServer::handle_file_read()).
+Variant is written only if it is smaller than original file. Original file is written only if it is not compressible,
+if no variant is smaller than it, or if --keep-original is set (to serve clients, which accept neither brotli, nor
+gzip). Files, which are already compressed (ex. edit.htm.gz), are copied as is.
+
+Brotli is taken from python module "brotli" or from "brotli" command line tool. If neither is available, only gzip
+variants are produced. Module is installed from PyPI, it is not part of the repository:
+    pip install brotli
+
+Usage:
+    pack_web_assets.py [--keep-original] <data_dir> <out_dir>
+"""
+
+import gzip
+import os
+import shutil
+import subprocess
+import sys
+
+COMPRESSIBLE_EXTENSIONS = (".htm", ".html", ".css", ".js", ".json", ".xml", ".svg", ".txt", ".ico")
+
+try:
+    import brotli
+except ImportError:
+    brotli = None
+
+
+def compress_gzip(data):
+    # mtime=0 makes output reproducible, so ETags do not change without reason
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def compress_brotli(data):
+    if brotli is not None:
+        return brotli.compress(data, quality=11)
+    if shutil.which("brotli") is not None:
+        return subprocess.run(["brotli", "--best", "--stdout", "-"], input=data, stdout=subprocess.PIPE,
+                              check=True).stdout
+    return None
+
+
+def make_variants(name, data, keep_original):
+    """Return list of (name, content) of files, which should be stored instead of given one."""
+    if not name.endswith(COMPRESSIBLE_EXTENSIONS):
+        return [(name, data)]
+
+    variants = []
+    for extension, compress in ((".br", compress_brotli), (".gz", compress_gzip)):
+        compressed = compress(data)
+        if compressed is not None and len(compressed) < len(data):
+            variants.append((name + extension, compressed))
+    if keep_original or not variants:
+        variants.append((name, data))
+    return variants
+
+
+def pack_file(source, destination, keep_original):
+    with open(source, "rb") as file:
+        data = file.read()
+    written = []
+    for path, content in make_variants(destination, data, keep_original):
+        with open(path, "wb") as file:
+            file.write(content)
+        written.append((path, len(content)))
+    return written
+
+
+def main(args):
+    keep_original = "--keep-original" in args
+    args = [arg for arg in args[1:] if arg != "--keep-original"]
+    if len(args) != 2:
+        sys.exit(__doc__)
+    data_dir, out_dir = args
+    if brotli is None and shutil.which("brotli") is None:
+        print("WARNING: brotli is not available (install it by \"pip install brotli\"), only gzip variants are "
+              "produced", file=sys.stderr)
+
+    total_in = total_out = 0
+    for root, _, files in os.walk(data_dir):
+        for name in sorted(files):
+            source = os.path.join(root, name)
+            destination = os.path.join(out_dir, os.path.relpath(source, data_dir))
+            os.makedirs(os.path.dirname(destination), exist_ok=True)
+            written = pack_file(source, destination, keep_original)
+            total_in += os.path.getsize(source)
+            total_out += sum(size for _, size in written)
+            for path, size in written:
+                print("{:>8} {}".format(size, os.path.relpath(path, out_dir)))
+    print("{} bytes packed to {} bytes".format(total_in, total_out))
+
+
+if __name__ == "__main__":
+    main(sys.argv)
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Read and write configuration snapshots of SAD-Lamp.
+
+Snapshot is the binary blob, in which Persistency stores all variables (see src/Control/Persistency.cpp). It can be
+downloaded from lamp (GET /config), converted to JSON for editing, converted back and uploaded to another lamp
+(POST /config). Lamp reboots after successful import.
+
+Usage:
+    sad_lamp_config.py export <host> <snapshot.bin>
+    sad_lamp_config.py import <host> <snapshot.bin>
+    sad_lamp_config.py decode <snapshot.bin> [<config.json>]
+    sad_lamp_config.py encode <config.json> <snapshot.bin>
+"""
+
+import binascii
+import json
+import struct
+import sys
+import urllib.request
+import uuid
+
+FORMAT_VERSION = 1
+
+# Must be in sync with Persistency::kVariables: name, type ("B" - byte, "H" - word, "bytes" - binary blob)
+VARIABLES = [
+    ("AlarmDow", "B"),
+    ("AlarmMinute", "B"),
+    ("AlarmHours", "B"),
+    ("IsAlarmOn", "B"),
+    ("SunrDurMins", "H"),
+    ("FanPwmFreq", "H"),
+    ("FanPwmStepsNum", "B"),
+    ("PotMinVal", "H"),
+    ("PotMaxVal", "H"),
+    ("Alarms", "bytes"),
+]
+
+
+def decode(blob):
+    if len(blob) < 11 or blob[0] != FORMAT_VERSION:
+        raise ValueError("unsupported snapshot format")
+    (crc,) = struct.unpack_from("<I", blob, len(blob) - 4)
+    if crc != binascii.crc32(blob[:-4]):
+        raise ValueError("CRC mismatch")
+
+    generation, stored_mask = struct.unpack_from("<IH", blob, 1)
+    offset = 7
+    config = {"generation": generation, "variables": {}}
+    for index, (name, var_type) in enumerate(VARIABLES):
+        if not stored_mask & (1 << index):
+            continue
+        if var_type == "bytes":
+            (size,) = struct.unpack_from("<H", blob, offset)
+            config["variables"][name] = blob[offset + 2:offset + 2 + size].hex()
+            offset += 2 + size
+        else:
+            (config["variables"][name],) = struct.unpack_from("<" + var_type, blob, offset)
+            offset += struct.calcsize(var_type)
+    return config
+
+
+def encode(config):
+    variables = config["variables"]
+    stored_mask = 0
+    payload = b""
+    for index, (name, var_type) in enumerate(VARIABLES):
+        if name not in variables:
+            continue
+        stored_mask |= 1 << index
+        if var_type == "bytes":
+            data = bytes.fromhex(variables[name])
+            payload += struct.pack("<H", len(data)) + data
+        else:
+            payload += struct.pack("<" + var_type, variables[name])
+
+    blob = struct.pack("<BIH", FORMAT_VERSION, config.get("generation", 0), stored_mask) + payload
+    return blob + struct.pack("<I", binascii.crc32(blob))
+
+
+def export_snapshot(host):
+    with urllib.request.urlopen("http://{}/config".format(host), timeout=10) as response:
+        return response.read()
+
+
+def import_snapshot(host, blob):
+    boundary = uuid.uuid4().hex
+    body = (
+        "--{0}\r\nContent-Disposition: form-data; name=\"config\"; filename=\"config.bin\"\r\n"
+        "Content-Type: application/octet-stream\r\n\r\n".format(boundary).encode()
+        + blob
+        + "\r\n--{0}--\r\n".format(boundary).encode()
+    )
+    request = urllib.request.Request(
+        "http://{}/config".format(host),
+        data=body,
+        headers={"Content-Type": "multipart/form-data; boundary=" + boundary},
+    )
+    with urllib.request.urlopen(request, timeout=10) as response:
+        return response.read().decode()
+
+
+def main(args):
+    if len(args) < 3:
+        sys.exit(__doc__)
+    command = args[1]
+    if command == "export" and len(args) == 4:
+        blob = export_snapshot(args[2])
+        decode(blob)  # Validate
+        with open(args[3], "wb") as file:
+            file.write(blob)
+    elif command == "import" and len(args) == 4:
+        with open(args[3], "rb") as file:
+            blob = file.read()
+        decode(blob)  # Validate before sending
+        print(import_snapshot(args[2], blob))
+    elif command == "decode" and len(args) in (3, 4):
+        with open(args[2], "rb") as file:
+            text = json.dumps(decode(file.read()), indent=4)
+        if len(args) == 4:
+            with open(args[3], "w") as file:
+                file.write(text + "\n")
+        else:
+            print(text)
+    elif command == "encode" and len(args) == 4:
+        with open(args[2]) as file:
+            blob = encode(json.load(file))
+        with open(args[3], "wb") as file:
+            file.write(blob)
+    else:
+        sys.exit(__doc__)
+
+
+if __name__ == "__main__":
+    main(sys.argv)